@@ -0,0 +1,450 @@
+/*
+ * shellish-bench: Shell-ish'in sıcak yolları için mikro benchmark'lar.
+ *
+ * libshellish.a'ya linklenir, yani shell'in kendi parse_command(),
+ * resolve_executable_path(), spawn_command() ve execute_pipeline() kodunu
+ * ölçer. Sonuçlar stdout'a tek bir JSON nesnesi olarak yazılır (ilerleme
+ * mesajları stderr'e); her sonucun adı, değeri, birimi ve yönü vardır, böylece
+ * iki commit'in çıktısı isim isim karşılaştırılabilir.
+ *
+ * Tekrarlanabilirlik: girdiler sabit boyutlu ve deterministik üretilir, her
+ * ölçüm önce bir kez ısınır, sonra BENCH_ROUNDS kez tekrarlanıp medyanı alınır.
+ *
+ * Kullanım: shellish-bench [--quick] [--commit ID] [--only prefix]
+ *   make bench                      (bkz. Makefile)
+ */
+#define _GNU_SOURCE
+#include <errno.h>
+#include <fcntl.h>
+#include <stdbool.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "shellish.h"
+
+#define BENCH_ROUNDS 5 // her ölçümün tekrar sayısı (medyan alınır)
+
+static bool quick = false;         // --quick: kısa süreler, küçük girdiler
+static const char *only = NULL;    // --only: sadece bu prefix'le başlayanlar
+static int nresults = 0;           // yazılan sonuç sayısı (virgül için)
+static char tmpdir[] = "/tmp/shellish-bench-XXXXXX";
+static pid_t bench_pid;            // builtin child'ları da exit() ile çıkar
+
+static int64_t now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static int cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+static double median(double *v, int n)
+{
+  qsort(v, n, sizeof(double), cmp_double);
+  return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+static bool selected(const char *name)
+{
+  return only == NULL || strncmp(name, only, strlen(only)) == 0;
+}
+
+// Bir sonucu JSON dizisine yazar
+static void emit(const char *name, double value, const char *unit, bool higher_is_better)
+{
+  printf("%s    {\"name\": \"%s\", \"value\": %.6g, \"unit\": \"%s\", \"better\": \"%s\"}",
+         nresults++ > 0 ? ",\n" : "", name, value, unit, higher_is_better ? "higher" : "lower");
+  fflush(stdout);
+  fprintf(stderr, "  %-40s %14.3f %s\n", name, value, unit);
+}
+
+// Bir satırı parse edip çalıştırır (shell'in batch modundaki gibi)
+static int run(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+static int run(const char *fmt, ...)
+{
+  char line[1024];
+  va_list ap;
+  va_start(ap, fmt);
+  vsnprintf(line, sizeof(line), fmt, ap);
+  va_end(ap);
+  return run_line(line);
+}
+
+/* ===== parse_command: satır/s ===== */
+
+static void bench_parse(void)
+{
+  static char long_line[4096];
+  size_t n = 0;
+  n += snprintf(long_line + n, sizeof(long_line) - n, "gcc");
+  for (int i = 0; i < 64; i++) // 64 argümanlı derleme satırı
+    n += snprintf(long_line + n, sizeof(long_line) - n, " -Iinclude/dir%02d", i);
+  snprintf(long_line + n, sizeof(long_line) - n, " -o out main.c");
+
+  struct
+  {
+    const char *name;
+    char *line;
+  } cases[] = {
+      {"parse/simple", "ls -la /tmp"},
+      {"parse/pipeline", "cat access.log | grep GET | cut -d , -f 1 | sort | uniq -c | head"},
+      {"parse/redirects", "cut -d , -f 1,3 <in.csv >>out.csv &"},
+      {"parse/64-args", long_line},
+  };
+  long iters = quick ? 20000 : 200000;
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+  {
+    if (!selected(cases[c].name))
+      continue;
+    double rates[BENCH_ROUNDS];
+    for (int r = -1; r < BENCH_ROUNDS; r++) // r == -1: ısınma
+    {
+      int64_t t0 = now_ns();
+      for (long i = 0; i < iters; i++)
+      {
+        struct command_t *cmd = arena_calloc(&line_arena, sizeof(struct command_t));
+        parse_command(cases[c].line, cmd);
+        arena_reset(&line_arena);
+      }
+      if (r >= 0)
+        rates[r] = iters / ((now_ns() - t0) / 1e9);
+    }
+    emit(cases[c].name, median(rates, BENCH_ROUNDS), "lines/s", true);
+  }
+}
+
+/* ===== resolve_executable_path: ns/arama, PATH uzunluğuna göre ===== */
+
+static void bench_resolve(void)
+{
+  static const int lengths[] = {1, 8, 32, 128};
+  const char *old_path = getenv("PATH");
+  char *saved = old_path ? strdup(old_path) : NULL;
+  char *path = malloc(128 * (sizeof(tmpdir) + 16));
+  if (path == NULL)
+    return;
+
+  for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++)
+  {
+    int k = lengths[l];
+    char name_cold[64], name_warm[64];
+    snprintf(name_cold, sizeof(name_cold), "resolve/path-%d/cold", k);
+    snprintf(name_warm, sizeof(name_warm), "resolve/path-%d/hashed", k);
+    if (!selected(name_cold) && !selected(name_warm))
+      continue;
+
+    // k klasör; komut sadece sonuncusunda (en kötü durum: hepsi denenir)
+    size_t n = 0;
+    char dir[sizeof(tmpdir) + 16];
+    for (int i = 0; i < k; i++)
+    {
+      snprintf(dir, sizeof(dir), "%s/p%03d", tmpdir, i);
+      mkdir(dir, 0755);
+      n += sprintf(path + n, "%s%s", i > 0 ? ":" : "", dir);
+    }
+    char exe[sizeof(dir) + 16];
+    snprintf(exe, sizeof(exe), "%s/shb-target", dir);
+    int fd = open(exe, O_WRONLY | O_CREAT | O_TRUNC, 0755);
+    if (fd >= 0)
+      close(fd);
+    setenv("PATH", path, 1);
+
+    long iters = (quick ? 20000 : 200000) / k + 100;
+    for (int hashed = 0; hashed < 2; hashed++)
+    {
+      double ns[BENCH_ROUNDS];
+      for (int r = -1; r < BENCH_ROUNDS; r++)
+      {
+        int64_t t0 = now_ns();
+        for (long i = 0; i < iters; i++)
+        {
+          if (!hashed)
+            cmd_hash_clear(); // her aramada PATH taransın
+          free(resolve_executable_path("shb-target"));
+        }
+        if (r >= 0)
+          ns[r] = (double)(now_ns() - t0) / iters;
+      }
+      if (selected(hashed ? name_warm : name_cold))
+        emit(hashed ? name_warm : name_cold, median(ns, BENCH_ROUNDS), "ns/lookup", false);
+    }
+    unlink(exe);
+  }
+
+  if (saved != NULL)
+    setenv("PATH", saved, 1);
+  cmd_hash_clear();
+  free(saved);
+  free(path);
+}
+
+/* ===== fork+exec ile posix_spawn: başlatma + bekleme gecikmesi ===== */
+
+static void bench_spawn(void)
+{
+  char *path = resolve_executable_path("true");
+  if (path == NULL)
+    return;
+  char *argv[] = {"true", NULL};
+  const char *modes[] = {"fork", "spawn"};
+  int n = quick ? 100 : 500;
+  double *lat = malloc(sizeof(double) * n);
+  for (int m = 0; m < 2 && lat != NULL; m++)
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "spawn/%s", modes[m]);
+    if (!selected(name))
+      continue;
+    run("spawnmode %s", modes[m]);
+    int got = 0; // ölçülen örnek sayısı
+    for (int i = -10; i < n; i++) // ilk 10: ısınma
+    {
+      int64_t t0 = now_ns();
+      pid_t pid;
+      int err = spawn_command(path, argv, -1, -1, -1, NULL, -1, false, &pid);
+      if (err != 0)
+      {
+        fprintf(stderr, "-%s: bench: %s: %s\n", sysname, name, strerror(err));
+        break;
+      }
+      waitpid(pid, NULL, 0);
+      if (i >= 0)
+        lat[got++] = (now_ns() - t0) / 1e3;
+    }
+    if (got < n)
+      continue; // yarım kalan ölçüm yanıltır: metrik yazılmaz
+    qsort(lat, n, sizeof(double), cmp_double);
+    snprintf(name, sizeof(name), "spawn/%s/p50", modes[m]);
+    emit(name, lat[n / 2], "us", false);
+    snprintf(name, sizeof(name), "spawn/%s/p99", modes[m]);
+    emit(name, lat[(int)(n * 0.99)], "us", false);
+  }
+  run("spawnmode spawn"); // varsayılana dön
+  free(lat);
+  free(path);
+}
+
+/* ===== Girdi dosyası: deterministik CSV ===== */
+
+static char data_path[sizeof(tmpdir) + 16];
+static double data_bytes = 0;
+
+static int make_data(void)
+{
+  snprintf(data_path, sizeof(data_path), "%s/data.csv", tmpdir);
+  FILE *f = fopen(data_path, "w");
+  if (f == NULL)
+    return -1;
+  long target = (quick ? 16L : 128L) << 20;
+  uint32_t x = 2463534242u; // xorshift: her çalıştırmada aynı içerik
+  for (long i = 0; ftell(f) < target; i++)
+  {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    fprintf(f, "%ld,user%u,%u.%02u,GET,/api/v1/items/%u,%s\n", i, x % 10000, x % 997,
+            x % 100, x % 65536, (x & 1) ? "ok" : "error");
+  }
+  data_bytes = (double)ftell(f);
+  return fclose(f);
+}
+
+// Satırı (rounds + ısınma) kez execute_pipeline ile çalıştırır; GB/s medyanı
+static double pipeline_rate(const char *line, double bytes)
+{
+  double rates[BENCH_ROUNDS];
+  for (int r = -1; r < BENCH_ROUNDS; r++)
+  {
+    char buf[1024];
+    snprintf(buf, sizeof(buf), "%s", line);
+    struct command_t *cmd = arena_calloc(&line_arena, sizeof(struct command_t));
+    parse_command(buf, cmd);
+    int64_t t0 = now_ns();
+    if (cmd->next != NULL)
+      execute_pipeline(cmd);
+    else
+      process_command(cmd);
+    int64_t dt = now_ns() - t0;
+    arena_reset(&line_arena);
+    if (r >= 0)
+      rates[r] = bytes / (dt / 1e9);
+  }
+  return median(rates, BENCH_ROUNDS);
+}
+
+/* ===== execute_pipeline: GB/s ===== */
+
+static void bench_pipeline(void)
+{
+  struct
+  {
+    const char *name;
+    const char *fmt;
+  } cases[] = {
+      {"pipeline/cat|cat", "cat %s | cat >/dev/null"},                // builtin'ler: splice
+      {"pipeline/ext-cat|ext-cat", "/bin/cat %s | /bin/cat >/dev/null"}, // dış komutlar
+      {"pipeline/cat|cut|cut", "cat %s | cut -d , -f 1,2 | cut -d , -f 2 >/dev/null"},
+  };
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+  {
+    if (!selected(cases[c].name))
+      continue;
+    char line[1024];
+    snprintf(line, sizeof(line), cases[c].fmt, data_path);
+    emit(cases[c].name, pipeline_rate(line, data_bytes) / 1e9, "GB/s", true);
+  }
+}
+
+/* ===== cut: MB/s (seri ve paralel) ===== */
+
+static void bench_cut(void)
+{
+  struct
+  {
+    const char *name;
+    const char *fmt;
+  } cases[] = {
+      {"cut/serial", "cut -j 1 -d , -f 2,5 <%s >/dev/null"},
+      {"cut/parallel", "cut -d , -f 2,5 <%s >/dev/null"}, // -j: CPU sayısı
+  };
+  for (size_t c = 0; c < sizeof(cases) / sizeof(cases[0]); c++)
+  {
+    if (!selected(cases[c].name))
+      continue;
+    char line[1024];
+    snprintf(line, sizeof(line), cases[c].fmt, data_path);
+    emit(cases[c].name, pipeline_rate(line, data_bytes) / 1e6, "MB/s", true);
+  }
+}
+
+/* ===== chatroom: mesaj gecikmesi (chatroom-bench --export-json) ===== */
+
+// JSON dosyasındaki "key": sayı değerini okur (chatroom-bench'in düz çıktısı)
+static double json_number(const char *json, const char *key)
+{
+  char pat[64];
+  snprintf(pat, sizeof(pat), "\"%s\":", key);
+  const char *p = strstr(json, pat);
+  return p ? strtod(p + strlen(pat), NULL) : -1;
+}
+
+static void bench_chatroom(void)
+{
+  const char *transports[] = {"fifo", "shm"};
+  for (int t = 0; t < 2; t++)
+  {
+    char name[64];
+    snprintf(name, sizeof(name), "chatroom/%s", transports[t]);
+    if (!selected(name))
+      continue;
+    char json_path[sizeof(tmpdir) + 32];
+    snprintf(json_path, sizeof(json_path), "%s/chat-%s.json", tmpdir, transports[t]);
+    run("chatroom-bench %s -u 4 -r 200 -d %s --export-json %s >/dev/null",
+        t ? "--shm" : "", quick ? "0.5" : "2", json_path);
+
+    char json[4096] = "";
+    int fd = open(json_path, O_RDONLY);
+    if (fd < 0)
+      continue;
+    ssize_t n = read(fd, json, sizeof(json) - 1);
+    close(fd);
+    unlink(json_path);
+    if (n <= 0)
+      continue;
+    json[n] = '\0';
+    static const char *keys[] = {"p50_us", "p99_us", "p999_us"};
+    for (int k = 0; k < 3; k++)
+    {
+      snprintf(name, sizeof(name), "chatroom/%s/%.*s", transports[t],
+               (int)strcspn(keys[k], "_"), keys[k]);
+      emit(name, json_number(json, keys[k]), "us", false);
+    }
+    snprintf(name, sizeof(name), "chatroom/%s/cpu", transports[t]);
+    emit(name, json_number(json, "cpu_us_per_msg"), "us/msg", false);
+  }
+}
+
+// Geçici klasörü temizler
+static void cleanup(void)
+{
+  char cmd[sizeof(tmpdir) + 16];
+  if (getpid() != bench_pid) // fork edilmiş child: klasöre dokunma
+    return;
+  if (data_path[0] != '\0')
+    unlink(data_path);
+  for (int i = 0; i < 128; i++)
+  {
+    snprintf(cmd, sizeof(cmd), "%s/p%03d", tmpdir, i);
+    rmdir(cmd);
+  }
+  rmdir(tmpdir);
+}
+
+int main(int argc, char *argv[])
+{
+  const char *commit = "";
+  for (int i = 1; i < argc; i++)
+  {
+    if (strcmp(argv[i], "--quick") == 0)
+      quick = true;
+    else if (strcmp(argv[i], "--commit") == 0 && i + 1 < argc)
+      commit = argv[++i];
+    else if (strcmp(argv[i], "--only") == 0 && i + 1 < argc)
+      only = argv[++i];
+    else
+    {
+      fprintf(stderr, "usage: %s [--quick] [--commit ID] [--only prefix]\n", argv[0]);
+      return 2;
+    }
+  }
+  if (mkdtemp(tmpdir) == NULL)
+  {
+    fprintf(stderr, "-%s: bench: mkdtemp: %s\n", sysname, strerror(errno));
+    return 1;
+  }
+  bench_pid = getpid();
+  atexit(cleanup);
+  jobs_init(false); // batch modu gibi: arka plan child'ları toplansın
+
+  struct utsname un;
+  uname(&un);
+  time_t now = time(NULL);
+  char date[32];
+  strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%SZ", gmtime(&now));
+  printf("{\n  \"schema\": \"shellish-bench/1\",\n  \"commit\": \"%s\",\n", commit);
+  printf("  \"date\": \"%s\",\n", date);
+  printf("  \"host\": {\"cpus\": %ld, \"kernel\": \"%s\", \"machine\": \"%s\"},\n",
+         sysconf(_SC_NPROCESSORS_ONLN), un.release, un.machine);
+  printf("  \"config\": {\"quick\": %s, \"rounds\": %d},\n", quick ? "true" : "false",
+         BENCH_ROUNDS);
+  printf("  \"results\": [\n");
+  fflush(stdout);
+
+  bench_parse();
+  bench_resolve();
+  bench_spawn();
+  if (make_data() == 0)
+  {
+    bench_pipeline();
+    bench_cut();
+  }
+  else
+    fprintf(stderr, "-%s: bench: %s: %s\n", sysname, data_path, strerror(errno));
+  bench_chatroom();
+
+  printf("\n  ]\n}\n");
+  return 0;
+}
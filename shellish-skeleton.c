@@ -1,3 +1,4 @@
+#define _GNU_SOURCE // pipe2, close_range
 #include <errno.h>
 #include <stdbool.h>
 #include <stdio.h>
@@ -11,25 +12,36 @@
 #include <dirent.h>   // opendir, readdir
 #include <signal.h>   // kill, SIGTERM
 #include <sys/stat.h> // mkdir, mkfifo
-const char *sysname = "shellish";
+#include <spawn.h>    // posix_spawn, posix_spawn_file_actions_*
+#include <sys/mman.h> // mmap, madvise
+#include <pthread.h>  // builtin pipeline aşamaları için thread'ler
+#include <math.h>         // sqrt (repeat --bench)
+#include <time.h>         // clock_gettime
+#include <sys/resource.h> // wait4 rusage
+#include <poll.h>         // poll (chatroom EAGAIN bekleme)
+#include <stdatomic.h>    // chatroom --shm ring'i
+#include <stdint.h>
+#include <sys/file.h>     // flock
+#include <sys/syscall.h>  // SYS_futex
+#include <linux/futex.h>  // FUTEX_WAIT, FUTEX_WAKE
+#include <sys/inotify.h>  // chatroom üye giriş/çıkışları
+#include <sys/uio.h>      // writev, pwritev (chatroom)
+#include <limits.h>       // PIPE_BUF
+#include <stdarg.h>       // trace olay argümanları
+#include <sys/sendfile.h> // sendfile (cat)
+#include <sys/ioctl.h>    // TIOCGWINSZ (tamamlama listesi)
+#include <sys/socket.h>   // --serve
+#include <sys/un.h>       // sockaddr_un
+#include <arpa/inet.h>    // htonl (çerçeve uzunlukları)
+#include <sys/prctl.h>    // PR_SET_PDEATHSIG (--serve worker'ları)
+
+#include "shellish.h" // command_t, return_codes ve kütüphane arayüzü
 
-enum return_codes
-{
-  SUCCESS = 0,
-  EXIT = 1,
-  UNKNOWN = 2,
-};
+const char *sysname = "shellish";
 
-struct command_t
-{
-  char *name;
-  bool background;
-  bool auto_complete;
-  int arg_count;
-  char **args;
-  char *redirects[3];     // in/out redirection
-  struct command_t *next; // for piping
-};
+// Son çalışan komutun çıkış durumu (0 = başarılı, 127 = bulunamadı, ...)
+// Batch modda shell'in çıkış kodu olarak kullanılır.
+int last_status = 0;
 
 /**
  * Prints a command struct
@@ -55,1138 +67,8442 @@ void print_command(struct command_t *command)
   }
 }
 
-/**
- * Release allocated memory of a command
- * @param  command [description]
- * @return         [description]
+/*
+ * Satır arenası: bir komut satırının parse sonucu (command_t'ler, argv
+ * dizileri, argüman ve redirect string'leri) tek bir bump-pointer arenasından
+ * alınır ve satır bitince arena_reset ile tek seferde geri verilir. Blok
+ * reset'te tutulduğu için sürekli çalışan shell'de satır başına malloc/free
+ * yapılmaz.
  */
-int free_command(struct command_t *command)
+#define ARENA_BLOCK_SIZE 65536 // varsayılan blok boyutu
+#define ARENA_ALIGN 16         // dönen adreslerin hizası
+
+struct arena_block
+{
+  struct arena_block *next; // önceki (dolmuş) blok
+  size_t cap;               // data kapasitesi
+  size_t used;              // data'nın kullanılan kısmı
+  char data[];
+};
+
+struct arena
+{
+  struct arena_block *head; // şu an doldurulan blok
+  size_t block_size;        // yeni blok boyutu (0: ARENA_BLOCK_SIZE)
+};
+
+// Tüm parse sonuçlarının geldiği arena (her satırdan sonra reset edilir)
+struct arena line_arena;
+
+void *arena_alloc(struct arena *a, size_t size)
 {
-  if (command->arg_count)
+  size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+  struct arena_block *b = a->head;
+  if (b == NULL || b->cap - b->used < size)
   {
-    for (int i = 0; i < command->arg_count; ++i)
-      free(command->args[i]);
-    free(command->args);
+    size_t block = a->block_size ? a->block_size : ARENA_BLOCK_SIZE;
+    size_t cap = size > block ? size : block;
+    b = malloc(sizeof(struct arena_block) + cap);
+    if (b == NULL)
+    {
+      fprintf(stderr, "-%s: out of memory\n", sysname);
+      exit(1);
+    }
+    b->next = a->head;
+    b->cap = cap;
+    b->used = 0;
+    a->head = b;
   }
-  for (int i = 0; i < 3; ++i)
-    if (command->redirects[i])
-      free(command->redirects[i]);
-  if (command->next)
+  void *p = b->data + b->used;
+  b->used += size;
+  return p;
+}
+
+void *arena_calloc(struct arena *a, size_t size)
+{
+  return memset(arena_alloc(a, size), 0, size);
+}
+
+char *arena_strndup(struct arena *a, const char *s, size_t len)
+{
+  char *p = arena_alloc(a, len + 1);
+  memcpy(p, s, len);
+  p[len] = 0;
+  return p;
+}
+
+// Arenadaki her şeyi bırakır. En son (en büyük olabilecek) blok tekrar
+// kullanılmak üzere tutulur, diğerleri free edilir.
+void arena_reset(struct arena *a)
+{
+  struct arena_block *b = a->head;
+  if (b == NULL)
+    return;
+  while (b->next != NULL)
+  {
+    struct arena_block *old = b->next;
+    b->next = old->next;
+    free(old);
+  }
+  b->used = 0;
+}
+
+// Arenanın tüm bloklarını free eder (arena bir daha kullanılmayacaksa)
+void arena_free(struct arena *a)
+{
+  while (a->head != NULL)
+  {
+    struct arena_block *b = a->head;
+    a->head = b->next;
+    free(b);
+  }
+}
+
+/*
+ * ===== Faz izleme (trace) =====
+ * Enter'a basılmasından sonraki prompt'a kadar zamanın nereye gittiğini
+ * görmek için. SHELLISH_TRACE=<dosya> veya "trace on [dosya]" ile açılır.
+ * Her komutun fazları (prompt, read, parse_command, resolve, fork/spawn,
+ * exec, wait) ve her pipeline aşaması zaman damgalı bir olay olarak yazılır.
+ * Dosya Chrome trace-event formatındadır (satır başına bir olay içeren JSON
+ * dizisi), Perfetto veya chrome://tracing doğrudan açar. Dosya adı .jsonl
+ * ile bitiyorsa dizi olmadan düz JSON-lines yazılır.
+ * Her olay tek write() ile O_APPEND dosyaya gider: builtin thread'leri ve
+ * fork modundaki child'lar aynı dosyaya birbirine karışmadan yazabilir.
+ * Zaman CLOCK_MONOTONIC, mikrosaniye. Kapalıyken maliyet bir fd kontrolü.
+ */
+#define TRACE_EVENT_MAX 4096 // bir olayın en büyük boyutu
+#define TRACE_STR_MAX 512    // bir string argümanın en fazla kaç byte yazılacağı
+
+static int trace_fd = -1;        // trace dosyası (-1: kapalı)
+static bool trace_jsonl = false; // düz JSON-lines mı (Chrome dizisi değil)
+static pid_t trace_pid = 0;      // dosyayı açan shell (pid alanı, kapatma)
+static char *trace_file = NULL;  // "trace" builtin'inin gösterdiği dosya adı
+
+// Monotonik zaman (ns). Trace kapalıyken 0 döner; 0 başlangıçlı span'ler
+// yazılmaz. SIGCHLD handler'ından da çağrılır (clock_gettime güvenli).
+int64_t trace_begin(void)
+{
+  if (trace_fd < 0)
+    return 0;
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+}
+
+// buf[n..] içine printf yapar, yeni uzunluğu döner (taşarsa keser)
+static size_t trace_put(char *buf, size_t cap, size_t n, const char *fmt, ...)
+{
+  if (n + 1 >= cap)
+    return n;
+  va_list ap;
+  va_start(ap, fmt);
+  int w = vsnprintf(buf + n, cap - n, fmt, ap);
+  va_end(ap);
+  if (w < 0)
+    return n;
+  return ((size_t)w < cap - n) ? n + w : cap - 1;
+}
+
+// s'yi tırnaklı, kaçışlı JSON string'i olarak ekler (en fazla TRACE_STR_MAX,
+// buf[cap]'i geçmeden keser). İki tırnağa bile yer yoksa hiçbir şey yazmaz.
+static size_t trace_put_str(char *buf, size_t cap, size_t n, const char *s)
+{
+  size_t end = n + TRACE_STR_MAX < cap ? n + TRACE_STR_MAX : cap;
+  if (n + 2 > end)
+    return n;
+  buf[n++] = '"';
+  for (; s != NULL && *s != '\0' && n + 7 < end; s++) // kaçış ve kapanış tırnağı payı
+  {
+    unsigned char c = (unsigned char)*s;
+    if (c == '"' || c == '\\')
+    {
+      buf[n++] = '\\';
+      buf[n++] = c;
+    }
+    else if (c < 0x20)
+      n += sprintf(buf + n, "\\u%04x", c); // kontrol karakterleri
+    else
+      buf[n++] = c;
+  }
+  buf[n++] = '"';
+  return n;
+}
+
+/*
+ * Tek bir olay yazar. ph: "X" (süreli span), "i" (an), "M" (metadata).
+ * tid 0 ise çağıran thread. Argümanlar "anahtar", "değer" string çiftleridir
+ * ve NULL ile biter. Sabit alanlar ~200 byte, en fazla 6 argüman yazılır;
+ * uzun değerler TRACE_EVENT_MAX'a sığacak şekilde kesilir, sığmayanlar atlanır.
+ */
+static void trace_emitv(const char *ph, const char *name, int64_t ts, int64_t dur,
+                        pid_t tid, va_list ap)
+{
+  int fd = trace_fd;
+  if (fd < 0)
+    return;
+  char ev[TRACE_EVENT_MAX];
+  size_t cap = sizeof(ev) - 8; // "}}\n" payı
+  size_t n = trace_put(ev, cap, 0, "%s{\"name\":", trace_jsonl ? "" : ",\n");
+  n = trace_put_str(ev, cap, n, name);
+  n = trace_put(ev, cap, n, ",\"cat\":\"%s\",\"ph\":\"%s\",\"pid\":%d,\"tid\":%d",
+                sysname, ph, (int)trace_pid, (int)(tid != 0 ? tid : gettid()));
+  if (*ph != 'M')
+    n = trace_put(ev, cap, n, ",\"ts\":%lld.%03d", (long long)(ts / 1000), (int)(ts % 1000));
+  if (*ph == 'X')
+    n = trace_put(ev, cap, n, ",\"dur\":%lld.%03d", (long long)(dur / 1000), (int)(dur % 1000));
+  if (*ph == 'i')
+    n = trace_put(ev, cap, n, ",\"s\":\"t\""); // thread kapsamlı an
+  n = trace_put(ev, cap, n, ",\"args\":{");
+  const char *key;
+  for (int i = 0; i < 6 && (key = va_arg(ap, const char *)) != NULL; i++)
+  {
+    const char *val = va_arg(ap, const char *);
+    if (n + 16 > cap)
+      break; // olay doldu: kalan argümanlar yazılmaz
+    if (i > 0)
+      ev[n++] = ',';
+    n = trace_put_str(ev, cap - 8, n, key); // ':' ve değer için yer kalsın
+    ev[n++] = ':';
+    n = trace_put_str(ev, cap, n, val);
+  }
+  n += sprintf(ev + n, "}}%s", trace_jsonl ? "\n" : "");
+  ssize_t w = write(fd, ev, n); // O_APPEND: tek write, tek olay
+  (void)w;
+}
+
+// start'tan şimdiye kadar süren bir span yazar (start 0 ise hiçbir şey)
+void trace_span(const char *name, int64_t start, pid_t tid, ...)
+{
+  int64_t now = trace_begin();
+  if (start == 0 || now == 0)
+    return;
+  va_list ap;
+  va_start(ap, tid);
+  trace_emitv("X", name, start, now - start, tid, ap);
+  va_end(ap);
+}
+
+// Başı ve sonu önceden ölçülmüş bir span yazar (ör: handler'da biten aşama)
+void trace_span_at(const char *name, int64_t start, int64_t end, pid_t tid, ...)
+{
+  if (start == 0 || end < start || trace_fd < 0)
+    return;
+  va_list ap;
+  va_start(ap, tid);
+  trace_emitv("X", name, start, end - start, tid, ap);
+  va_end(ap);
+}
+
+// Anlık bir olay yazar (ör: exec, ilk çıktı)
+void trace_instant(const char *name, pid_t tid, ...)
+{
+  int64_t now = trace_begin();
+  if (now == 0)
+    return;
+  va_list ap;
+  va_start(ap, tid);
+  trace_emitv("i", name, now, 0, tid, ap);
+  va_end(ap);
+}
+
+// Perfetto'da tid'in satırına isim verir (aşamanın komut adı)
+void trace_thread_name(pid_t tid, const char *name)
+{
+  if (trace_fd < 0)
+    return;
+  char ev[TRACE_EVENT_MAX];
+  size_t n = trace_put(ev, sizeof(ev), 0,
+                       "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,\"args\":{\"name\":",
+                       trace_jsonl ? "" : ",\n", (int)trace_pid, (int)tid);
+  n = trace_put_str(ev, sizeof(ev) - 8, n, name);
+  n += sprintf(ev + n, "}}%s", trace_jsonl ? "\n" : "");
+  ssize_t w = write(trace_fd, ev, n);
+  (void)w;
+}
+
+// Trace dosyasını kapatır. Chrome formatında diziyi "]" ile bitirir.
+// Sadece dosyayı açan shell kapatır (fork edilmiş child'ların exit'i değil).
+void trace_close(void)
+{
+  if (trace_fd < 0 || getpid() != trace_pid)
+    return;
+  int fd = trace_fd;
+  trace_fd = -1;
+  if (!trace_jsonl)
   {
-    free_command(command->next);
-    command->next = NULL;
+    ssize_t w = write(fd, "\n]\n", 3);
+    (void)w;
   }
-  free(command->name);
-  free(command);
+  close(fd);
+}
+
+// path'e yeni bir trace başlatır (varsa eskisini kapatır). Hata: -1.
+int trace_open(const char *path)
+{
+  trace_close();
+  int fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+  if (fd < 0)
+    return -1;
+  size_t len = strlen(path);
+  trace_jsonl = len >= 6 && strcmp(path + len - 6, ".jsonl") == 0;
+  trace_pid = getpid();
+  free(trace_file);
+  trace_file = strdup(path);
+
+  // İlk olay: sürecin adı. Chrome formatında dizi burada açılır; sonraki
+  // olaylar ",\n" ile başladığı için dosya her an geçerli bir önek olur.
+  dprintf(fd, "%s{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%d,"
+              "\"args\":{\"name\":\"%s\"}}%s",
+          trace_jsonl ? "" : "[", (int)trace_pid, (int)trace_pid, sysname,
+          trace_jsonl ? "\n" : "");
+  trace_fd = fd;
   return 0;
 }
 
+// trace builtin: izlemeyi açar/kapatır
+// trace               -> durumu yaz
+// trace on [dosya]    -> dosyaya yazmaya başla (varsayılan /tmp/shellish-trace-<pid>.json)
+// trace off           -> dosyayı kapat
+int run_trace_builtin(struct command_t *command)
+{
+  const char *arg = command->args[1];
+  if (arg == NULL)
+  {
+    if (trace_fd >= 0)
+      printf("trace: on (%s)\n", trace_file ? trace_file : "?");
+    else
+      printf("trace: off\n");
+    return SUCCESS;
+  }
+  if (strcmp(arg, "off") == 0)
+  {
+    trace_close();
+    return SUCCESS;
+  }
+  if (strcmp(arg, "on") == 0)
+  {
+    char def[64];
+    const char *path = command->args[2];
+    if (path == NULL)
+    {
+      snprintf(def, sizeof(def), "/tmp/%s-trace-%d.json", sysname, (int)getpid());
+      path = def;
+    }
+    if (trace_open(path) != 0)
+    {
+      printf("-%s: trace: %s: %s\n", sysname, path, strerror(errno));
+      return UNKNOWN;
+    }
+    printf("trace: writing to %s\n", path);
+    return SUCCESS;
+  }
+  printf("-%s: trace: usage: trace [on [file] | off]\n", sysname);
+  return UNKNOWN;
+}
+
 /**
  * Show the command prompt
  * @return [description]
  */
 int show_prompt()
 {
-  char cwd[1024], hostname[1024];
+  char hostname[256];                // HOST_NAME_MAX 64, bol bol yeter
+  char *cwd = getcwd(NULL, 0);       // uzunluğu sınırsız cwd
   gethostname(hostname, sizeof(hostname));
-  getcwd(cwd, sizeof(cwd));
-  printf("%s@%s:%s %s$ ", getenv("USER"), hostname, cwd, sysname);
+  hostname[sizeof(hostname) - 1] = '\0';
+  printf("%s@%s:%s %s$ ", getenv("USER"), hostname, cwd ? cwd : "?", sysname);
+  free(cwd);
   return 0;
 }
 
 /**
  * Parse a command string into a command struct
+ * Tek geçişli lexer: satır arenaya bir kez kopyalanır ve baştan sona bir
+ * kez taranır; token'lar kopyanın içinde yerinde sonlandırılır. Her '|' yeni
+ * bir aşama başlatır (özyineleme yok), böylece pipeline ne kadar uzun olursa
+ * olsun süre satır uzunluğuyla doğrusaldır. Tüm aşamaların argv'leri tek bir
+ * pointer dizisini paylaşır: [isim, arg..., NULL, isim, arg..., NULL, ...].
+ * Satır uzunluğu sınırsızdır. Her şey a'dan alınır (parse_command için
+ * line_arena; serbest bırakmak için arena_reset(&line_arena)).
+ * @param  a       [description]
  * @param  buf     [description]
  * @param  command [description]
  * @return         0
  */
-int parse_command(char *buf, struct command_t *command)
+int parse_command_in(struct arena *a, char *buf, struct command_t *command)
 {
-  const char *splitters = " \t"; // split at whitespace
-  int index, len;
-  len = strlen(buf);
-  while (len > 0 && strchr(splitters, buf[0]) != NULL) // trim left whitespace
+  size_t len = strlen(buf);
+  while (len > 0 && (buf[0] == ' ' || buf[0] == '\t')) // trim left whitespace
   {
     buf++;
     len--;
   }
-  while (len > 0 && strchr(splitters, buf[len - 1]) != NULL)
-    buf[--len] = 0; // trim right whitespace
+  while (len > 0 && (buf[len - 1] == ' ' || buf[len - 1] == '\t'))
+    len--; // trim right whitespace
 
-  if (len > 0 && buf[len - 1] == '?') // auto-complete
-    command->auto_complete = true;
-  if (len > 0 && buf[len - 1] == '&') // background
-    command->background = true;
+  // Satırın kopyası arenada: token'lar (isim, argümanlar, redirect hedefleri)
+  // doğrudan bu kopyanın içini gösterir
+  buf = arena_strndup(a, buf, len);
+  char *end = buf + len; // *end == '\0' (boş isim için de kullanılır)
 
-  char *pch = strtok(buf, splitters);
-  if (pch == NULL)
-  {
-    command->name = (char *)malloc(1);
-    command->name[0] = 0;
-  }
-  else
-  {
-    command->name = (char *)malloc(strlen(pch) + 1);
-    strcpy(command->name, pch);
-  }
+  // auto-complete: sadece ayrı bir token olan sondaki '?' ("gi ?"); "really?" değil
+  bool auto_complete = len > 0 && buf[len - 1] == '?' &&
+                       (len == 1 || buf[len - 2] == ' ' || buf[len - 2] == '\t');
+  bool background = len > 0 && buf[len - 1] == '&';    // background
 
-  command->args = (char **)malloc(sizeof(char *));
+  // Token sayısı en fazla (len + 1) / 2; her aşamanın NULL'u en az bir '|'
+  // token'ının yerini tuttuğu için toplam yer bu sınırı aşmaz
+  char **slots = arena_alloc(a, sizeof(char *) * (len / 2 + 3));
 
-  int redirect_index;
-  int arg_index = 0;
-  char temp_buf[1024], *arg;
-  while (1)
+  struct command_t *cur = command; // doldurulan aşama
+  cur->args = slots;
+  int n = 0; // cur'daki argv eleman sayısı (isim dahil)
+
+  char *p = buf;
+  while (p < end)
   {
-    // tokenize input on splitters
-    pch = strtok(NULL, splitters);
-    if (!pch)
+    // Boşlukları atla, sonraki token'ın sınırlarını bul
+    while (p < end && (*p == ' ' || *p == '\t'))
+      p++;
+    if (p == end)
       break;
-    arg = temp_buf;
-    strcpy(arg, pch);
-    len = strlen(arg);
+    char *arg = p;
+    while (p < end && *p != ' ' && *p != '\t')
+      p++;
+    size_t arg_len = p - arg;
+    *p = '\0'; // token'ı sonlandır (p == end ise zaten '\0')
+    if (p < end)
+      p++;
+
+    // piping to another command: aşamayı kapat, yenisine geç
+    if (arg_len == 1 && arg[0] == '|')
+    {
+      cur->args[n] = NULL;
+      cur->arg_count = n + 1;
+      cur->name = n > 0 ? cur->args[0] : end;
+      cur->auto_complete = auto_complete;
+      cur->background = background;
+
+      struct command_t *c = arena_calloc(a, sizeof(struct command_t));
+      c->args = cur->args + n + 1;
+      cur->next = c;
+      cur = c;
+      n = 0;
+      continue;
+    }
 
-    if (len == 0)
-      continue;                                          // empty arg, go for next
-    while (len > 0 && strchr(splitters, arg[0]) != NULL) // trim left whitespace
+    // Aşamanın ilk token'ı komut adıdır
+    if (n == 0)
     {
-      arg++;
-      len--;
-    }
-    while (len > 0 && strchr(splitters, arg[len - 1]) != NULL)
-      arg[--len] = 0; // trim right whitespace
-    if (len == 0)
-      continue; // empty arg, go for next
-
-    // piping to another command
-    if (strcmp(arg, "|") == 0)
-    {
-      struct command_t *c =
-          (struct command_t *)malloc(sizeof(struct command_t));
-      int l = strlen(pch);
-      pch[l] = splitters[0]; // restore strtok termination
-      index = 1;
-      while (pch[index] == ' ' || pch[index] == '\t')
-        index++; // skip whitespaces
-
-      parse_command(pch + index, c);
-      pch[l] = 0; // put back strtok termination
-      command->next = c;
+      cur->args[n++] = arg;
       continue;
     }
 
     // background process
-    if (strcmp(arg, "&") == 0)
+    if (arg_len == 1 && arg[0] == '&')
       continue; // handled before
 
     // handle input redirection
-    redirect_index = -1;
+    int redirect_index = -1;
     if (arg[0] == '<')
       redirect_index = 0;
     if (arg[0] == '>')
     {
-      if (len > 1 && arg[1] == '>')
+      if (arg_len > 1 && arg[1] == '>')
       {
         redirect_index = 2;
         arg++;
-        len--;
+        arg_len--;
       }
       else
         redirect_index = 1;
     }
     if (redirect_index != -1)
     {
-      command->redirects[redirect_index] = (char *)malloc(len);
-      strcpy(command->redirects[redirect_index], arg + 1);
+      cur->redirects[redirect_index] = arg + 1;
       continue;
     }
 
     // normal arguments
-    if (len > 2 &&
-        ((arg[0] == '"' && arg[len - 1] == '"') ||
-         (arg[0] == '\'' && arg[len - 1] == '\''))) // quote wrapped arg
+    if (arg_len > 2 &&
+        ((arg[0] == '"' && arg[arg_len - 1] == '"') ||
+         (arg[0] == '\'' && arg[arg_len - 1] == '\''))) // quote wrapped arg
     {
-      arg[--len] = 0;
+      arg[--arg_len] = 0;
       arg++;
     }
-    command->args =
-        (char **)realloc(command->args, sizeof(char *) * (arg_index + 1));
-    command->args[arg_index] = (char *)malloc(len + 1);
-    strcpy(command->args[arg_index++], arg);
+    cur->args[n++] = arg;
   }
-  command->arg_count = arg_index;
-
-  // increase args size by 2
-  command->args = (char **)realloc(command->args,
-                                   sizeof(char *) * (command->arg_count += 2));
-
-  // shift everything forward by 1
-  for (int i = command->arg_count - 2; i > 0; --i)
-    command->args[i] = command->args[i - 1];
 
-  // set args[0] as a copy of name
-  command->args[0] = strdup(command->name);
-  // set args[arg_count-1] (last) to NULL
-  command->args[command->arg_count - 1] = NULL;
+  // Son aşamayı kapat: args[0] = name, son eleman NULL (execv için)
+  if (n == 0)
+    cur->args[n++] = end; // boş satır: isim ""
+  cur->args[n] = NULL;
+  cur->arg_count = n + 1;
+  cur->name = cur->args[0];
+  cur->auto_complete = auto_complete;
+  cur->background = background;
 
   return 0;
 }
 
-void prompt_backspace()
+int parse_command(char *buf, struct command_t *command)
 {
-  putchar(8);   // go back 1
-  putchar(' '); // write empty over
-  putchar(8);   // go back 1 again
+  return parse_command_in(&line_arena, buf, command);
 }
 
-/**
- * Prompt a command from the user
- * @param  buf      [description]
- * @param  buf_size [description]
- * @return          [description]
+/*
+ * ===== Kalıcı komut geçmişi =====
+ * Dosya: $SHELLISH_HISTFILE (boşsa kapalı), yoksa ~/.shellish_history.
+ * Satır başına bir komut. Birden çok oturum aynı dosyayı paylaşır:
+ * - Ekleme: O_APPEND + flock(LOCK_EX) altında tek write()
+ * - Okuma : dosya mmap edilir ve bir satır-offset index'i kurulur. Index ilk
+ *   kullanımda (ok tuşu, Ctrl-R, history) kurulur, başlangıçta dosya hiç
+ *   taranmaz. Sonraki kullanımlarda sadece dosyanın büyüyen kuyruğu
+ *   indexlenir (diğer oturumların komutları da böylece görünür).
+ * Her entry için içinde geçen byte'ların 64 bitlik bir özeti (sig) tutulur:
+ * Ctrl-R araması çoğu entry'yi memmem'e girmeden tek AND ile eler.
+ * Dosya HIST_TRIM_SIZE'ı aşarsa açılışta son HIST_KEEP entry'ye kırpılır
+ * (geçici dosya + rename; eklerken inode kontrolü yapılır).
  */
-int prompt(struct command_t *command)
+#define HIST_TRIM_SIZE (64 << 20) // bu boyutu aşan dosya açılışta kırpılır
+#define HIST_KEEP 500000          // kırpınca tutulacak entry sayısı
+#define HIST_SEARCH_MAX 256       // Ctrl-R sorgusunun en büyük uzunluğu
+
+struct history
 {
-  int index = 0;
-  char c;
-  char buf[4096];
-  static char oldbuf[4096];
+  char *path;     // geçmiş dosyası (NULL: kapalı)
+  char *map;      // dosyanın mmap'i (salt okunur)
+  size_t map_len; // haritalanan uzunluk
+  dev_t dev;      // haritanın ait olduğu dosya (kırpılıp
+  ino_t ino;      // yenisiyle değiştirilirse baştan yüklenir)
+  size_t *off;    // entry i: map[off[i] .. off[i+1]-1) ('\n' hariç)
+  uint64_t *sig;  // entry'de geçen byte'ların özeti (arama filtresi)
+  size_t n;       // entry sayısı (off'ta n+1 eleman var)
+  size_t cap;     // off/sig kapasitesi
+  char *last;     // bu oturumda eklenen son satır (ardışık tekrar eklenmez)
+};
 
-  // tcgetattr gets the parameters of the current terminal
-  // STDIN_FILENO will tell tcgetattr that it should write the settings
-  // of stdin to oldt
-  static struct termios backup_termios, new_termios;
-  tcgetattr(STDIN_FILENO, &backup_termios);
-  new_termios = backup_termios;
-  // ICANON normally takes care that one line at a time will be processed
-  // that means it will return if it sees a "\n" or an EOF or an EOL
-  new_termios.c_lflag &=
-      ~(ICANON |
-        ECHO); // Also disable automatic echo. We manually echo each char.
-  // Those new settings will be set to STDIN
-  // TCSANOW tells tcsetattr to change attributes immediately.
-  tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
+static struct history hist;
 
-  show_prompt();
-  buf[0] = 0;
-  while (1)
-  {
-    c = getchar();
-    // printf("Keycode: %u\n", c); // DEBUG: uncomment for debugging
+// Byte özeti: her byte 64 bitten birini işaretler (c & 63)
+static uint64_t hist_sig(const char *p, size_t len)
+{
+  uint64_t s = 0;
+  for (size_t i = 0; i < len; i++)
+    s |= 1ULL << ((unsigned char)p[i] & 63);
+  return s;
+}
+
+// i. entry'yi döndürür (sonunda '\0' yok, uzunluk *len)
+static const char *hist_entry(size_t i, size_t *len)
+{
+  *len = hist.off[i + 1] - hist.off[i] - 1;
+  return hist.map + hist.off[i];
+}
 
-    if (c == 9) // handle tab
+// Haritanın indexlenmemiş kuyruğundaki tam satırları index'e ekler
+static void hist_index_tail(void)
+{
+  const char *p = hist.map + hist.off[hist.n];
+  const char *end = hist.map + hist.map_len;
+  const char *nl;
+  while (p < end && (nl = memchr(p, '\n', end - p)) != NULL)
+  {
+    if (hist.n + 2 > hist.cap)
     {
-      buf[index++] = '?'; // autocomplete
-      break;
+      size_t ncap = hist.cap * 2;
+      size_t *noff = realloc(hist.off, ncap * sizeof(size_t));
+      if (noff == NULL)
+        return;
+      hist.off = noff;
+      uint64_t *nsig = realloc(hist.sig, ncap * sizeof(uint64_t));
+      if (nsig == NULL)
+        return;
+      hist.sig = nsig;
+      hist.cap = ncap;
     }
+    hist.sig[hist.n] = hist_sig(p, nl - p);
+    hist.off[++hist.n] = (size_t)(nl + 1 - hist.map);
+    p = nl + 1;
+  }
+}
 
-    if (c == 127) // handle backspace
+// Index'i dosyanın şu anki haliyle eşitler. Aynı dosya büyüdüyse sadece
+// yeni kısım indexlenir; dosya değiştiyse (kırpma) baştan kurulur.
+// LOCK_SH: yazan bir oturumun yarım satırı görülmesin. Hata: -1.
+static int hist_refresh(void)
+{
+  if (hist.path == NULL || hist.off == NULL)
+    return -1;
+  int fd = open(hist.path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  flock(fd, LOCK_SH);
+  struct stat st;
+  int ret = -1;
+  if (fstat(fd, &st) == 0)
+  {
+    size_t size = (size_t)st.st_size;
+    if (hist.map != NULL && (st.st_dev != hist.dev || st.st_ino != hist.ino || size < hist.map_len))
+    { // başka dosya (kırpıldı) veya küçüldü: baştan
+      munmap(hist.map, hist.map_len);
+      hist.map = NULL;
+      hist.map_len = 0;
+      hist.n = 0;
+    }
+    ret = 0;
+    if (size > hist.map_len)
     {
-      if (index > 0)
+      void *m = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+      if (m == MAP_FAILED)
+        ret = -1;
+      else
       {
-        prompt_backspace();
-        index--;
+        if (hist.map != NULL)
+          munmap(hist.map, hist.map_len);
+        hist.map = m;
+        hist.map_len = size;
+        hist.dev = st.st_dev;
+        hist.ino = st.st_ino;
+        hist_index_tail();
       }
-      continue;
     }
+  }
+  flock(fd, LOCK_UN);
+  close(fd);
+  return ret;
+}
 
-    if (c == 27 || c == 91 || c == 66 || c == 67 || c == 68)
-    {
-      continue;
-    }
+// Dosya çok büyüdüyse son HIST_KEEP entry'yi yeni bir dosyaya yazıp yerine
+// koyar. Kilit eski dosyada tutulur; bekleyen ekleyiciler inode'un
+// değiştiğini görüp yeni dosyayı açar.
+static void hist_trim(void)
+{
+  int fd = open(hist.path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return;
+  flock(fd, LOCK_EX);
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= HIST_TRIM_SIZE)
+    goto out;
+  char *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (m == MAP_FAILED)
+    goto out;
+
+  // Sondan HIST_KEEP satır geri git
+  size_t start = st.st_size - 1; // son '\n'yi sayma
+  for (int i = 0; i < HIST_KEEP && start > 0; i++)
+  {
+    char *nl = memrchr(m, '\n', start);
+    start = nl != NULL ? (size_t)(nl - m) : 0;
+  }
+  if (start > 0)
+    start++; // '\n'den sonrası
 
-    if (c == 65) // up arrow
+  size_t tlen = strlen(hist.path) + 32;
+  char *tmp = malloc(tlen);
+  if (tmp != NULL)
+  {
+    snprintf(tmp, tlen, "%s.tmp%d", hist.path, (int)getpid());
+    int tfd = open(tmp, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+    size_t off = start;
+    while (tfd >= 0 && off < (size_t)st.st_size)
     {
-      while (index > 0)
-      {
-        prompt_backspace();
-        index--;
-      }
-
-      char tmpbuf[4096];
-      printf("%s", oldbuf);
-      strcpy(tmpbuf, buf);
-      strcpy(buf, oldbuf);
-      strcpy(oldbuf, tmpbuf);
-      index += strlen(buf);
-      continue;
+      ssize_t w = write(tfd, m + off, st.st_size - off);
+      if (w <= 0)
+        break;
+      off += w;
     }
-
-    putchar(c); // echo the character
-    buf[index++] = c;
-    if (index >= sizeof(buf) - 1)
-      break;
-    if (c == '\n') // enter key
-      break;
-    if (c == 4) // Ctrl+D
-      return EXIT;
+    if (tfd >= 0 && close(tfd) == 0 && off == (size_t)st.st_size)
+      rename(tmp, hist.path);
+    else
+      unlink(tmp);
+    free(tmp);
   }
-  if (index > 0 && buf[index - 1] == '\n') // trim newline from the end
-    index--;
-  buf[index++] = '\0'; // null terminate string
+  munmap(m, st.st_size);
+out:
+  flock(fd, LOCK_UN);
+  close(fd);
+}
 
-  strcpy(oldbuf, buf);
+// Etkileşimli mod açılışında çağrılır: dosya yolunu belirler, gerekirse
+// kırpar. Dosya burada okunmaz (index ilk kullanımda kurulur).
+void hist_init(void)
+{
+  const char *env = getenv("SHELLISH_HISTFILE");
+  if (env != NULL)
+  {
+    if (env[0] == '\0')
+      return; // boş: geçmiş kapalı
+    hist.path = strdup(env);
+  }
+  else
+  {
+    const char *home = getenv("HOME");
+    if (home == NULL)
+      return;
+    size_t len = strlen(home) + 32;
+    hist.path = malloc(len);
+    if (hist.path != NULL)
+      snprintf(hist.path, len, "%s/.%s_history", home, sysname);
+  }
+  if (hist.path == NULL)
+    return;
+  hist.cap = 1024;
+  hist.off = malloc(hist.cap * sizeof(size_t));
+  hist.sig = malloc(hist.cap * sizeof(uint64_t));
+  if (hist.off == NULL || hist.sig == NULL)
+  {
+    free(hist.off);
+    free(hist.sig);
+    free(hist.path);
+    memset(&hist, 0, sizeof(hist));
+    return;
+  }
+  hist.off[0] = 0;
+  hist_trim();
+}
 
-  parse_command(buf, command);
+// Satırı geçmiş dosyasının sonuna ekler (boş satır ve ardışık tekrar hariç)
+void hist_add(const char *line)
+{
+  size_t len = strlen(line);
+  if (hist.path == NULL || len == 0 || (hist.last != NULL && strcmp(hist.last, line) == 0))
+    return;
+  free(hist.last);
+  hist.last = strdup(line);
+
+  struct iovec iov[2] = {{(void *)line, len}, {"\n", 1}};
+  for (int tries = 0; tries < 3; tries++)
+  {
+    int fd = open(hist.path, O_WRONLY | O_APPEND | O_CREAT | O_CLOEXEC, 0600);
+    if (fd < 0)
+      return;
+    flock(fd, LOCK_EX);
+    // Kilidi beklerken dosya kırpılıp değiştirildiyse yenisine yaz
+    struct stat a, b;
+    bool current = fstat(fd, &a) == 0 && stat(hist.path, &b) == 0 &&
+                   a.st_dev == b.st_dev && a.st_ino == b.st_ino;
+    if (current)
+    {
+      ssize_t w = writev(fd, iov, 2); // tek write: satır bölünmez
+      (void)w;
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+    if (current)
+      return;
+  }
+}
 
-  // print_command(command); // DEBUG: uncomment for debugging
+// from'dan (dahil) geriye doğru q'yu içeren ilk entry, yoksa -1
+static long hist_search(const char *q, size_t qlen, long from)
+{
+  uint64_t qs = hist_sig(q, qlen);
+  for (long i = from; i >= 0; i--)
+  {
+    if ((hist.sig[i] & qs) != qs)
+      continue; // sorgudaki bir byte bu entry'de hiç yok
+    size_t len;
+    const char *e = hist_entry(i, &len);
+    if (memmem(e, len, q, qlen) != NULL)
+      return i;
+  }
+  return -1;
+}
 
-  // restore the old settings
-  tcsetattr(STDIN_FILENO, TCSANOW, &backup_termios);
+// history builtin: geçmişi numaralı listeler
+// history      -> tüm entry'ler
+// history N    -> son N entry
+int run_history_builtin(struct command_t *command)
+{
+  if (hist_refresh() != 0)
+  {
+    if (hist.path == NULL)
+      printf("-%s: history: history is off\n", sysname);
+    return hist.path == NULL ? UNKNOWN : SUCCESS; // dosya henüz yok: boş
+  }
+  size_t first = 0;
+  if (command->args[1] != NULL)
+  {
+    long n = atol(command->args[1]);
+    if (n >= 0 && (size_t)n < hist.n)
+      first = hist.n - n;
+  }
+  for (size_t i = first; i < hist.n; i++)
+  {
+    size_t len;
+    const char *e = hist_entry(i, &len);
+    printf("%5zu  %.*s\n", i + 1, (int)len, e);
+  }
+  fflush(stdout);
   return SUCCESS;
 }
+
 /*
- * Bu fonksiyon, kullanıcıdan gelen komutun çalıştırılabilir dosya yolunu bulur.
- *
- * Amaç:
- * - Eğer komut zaten bir path içeriyorsa (örn: /bin/ls veya ./a.out),
- *   doğrudan onun çalıştırılabilir olup olmadığını kontrol etmek
- * - Eğer komut sadece isim olarak geldiyse (örn: ls),
- *   PATH ortam değişkenindeki klasörlerin içinde sırayla aramak
- *
- * Dönüş değeri:
- * - Komut bulunursa çalıştırılabilir dosyanın tam yolunu döndürür
- *   (örn: /usr/bin/ls)
- * - Bulunamazsa NULL döndürür
+ * ===== Tab tamamlama =====
+ * Komut adları: PATH klasörlerindeki çalıştırılabilir dosyalar ve builtin
+ * isimleri tek bir prefix trie'de tutulur. Trie ilk tamamlamada kurulur;
+ * sonrakilerde sadece PATH klasörlerinin mtime'ı kontrol edilir. Değişen
+ * klasör yeniden okunur, eski ve yeni isim listesi karşılaştırılır ve trie'ye
+ * sadece farklar uygulanır. Her düğüm alt ağacındaki isim sayısını tuttuğu
+ * için "tek eşleşme mi / ortak prefix ne" sorusu prefix uzunluğunda cevaplanır.
  *
- * Not:
- * - Dönen string dinamik olarak ayrılmıştır (malloc / strdup).
- * - İş bittikten sonra free() ile serbest bırakılmalıdır.
+ * Dosya yolları: klasör getdents64 ile büyük buffer'larla okunur, isimler
+ * sıralanıp cache'lenir (mtime değişene kadar). Prefix'e uyan isimler sıralı
+ * dizide bitişik olduğundan aralık binary search ile, ortak prefix de aralığın
+ * ilk ve son ismiyle bulunur.
  */
-char *resolve_executable_path(const char *cmd)
+#define COMP_FILE_CACHE 8   // cache'lenen klasör sayısı (LRU)
+#define COMP_LIST_MAX 256   // listelenen en fazla aday
+#define COMP_DENTS_BUF 65536 // getdents64 buffer'ı
+
+// Klasördeki tüm isimler (sıralı)
+struct comp_ent
 {
-  // Eğer komut NULL ise veya boş string ise arama yapamayız.
-  if (cmd == NULL || strlen(cmd) == 0)
-    return NULL;
+  uint32_t off;       // isim, names içindeki offset
+  unsigned char type; // d_type (DT_DIR, DT_REG, DT_LNK, DT_UNKNOWN, ...)
+};
 
-  // Eğer komutun içinde '/' karakteri varsa, bu komut büyük ihtimalle
-  // zaten bir path olarak verilmiştir. (/bin/ls, ./program, ../test/a.out)
-  if (strchr(cmd, '/'))
-  {
-    // access(..., X_OK) dosyanın çalıştırılabilir olup olmadığını kontrol eder.
-    if (access(cmd, X_OK) == 0)
-      // Çalıştırılabiliyorsa bu path'in bir kopyasını döndür.
-      return strdup(cmd);
+struct comp_dir
+{
+  char *path;            // klasör
+  struct timespec mtime; // okunduğu andaki mtime (tv_sec -1: okunmadı)
+  char *names;           // '\0' ile ayrılmış isimler
+  struct comp_ent *ents; // strcmp sırasında
+  size_t n;
+  uint64_t used; // LRU sayacı
+};
 
-    // Çalıştırılamıyorsa bulunamadı gibi davran.
-    return NULL;
-  }
+// Trie düğümü. Kardeşler c'ye göre sıralı; index 0 köktür.
+struct comp_node
+{
+  uint32_t child;   // ilk çocuk (0: yok)
+  uint32_t sibling; // sonraki kardeş (0: yok)
+  uint32_t count;   // alt ağaçtaki isim sayısı (kendisi dahil)
+  uint16_t refs;    // bu ismi sağlayan kaynak sayısı (PATH klasörü / builtin)
+  unsigned char c;
+};
 
-  // PATH ortam değişkenini al.
-  // PATH içinde komutların aranacağı klasörler bulunur.
-  // Örnek:
-  // /usr/local/bin:/usr/bin:/bin
-  char *path_env = getenv("PATH");
+// Tamamlama sonucu
+struct comp_result
+{
+  size_t n;                // eşleşen isim sayısı
+  char lcp[NAME_MAX + 1];  // eşleşmelerin ortak prefix'i
+  size_t lcp_len;
+  bool dir;                // tek eşleşme bir klasör: '/' eklenir
+  uint32_t node;           // komut adı: prefix'in trie düğümü
+  struct comp_dir *d;      // dosya yolu: klasör cache'i
+  size_t lo, hi;           // d içinde prefix'e uyan aralık
+  size_t hid_lo, hid_hi;   // prefix boşken atlanan gizli dosyalar
+};
 
-  // Eğer PATH yoksa arama yapamayız.
+// Shell'in kendi komutları (PATH'te olmasalar da tamamlanır)
+static const char *const builtin_names[] = {
+    "bg", "cat", "cd", "chatroom", "chatroom-bench", "cut", "exit", "fg",
+    "hash", "help", "history", "jobs", "parallel", "repeat", "spawnmode", "tee",
+    "trace", "wait"};
+
+static struct comp_node *comp_trie = NULL;
+static uint32_t comp_trie_n = 0, comp_trie_cap = 0;
+static char *comp_path_env = NULL;           // trie'nin ait olduğu PATH
+static struct comp_dir *comp_path_dirs = NULL; // PATH klasörleri (sadece çalıştırılabilirler)
+static size_t comp_npath_dirs = 0;
+static struct comp_dir comp_files[COMP_FILE_CACHE]; // dosya yolu cache'i
+static uint64_t comp_clock = 0;
+
+struct comp_dirent64 // getdents64'ün döndürdüğü kayıt
+{
+  uint64_t d_ino;
+  int64_t d_off;
+  unsigned short d_reclen;
+  unsigned char d_type;
+  char d_name[];
+};
+
+static int comp_ent_cmp(const void *a, const void *b, void *names)
+{
+  return strcmp((char *)names + ((const struct comp_ent *)a)->off,
+                (char *)names + ((const struct comp_ent *)b)->off);
+}
+
+static const char *comp_name(const struct comp_dir *d, size_t i)
+{
+  return d->names + d->ents[i].off;
+}
+
+static void comp_dir_free(struct comp_dir *d)
+{
+  free(d->names);
+  free(d->ents);
+  d->names = NULL;
+  d->ents = NULL;
+  d->n = 0;
+}
+
+/*
+ * d->path klasörünü okur ve isimleri sıralar ("." ve ".." hariç).
+ * exec_only: sadece çalıştırılabilir dosyalar (PATH klasörleri için).
+ * Başarıda eski liste bırakılır ve d güncellenir. Hata: -1 (d değişmez).
+ */
+static int comp_scan(struct comp_dir *d, bool exec_only)
+{
+  static char buf[COMP_DENTS_BUF];
+  int fd = open(d->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+  if (fd < 0)
+    return -1;
+  struct stat st;
+  if (fstat(fd, &st) != 0) // mtime okumadan önce: arada değişirse sonra tekrar okunur
+  {
+    close(fd);
+    return -1;
+  }
+
+  char *names = NULL;
+  struct comp_ent *ents = NULL;
+  size_t nlen = 0, ncap = 0, n = 0, cap = 0;
+  long r;
+  while ((r = syscall(SYS_getdents64, fd, buf, sizeof(buf))) > 0)
+  {
+    for (long pos = 0; pos < r;)
+    {
+      struct comp_dirent64 *e = (struct comp_dirent64 *)(buf + pos);
+      pos += e->d_reclen;
+      const char *nm = e->d_name;
+      if (nm[0] == '.' && (nm[1] == '\0' || (nm[1] == '.' && nm[2] == '\0')))
+        continue;
+      unsigned char type = e->d_type;
+      if (exec_only)
+      {
+        if (type == DT_DIR || faccessat(fd, nm, X_OK, 0) != 0)
+          continue;
+        struct stat est; // link/bilinmeyen: klasörü gösteriyor olabilir
+        if (type != DT_REG && (fstatat(fd, nm, &est, 0) != 0 || S_ISDIR(est.st_mode)))
+          continue;
+      }
+      size_t len = strlen(nm) + 1;
+      if (nlen + len > ncap || n == cap)
+      {
+        size_t nc = ncap ? ncap : 4096, ec = cap ? cap : 256;
+        while (nc < nlen + len)
+          nc *= 2;
+        if (n == cap)
+          ec *= 2;
+        char *nn = realloc(names, nc);
+        struct comp_ent *ne = nn ? realloc(ents, ec * sizeof(*ents)) : NULL;
+        if (nn)
+          names = nn;
+        if (ne == NULL)
+        {
+          free(names);
+          free(ents);
+          close(fd);
+          return -1;
+        }
+        ents = ne;
+        ncap = nc;
+        cap = ec;
+      }
+      memcpy(names + nlen, nm, len);
+      ents[n].off = (uint32_t)nlen;
+      ents[n].type = type;
+      n++;
+      nlen += len;
+    }
+  }
+  close(fd);
+  if (r < 0)
+  {
+    free(names);
+    free(ents);
+    return -1;
+  }
+
+  qsort_r(ents, n, sizeof(*ents), comp_ent_cmp, names);
+  comp_dir_free(d);
+  d->names = names;
+  d->ents = ents;
+  d->n = n;
+  d->mtime = st.st_mtim;
+  return 0;
+}
+
+// Klasör değişmediyse true (stat edilemiyorsa da değişmiş sayılır)
+static bool comp_dir_fresh(const struct comp_dir *d)
+{
+  struct stat st;
+  return stat(d->path, &st) == 0 && st.st_mtim.tv_sec == d->mtime.tv_sec &&
+         st.st_mtim.tv_nsec == d->mtime.tv_nsec;
+}
+
+// Düğümün c harfli çocuğunu bulur; create ise yoksa ekler. Yok: 0.
+static uint32_t comp_trie_child(uint32_t parent, unsigned char c, bool create)
+{
+  uint32_t prev = 0, cur = comp_trie[parent].child;
+  while (cur != 0 && comp_trie[cur].c < c)
+  {
+    prev = cur;
+    cur = comp_trie[cur].sibling;
+  }
+  if (cur != 0 && comp_trie[cur].c == c)
+    return cur;
+  if (!create)
+    return 0;
+
+  if (comp_trie_n == comp_trie_cap)
+  {
+    uint32_t nc = comp_trie_cap ? comp_trie_cap * 2 : 4096;
+    struct comp_node *nt = realloc(comp_trie, nc * sizeof(*nt));
+    if (nt == NULL)
+      return 0;
+    comp_trie = nt;
+    comp_trie_cap = nc;
+  }
+  uint32_t k = comp_trie_n++;
+  memset(&comp_trie[k], 0, sizeof(comp_trie[k]));
+  comp_trie[k].c = c;
+  comp_trie[k].sibling = cur; // sıralı yere ekle
+  if (prev != 0)
+    comp_trie[prev].sibling = k;
+  else
+    comp_trie[parent].child = k;
+  return k;
+}
+
+// İsmin kaynak sayısını delta kadar değiştirir; isim görünür/görünmez
+// olduysa yol üzerindeki sayaçları günceller. Düğümler silinmez.
+static void comp_trie_update(const char *name, int delta)
+{
+  uint32_t k = 0;
+  for (const unsigned char *p = (const unsigned char *)name; *p && k != UINT32_MAX; p++)
+  {
+    k = comp_trie_child(k, *p, delta > 0);
+    if (k == 0)
+      return; // silinecek isim yok (ya da bellek yetmedi)
+  }
+  uint16_t old = comp_trie[k].refs;
+  if (delta < 0 && old == 0)
+    return;
+  comp_trie[k].refs = old + delta;
+  int live = (old == 0) - (comp_trie[k].refs == 0); // +1 eklendi, -1 silindi
+  if (live == 0)
+    return;
+  k = 0;
+  comp_trie[0].count += live;
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+  {
+    k = comp_trie_child(k, *p, false);
+    comp_trie[k].count += live;
+  }
+}
+
+// Bir PATH klasörünün eski ve yeni listesi arasındaki farkı trie'ye uygular
+static void comp_trie_diff(const struct comp_dir *old, const struct comp_dir *cur)
+{
+  size_t i = 0, j = 0, on = old ? old->n : 0, cn = cur ? cur->n : 0;
+  while (i < on || j < cn)
+  {
+    int cmp = i == on ? 1 : j == cn ? -1 : strcmp(comp_name(old, i), comp_name(cur, j));
+    if (cmp < 0)
+      comp_trie_update(comp_name(old, i++), -1); // klasörden silinmiş
+    else if (cmp > 0)
+      comp_trie_update(comp_name(cur, j++), 1); // yeni eklenmiş
+    else
+      i++, j++;
+  }
+}
+
+// Trie'yi PATH ile eşitler: ilk çağrıda kurar, sonra sadece değişen
+// klasörleri yeniden okur. PATH'in kendisi değiştiyse klasör listesi
+// güncellenir (aynı kalan klasörler yeniden okunmaz).
+static void comp_path_refresh(void)
+{
+  if (comp_trie == NULL)
+  {
+    comp_trie_cap = 4096;
+    comp_trie = calloc(comp_trie_cap, sizeof(*comp_trie));
+    if (comp_trie == NULL)
+      return;
+    comp_trie_n = 1; // kök
+    for (size_t i = 0; i < sizeof(builtin_names) / sizeof(builtin_names[0]); i++)
+      comp_trie_update(builtin_names[i], 1);
+  }
+
+  const char *path_env = getenv("PATH");
   if (path_env == NULL)
-    return NULL;
+    path_env = "";
+  if (comp_path_env == NULL || strcmp(comp_path_env, path_env) != 0)
+  {
+    char *copy = strdup(path_env);
+    size_t cap = 1;
+    for (const char *p = path_env; *p; p++)
+      cap += *p == ':';
+    struct comp_dir *dirs = calloc(cap, sizeof(*dirs));
+    if (copy == NULL || dirs == NULL)
+    {
+      free(copy);
+      free(dirs);
+      return;
+    }
+    size_t n = 0;
+    for (char *save, *dir = strtok_r(copy, ":", &save); dir; dir = strtok_r(NULL, ":", &save))
+    {
+      struct comp_dir *d = &dirs[n];
+      for (size_t i = 0; i < comp_npath_dirs && d->path == NULL; i++)
+        if (comp_path_dirs[i].path != NULL && strcmp(comp_path_dirs[i].path, dir) == 0)
+        {
+          *d = comp_path_dirs[i]; // listesiyle birlikte taşı
+          comp_path_dirs[i].path = NULL;
+        }
+      if (d->path == NULL)
+      {
+        d->path = strdup(dir);
+        d->mtime.tv_sec = -1; // aşağıda okunacak
+        if (d->path == NULL)
+          continue;
+      }
+      n++;
+    }
+    for (size_t i = 0; i < comp_npath_dirs; i++) // PATH'ten çıkan klasörler
+    {
+      if (comp_path_dirs[i].path == NULL)
+        continue;
+      comp_trie_diff(&comp_path_dirs[i], NULL);
+      comp_dir_free(&comp_path_dirs[i]);
+      free(comp_path_dirs[i].path);
+    }
+    free(comp_path_dirs);
+    free(comp_path_env);
+    comp_path_dirs = dirs;
+    comp_npath_dirs = n;
+    comp_path_env = strdup(path_env);
+    free(copy);
+  }
 
-  // strtok string'i değiştirdiği için PATH'in direkt kendisini parçalamıyoruz.
-  // Önce bir kopyasını alıyoruz.
-  char *path_copy = strdup(path_env);
+  for (size_t i = 0; i < comp_npath_dirs; i++)
+  {
+    struct comp_dir *d = &comp_path_dirs[i];
+    if (d->mtime.tv_sec != -1 && comp_dir_fresh(d))
+      continue;
+    struct comp_dir old = *d;
+    d->names = NULL;
+    d->ents = NULL;
+    d->n = 0;
+    if (comp_scan(d, true) != 0)
+      d->mtime.tv_sec = -1; // okunamadı (yok/izin yok): listesi boş
+    comp_trie_diff(&old, d);
+    comp_dir_free(&old);
+  }
+}
+
+// Dosya yolu tamamlaması için klasörün güncel listesi (LRU cache'ten)
+static struct comp_dir *comp_files_get(const char *path)
+{
+  struct comp_dir *d = NULL, *victim = &comp_files[0];
+  for (int i = 0; i < COMP_FILE_CACHE; i++)
+  {
+    if (comp_files[i].path != NULL && strcmp(comp_files[i].path, path) == 0)
+      d = &comp_files[i];
+    if (comp_files[i].used < victim->used)
+      victim = &comp_files[i];
+  }
+  if (d == NULL)
+  {
+    d = victim; // en uzun süredir kullanılmayanı at
+    comp_dir_free(d);
+    free(d->path);
+    d->path = strdup(path);
+    d->mtime.tv_sec = -1;
+    if (d->path == NULL)
+      return NULL;
+  }
+  d->used = ++comp_clock;
+  if (d->mtime.tv_sec == -1 || !comp_dir_fresh(d))
+  {
+    if (comp_scan(d, false) != 0)
+    {
+      comp_dir_free(d);
+      d->mtime.tv_sec = -1;
+      return NULL;
+    }
+  }
+  return d;
+}
+
+// Sıralı listede prefix'le başlayan ilk isim (upper: prefix'ten büyük ilk isim)
+static size_t comp_bound(const struct comp_dir *d, const char *prefix, size_t len, bool upper)
+{
+  size_t lo = 0, hi = d->n;
+  while (lo < hi)
+  {
+    size_t mid = lo + (hi - lo) / 2;
+    int cmp = strncmp(comp_name(d, mid), prefix, len);
+    if (cmp < 0 || (upper && cmp == 0))
+      lo = mid + 1;
+    else
+      hi = mid;
+  }
+  return lo;
+}
+
+// Komut adı tamamlaması: prefix'in düğümünden tek yollu zinciri izler
+static void comp_command(const char *word, size_t len, struct comp_result *res)
+{
+  comp_path_refresh();
+  res->node = UINT32_MAX;
+  if (comp_trie == NULL || len > NAME_MAX)
+    return;
+  uint32_t k = 0;
+  for (size_t i = 0; i < len; i++)
+    if ((k = comp_trie_child(k, (unsigned char)word[i], false)) == 0)
+      return;
+  res->node = k;
+  res->n = comp_trie[k].count;
+  memcpy(res->lcp, word, len);
+  res->lcp_len = len;
+  // Ortak prefix: isim bitmeyen ve tek canlı çocuğu olan düğümler boyunca
+  while (res->n > 0 && comp_trie[k].refs == 0 && res->lcp_len < NAME_MAX)
+  {
+    uint32_t only = 0;
+    int live = 0;
+    for (uint32_t ch = comp_trie[k].child; ch != 0 && live < 2; ch = comp_trie[ch].sibling)
+      if (comp_trie[ch].count > 0)
+      {
+        only = ch;
+        live++;
+      }
+    if (live != 1)
+      break;
+    k = only;
+    res->lcp[res->lcp_len++] = (char)comp_trie[k].c;
+  }
+}
+
+// Dosya yolu tamamlaması: dir klasöründe base ile başlayan isimler.
+// base boşsa '.' ile başlayan gizli dosyalar atlanır.
+static void comp_file(const char *dir, const char *base, size_t len, struct comp_result *res)
+{
+  struct comp_dir *d = comp_files_get(dir);
+  if (d == NULL)
+    return;
+  res->d = d;
+  res->lo = comp_bound(d, base, len, false);
+  res->hi = comp_bound(d, base, len, true);
+  res->hid_lo = res->hid_hi = res->lo;
+  if (len == 0)
+  {
+    res->hid_lo = comp_bound(d, ".", 1, false);
+    res->hid_hi = comp_bound(d, ".", 1, true);
+  }
+  res->n = (res->hi - res->lo) - (res->hid_hi - res->hid_lo);
+  if (res->n == 0)
+    return;
+
+  // Sıralı bir kümenin ortak prefix'i ilk ve son elemanınınkidir
+  size_t first = res->lo == res->hid_lo ? res->hid_hi : res->lo;
+  size_t last = res->hi == res->hid_hi ? res->hid_lo - 1 : res->hi - 1;
+  const char *a = comp_name(d, first), *b = comp_name(d, last);
+  size_t l = 0;
+  while (a[l] != '\0' && a[l] == b[l])
+    l++;
+  memcpy(res->lcp, a, l);
+  res->lcp_len = l;
+
+  if (res->n == 1)
+  {
+    unsigned char type = d->ents[first].type;
+    if (type == DT_DIR)
+      res->dir = true;
+    else if (type == DT_LNK || type == DT_UNKNOWN)
+    { // link'in klasörü gösterip göstermediğine bak
+      int dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      struct stat st;
+      res->dir = dfd >= 0 && fstatat(dfd, a, &st, 0) == 0 && S_ISDIR(st.st_mode);
+      if (dfd >= 0)
+        close(dfd);
+    }
+  }
+}
+
+/*
+ * Kelimeyi tamamlar. Komut konumundaki ('/' içermeyen) kelimeler komut
+ * adı olarak, diğerleri dosya yolu olarak tamamlanır.
+ * Dönüş: kelimede tamamlanan son bileşenin başlangıcı (word + return).
+ */
+static size_t comp_word(const char *word, size_t len, bool cmdpos, struct comp_result *res)
+{
+  memset(res, 0, sizeof(*res));
+  res->node = UINT32_MAX;
+  if (cmdpos && memchr(word, '/', len) == NULL)
+  {
+    comp_command(word, len, res);
+    return 0;
+  }
+
+  const char *slash = memrchr(word, '/', len);
+  size_t base = slash ? (size_t)(slash - word) + 1 : 0;
+  char dir[PATH_MAX];
+  if (base >= sizeof(dir) || len - base > NAME_MAX)
+    return base;
+  if (base == 0)
+    strcpy(dir, ".");
+  else
+  {
+    memcpy(dir, word, base);
+    dir[base] = '\0';
+  }
+  comp_file(dir, word + base, len - base, res);
+  return base;
+}
+
+// Trie'de node'un altındaki isimleri sırayla toplar (en fazla COMP_LIST_MAX)
+static void comp_trie_collect(uint32_t k, char *name, size_t len, char *blob,
+                              const char **out, size_t *n)
+{
+  if (comp_trie[k].refs > 0 && *n < COMP_LIST_MAX)
+  {
+    char *s = blob + *n * (NAME_MAX + 1);
+    memcpy(s, name, len);
+    s[len] = '\0';
+    out[(*n)++] = s;
+  }
+  for (uint32_t ch = comp_trie[k].child; ch != 0 && *n < COMP_LIST_MAX; ch = comp_trie[ch].sibling)
+    if (comp_trie[ch].count > 0 && len < NAME_MAX)
+    {
+      name[len] = (char)comp_trie[ch].c;
+      comp_trie_collect(ch, name, len + 1, blob, out, n);
+    }
+}
+
+// Adayları terminal genişliğine göre sütunlar halinde basar (ls gibi)
+static void comp_print(const char *prefix, size_t plen, const struct comp_result *res)
+{
+  const char *names[COMP_LIST_MAX];
+  size_t n = 0;
+  char *blob = NULL;
+  if (res->node != UINT32_MAX)
+  {
+    char name[NAME_MAX + 1];
+    blob = malloc((size_t)COMP_LIST_MAX * (NAME_MAX + 1));
+    if (blob == NULL)
+      return;
+    memcpy(name, prefix, plen);
+    comp_trie_collect(res->node, name, plen, blob, names, &n);
+  }
+  else if (res->d != NULL)
+  {
+    for (size_t i = res->lo; i < res->hi && n < COMP_LIST_MAX; i++)
+      if (i < res->hid_lo || i >= res->hid_hi)
+        names[n++] = comp_name(res->d, i);
+  }
+
+  struct winsize ws;
+  size_t width = ioctl(STDOUT_FILENO, TIOCGWINSZ, &ws) == 0 && ws.ws_col > 0 ? ws.ws_col : 80;
+  size_t colw = 1;
+  for (size_t i = 0; i < n; i++)
+    if (strlen(names[i]) + 2 > colw)
+      colw = strlen(names[i]) + 2;
+  size_t cols = width / colw ? width / colw : 1;
+  size_t rows = (n + cols - 1) / cols;
+  for (size_t r = 0; r < rows; r++)
+  {
+    for (size_t c = 0; c < cols; c++)
+    {
+      size_t i = c * rows + r;
+      if (i < n)
+        printf("%-*s", (int)(i + rows < n ? colw : 0), names[i]);
+    }
+    putchar('\n');
+  }
+  if (res->n > n)
+    printf("... and %zu more\n", res->n - n);
+  free(blob);
+}
+
+// Satırdaki kelime komut konumunda mı (satır başı veya '|', ';', '&' sonrası)
+static bool comp_command_position(const char *line, size_t start)
+{
+  while (start > 0 && (line[start - 1] == ' ' || line[start - 1] == '\t'))
+    start--;
+  return start == 0 || line[start - 1] == '|' || line[start - 1] == ';' ||
+         line[start - 1] == '&';
+}
+
+// Satır ayrı bir '?' token'ıyla bitiyorsa (ör: "gi ?", "cat src/ma ?") ondan
+// önceki kelimenin tamamlama adaylarını listeler; komut çalıştırılmaz
+int run_complete_builtin(struct command_t *command)
+{
+  while (command->next != NULL) // son aşamanın '?'tan önceki kelimesi
+    command = command->next;
+  int last = command->arg_count - 3;
+  char *word = last >= 0 ? command->args[last] : "";
+  size_t len = strlen(word);
+
+  struct comp_result res;
+  size_t base = comp_word(word, len, last <= 0, &res);
+  if (res.n == 0)
+  {
+    printf("-%s: %.*s: no completions\n", sysname, (int)len, word);
+    return UNKNOWN;
+  }
+  comp_print(word + base, len - base, &res);
+  fflush(stdout);
+  return SUCCESS;
+}
+
+void prompt_backspace()
+{
+  putchar(8);   // go back 1
+  putchar(' '); // write empty over
+  putchar(8);   // go back 1 again
+}
+
+// Satır buffer'ı: gerektikçe büyür (uzunluk sınırı yok) ve çağrılar
+// arasında tekrar kullanılır
+static char *prompt_buf = NULL;
+static size_t prompt_cap = 0;
+
+// Geçmişte gezinme durumu (her prompt'ta sıfırlanır)
+static bool prompt_hist_ready = false; // bu prompt'ta index güncellendi mi
+static long prompt_hist_pos = 0;       // gösterilen entry (hist.n: yazılan satır)
+static char *prompt_draft = NULL;      // yukarı çıkmadan önce yazılmakta olan satır
+static size_t prompt_draft_len = 0;
+
+// Buffer'da en az n byte yer açar. Hata: -1.
+static int prompt_reserve(size_t n)
+{
+  if (n <= prompt_cap)
+    return 0;
+  size_t cap = prompt_cap ? prompt_cap : 256;
+  while (cap < n)
+    cap *= 2;
+  char *nbuf = realloc(prompt_buf, cap);
+  if (nbuf == NULL)
+    return -1;
+  prompt_buf = nbuf;
+  prompt_cap = cap;
+  return 0;
+}
+
+// Ekrandaki satırı siler, yerine s'yi yazar ve buffer'a kopyalar
+static void prompt_set_line(size_t *index, const char *s, size_t len)
+{
+  while (*index > 0)
+  {
+    prompt_backspace();
+    (*index)--;
+  }
+  if (prompt_reserve(len + 2) != 0)
+    return;
+  memcpy(prompt_buf, s, len);
+  fwrite(s, 1, len, stdout);
+  *index = len;
+}
+
+// Geçmiş index'ini prompt başına bir kez, ilk kullanımda günceller
+static void prompt_hist_load(void)
+{
+  if (prompt_hist_ready)
+    return;
+  prompt_hist_ready = true;
+  hist_refresh();
+  prompt_hist_pos = (long)hist.n;
+}
+
+// Yukarı (dir = -1) / aşağı (dir = +1) ok: geçmişte gezinir. En alttaki
+// konum yazılmakta olan satırdır; yukarı çıkarken saklanır, dönünce gelir.
+static void prompt_history_move(int dir, size_t *index)
+{
+  prompt_hist_load();
+  long np = prompt_hist_pos + dir;
+  if (np < 0 || np > (long)hist.n)
+    return;
+  if (prompt_hist_pos == (long)hist.n)
+  { // yazılan satırı sakla
+    char *d = realloc(prompt_draft, *index + 1);
+    if (d == NULL)
+      return;
+    memcpy(d, prompt_buf, *index);
+    prompt_draft = d;
+    prompt_draft_len = *index;
+  }
+  prompt_hist_pos = np;
+  if (np == (long)hist.n)
+    prompt_set_line(index, prompt_draft, prompt_draft_len);
+  else
+  {
+    size_t len;
+    const char *e = hist_entry(np, &len);
+    prompt_set_line(index, e, len);
+  }
+}
+
+/*
+ * Ctrl-R: artımlı geri arama. Yazılan sorguyu içeren en yeni entry
+ * gösterilir; tekrar Ctrl-R daha eskisine geçer, backspace sorguyu kısaltır.
+ * Ctrl-G vazgeçer (satır eski haline döner). Diğer tuşlar (Enter, oklar, ...)
+ * eşleşmeyi satıra alır; o tuş çağıran tarafından normal işlenir.
+ * Dönüş: aramayı bitiren tuş.
+ */
+static int prompt_search(size_t *index)
+{
+  prompt_hist_load();
+  char q[HIST_SEARCH_MAX];
+  size_t qlen = 0;
+  long match = -1;
+  bool failing = false;
+  int c;
+  while (1)
+  {
+    printf("\r\033[K(%sreverse-i-search)`%.*s': ", failing ? "failing " : "", (int)qlen, q);
+    if (match >= 0)
+    {
+      size_t len;
+      const char *e = hist_entry(match, &len);
+      fwrite(e, 1, len, stdout);
+    }
+    fflush(stdout);
+
+    c = getchar();
+    long m;
+    if (c == 18) // Ctrl-R: bir önceki eşleşme
+    {
+      m = (match > 0 && qlen > 0) ? hist_search(q, qlen, match - 1) : -1;
+      if (m >= 0)
+        match = m;
+      failing = qlen > 0 && m < 0;
+    }
+    else if (c == 127) // backspace: sorguyu kısalt, en yeniden ara
+    {
+      if (qlen > 0)
+        qlen--;
+      match = qlen > 0 ? hist_search(q, qlen, (long)hist.n - 1) : -1;
+      failing = qlen > 0 && match < 0;
+    }
+    else if (c >= 32 && qlen < sizeof(q)) // sorguya ekle, mevcut eşleşmeden devam
+    {
+      q[qlen++] = (char)c;
+      m = hist_search(q, qlen, match >= 0 ? match : (long)hist.n - 1);
+      if (m >= 0)
+        match = m;
+      failing = m < 0;
+    }
+    else if (c < 32 || c == EOF)
+      break;
+  }
+
+  // Arama satırını sil, prompt'u ve (kabul edildiyse eşleşmeyi) yeniden çiz
+  printf("\r\033[K");
+  show_prompt();
+  if (c != 7 && match >= 0)
+  {
+    size_t len;
+    const char *e = hist_entry(match, &len);
+    if (prompt_reserve(len + 2) == 0)
+    {
+      memcpy(prompt_buf, e, len);
+      *index = len;
+      prompt_hist_pos = match; // oklar buradan devam etsin
+    }
+  }
+  fwrite(prompt_buf, 1, *index, stdout);
+  return c;
+}
+
+// Tab: imlecin solundaki kelimeyi tamamlar. Tek eşleşmede kelime bitirilir
+// (klasörse '/', değilse boşluk eklenir); birden çok eşleşmede ortak prefix'e
+// kadar uzatılır, uzatılamıyorsa adaylar listelenip satır yeniden çizilir.
+static void prompt_complete(size_t *index)
+{
+  size_t start = *index;
+  while (start > 0 && prompt_buf[start - 1] != ' ' && prompt_buf[start - 1] != '\t')
+    start--;
+  bool cmdpos = comp_command_position(prompt_buf, start);
+  while (start < *index && (prompt_buf[start] == '<' || prompt_buf[start] == '>'))
+  { // redirect hedefi: dosya yolu
+    start++;
+    cmdpos = false;
+  }
+  const char *word = prompt_buf + start;
+  size_t len = *index - start;
+  struct comp_result res;
+  size_t base = comp_word(word, len, cmdpos, &res);
+  size_t have = len - base; // son bileşenin yazılmış kısmı
+
+  if (res.n == 0)
+  {
+    putchar('\a'); // eşleşme yok
+    return;
+  }
+  if (res.n == 1 || res.lcp_len > have)
+  {
+    size_t add = res.lcp_len - have;
+    if (prompt_reserve(*index + add + 3) != 0)
+      return;
+    memcpy(prompt_buf + *index, res.lcp + have, add);
+    fwrite(res.lcp + have, 1, add, stdout);
+    *index += add;
+    if (res.n == 1)
+    {
+      char end = res.dir ? '/' : ' ';
+      prompt_buf[(*index)++] = end;
+      putchar(end);
+    }
+    return;
+  }
+  putchar('\n');
+  comp_print(word + base, have, &res);
+  show_prompt();
+  fwrite(prompt_buf, 1, *index, stdout);
+}
+
+/**
+ * Prompt a command from the user
+ * @param  buf      [description]
+ * @param  buf_size [description]
+ * @return          [description]
+ */
+int prompt()
+{
+  size_t index = 0;
+  int c;
+  if (prompt_reserve(256) != 0)
+    return EXIT;
+
+  int64_t t_prompt = trace_begin(); // prompt redraw fazı
+
+  // tcgetattr gets the parameters of the current terminal
+  // STDIN_FILENO will tell tcgetattr that it should write the settings
+  // of stdin to oldt
+  static struct termios backup_termios, new_termios;
+  tcgetattr(STDIN_FILENO, &backup_termios);
+  new_termios = backup_termios;
+  // ICANON normally takes care that one line at a time will be processed
+  // that means it will return if it sees a "\n" or an EOF or an EOL
+  new_termios.c_lflag &=
+      ~(ICANON |
+        ECHO); // Also disable automatic echo. We manually echo each char.
+  // Those new settings will be set to STDIN
+  // TCSANOW tells tcsetattr to change attributes immediately.
+  tcsetattr(STDIN_FILENO, TCSANOW, &new_termios);
+
+  show_prompt();
+  if (t_prompt != 0)
+  {
+    fflush(stdout); // redraw ekrana çıkana kadar say
+    trace_span("prompt", t_prompt, 0, NULL);
+  }
+  int64_t t_read = trace_begin(); // kullanıcının satırı yazması
+  prompt_hist_ready = false;      // geçmiş ilk ok/Ctrl-R'de güncellenir
+  prompt_buf[0] = 0;
+  while (1)
+  {
+    c = getchar();
+    // printf("Keycode: %u\n", c); // DEBUG: uncomment for debugging
+
+    if (c == EOF) // terminal kapandı
+    {
+      tcsetattr(STDIN_FILENO, TCSANOW, &backup_termios);
+      return EXIT;
+    }
+
+    if (c == 18) // Ctrl-R: geçmişte artımlı arama
+    {
+      c = prompt_search(&index);
+      if (c == 7 || c == EOF)
+        continue; // Ctrl-G: vazgeçildi
+      // aramayı bitiren tuş (Enter, ok, ...) aşağıda normal işlenir
+    }
+
+    if (c == 9) // handle tab: yerinde tamamla
+    {
+      prompt_complete(&index);
+      continue;
+    }
+
+    if (c == 127) // handle backspace
+    {
+      if (index > 0)
+      {
+        prompt_backspace();
+        index--;
+      }
+      continue;
+    }
+
+    if (c == 27) // ok tuşları: ESC [ A..D (veya ESC O A..D)
+    {
+      int c2 = getchar();
+      if (c2 == '[' || c2 == 'O')
+      {
+        int c3 = getchar();
+        while ((c3 >= '0' && c3 <= '9') || c3 == ';')
+          c3 = getchar(); // ör: ESC [ 3 ~ (Delete), ESC [ 1 ; 5 A
+        if (c3 == 'A') // up arrow: daha eski komut
+          prompt_history_move(-1, &index);
+        else if (c3 == 'B') // down arrow: daha yeni komut
+          prompt_history_move(1, &index);
+        // sağ/sol ok ve diğerleri: satır içi düzenleme yok, yok say
+      }
+      continue;
+    }
+
+    if (prompt_reserve(index + 2) != 0) // karakter + '\0' için yer aç
+      break;
+    putchar(c); // echo the character
+    prompt_buf[index++] = c;
+    if (c == '\n') // enter key
+      break;
+    if (c == 4) // Ctrl+D
+    {
+      tcsetattr(STDIN_FILENO, TCSANOW, &backup_termios);
+      return EXIT;
+    }
+  }
+  bool entered = index > 0 && prompt_buf[index - 1] == '\n';
+  if (entered) // trim newline from the end
+    index--;
+  prompt_buf[index++] = '\0'; // null terminate string
+  trace_span("read", t_read, 0, NULL);
+
+  if (entered)
+    hist_add(prompt_buf); // kalıcı geçmişe ekle (boş/tekrar satırlar hariç)
+
+  // restore the old settings
+  tcsetattr(STDIN_FILENO, TCSANOW, &backup_termios);
+  return SUCCESS;
+}
+
+/*
+ * Komut hash tablosu (bash'teki "hash" gibi).
+ *
+ * Her dış komut resolve_executable_path() çağırıyor ve bu fonksiyon PATH'i
+ * kopyalayıp her klasörde access() deniyor. Uzun bir PATH'te bu komut başına
+ * onlarca syscall demek. Bu tablo "isim -> tam yol" eşlemesini saklar:
+ * - İlk kullanımda doldurulur
+ * - PATH değişirse tamamen boşaltılır
+ * - Kayıt bulunduğunda sadece bulunduğu klasörün mtime'ı kontrol edilir
+ *   (klasör değiştiyse kayıt atılır ve PATH yeniden taranır)
+ */
+#define CMD_HASH_SIZE 256 // bucket sayısı (2'nin kuvveti olmalı)
+
+struct cmd_hash_entry
+{
+  char *name;                  // komut adı (ör: "ls")
+  char *path;                  // çözülmüş tam yol (ör: "/usr/bin/ls")
+  char *dir;                   // komutun bulunduğu PATH klasörü
+  struct timespec dir_mtime;   // klasörün kayıt anındaki mtime'ı
+  int hits;                    // kaç kez kullanıldı (hash builtin'i gösterir)
+  struct cmd_hash_entry *next; // aynı bucket'taki sonraki kayıt
+};
+
+static struct cmd_hash_entry *cmd_hash[CMD_HASH_SIZE]; // bucket dizisi
+static char *cmd_hash_path_env = NULL;                 // tablonun ait olduğu PATH
+
+// FNV-1a ile komut adından bucket indexi hesaplar
+static unsigned cmd_hash_index(const char *name)
+{
+  unsigned h = 2166136261u; // FNV offset basis
+  for (const unsigned char *p = (const unsigned char *)name; *p; p++)
+  {
+    h ^= *p;         // byte'ı karıştır
+    h *= 16777619u;  // FNV prime
+  }
+  return h & (CMD_HASH_SIZE - 1); // bucket sayısına indir
+}
+
+// Tek bir kaydı serbest bırakır
+static void cmd_hash_free_entry(struct cmd_hash_entry *e)
+{
+  free(e->name);
+  free(e->path);
+  free(e->dir);
+  free(e);
+}
+
+void plan_cache_invalidate(void);
+
+// Tablodaki tüm kayıtları siler (hash -r veya PATH değişimi).
+// Plan cache'indeki önceden çözülmüş yollar da geçersiz olur.
+void cmd_hash_clear()
+{
+  plan_cache_invalidate();
+  for (int i = 0; i < CMD_HASH_SIZE; i++)
+  {
+    struct cmd_hash_entry *e = cmd_hash[i];
+    while (e != NULL)
+    {
+      struct cmd_hash_entry *next = e->next; // silmeden önce sonrakini al
+      cmd_hash_free_entry(e);
+      e = next;
+    }
+    cmd_hash[i] = NULL;
+  }
+}
+
+// PATH son doldurmadan beri değiştiyse tabloyu boşaltır
+static void cmd_hash_check_path(const char *path_env)
+{
+  if (cmd_hash_path_env != NULL && strcmp(cmd_hash_path_env, path_env) == 0)
+    return; // PATH aynı, tablo geçerli
+
+  cmd_hash_clear();              // eski PATH'e göre çözülmüş yollar artık yanlış olabilir
+  free(cmd_hash_path_env);       // eski kopyayı bırak
+  cmd_hash_path_env = strdup(path_env); // yeni PATH'i sakla
+}
+
+// Tabloda komutu arar. Klasör değişmediyse tam yolu döndürür, yoksa NULL.
+// Klasör değiştiyse kayıt silinir (çağıran PATH'i yeniden tarar).
+static const char *cmd_hash_lookup(const char *name)
+{
+  unsigned idx = cmd_hash_index(name);
+  struct cmd_hash_entry **pp = &cmd_hash[idx]; // silme için önceki pointer
+
+  while (*pp != NULL)
+  {
+    struct cmd_hash_entry *e = *pp;
+    if (strcmp(e->name, name) == 0)
+    {
+      struct stat st;
+      // Klasörün mtime'ı aynıysa içinde dosya eklenip silinmemiş demektir
+      if (stat(e->dir, &st) == 0 &&
+          st.st_mtim.tv_sec == e->dir_mtime.tv_sec &&
+          st.st_mtim.tv_nsec == e->dir_mtime.tv_nsec)
+      {
+        e->hits++;      // kullanım sayacı
+        return e->path; // cache hit
+      }
+
+      *pp = e->next;          // eskimiş kaydı listeden çıkar
+      cmd_hash_free_entry(e); // ve sil
+      return NULL;
+    }
+    pp = &e->next;
+  }
+  return NULL; // tabloda yok
+}
+
+// Çözülmüş bir yolu tabloya ekler (dir: komutun bulunduğu PATH klasörü)
+static void cmd_hash_insert(const char *name, const char *path, const char *dir)
+{
+  struct stat st;
+  if (stat(dir, &st) != 0)
+    return; // klasörü stat edemiyorsak doğrulayamayız, cache'leme
+
+  struct cmd_hash_entry *e = calloc(1, sizeof(struct cmd_hash_entry));
+  if (e == NULL)
+    return;
+  e->name = strdup(name);
+  e->path = strdup(path);
+  e->dir = strdup(dir);
+  if (e->name == NULL || e->path == NULL || e->dir == NULL)
+  {
+    cmd_hash_free_entry(e); // yarım kayıt bırakma
+    return;
+  }
+  e->dir_mtime = st.st_mtim; // revalidation için mtime
+  e->hits = 1;               // ilk çözüm de bir kullanım
+
+  unsigned idx = cmd_hash_index(name);
+  e->next = cmd_hash[idx]; // bucket başına ekle
+  cmd_hash[idx] = e;
+}
+
+/*
+ * Bu fonksiyon, kullanıcıdan gelen komutun çalıştırılabilir dosya yolunu bulur.
+ *
+ * Amaç:
+ * - Eğer komut zaten bir path içeriyorsa (örn: /bin/ls veya ./a.out),
+ *   doğrudan onun çalıştırılabilir olup olmadığını kontrol etmek
+ * - Eğer komut sadece isim olarak geldiyse (örn: ls),
+ *   PATH ortam değişkenindeki klasörlerin içinde sırayla aramak
+ *
+ * Dönüş değeri:
+ * - Komut bulunursa çalıştırılabilir dosyanın tam yolunu döndürür
+ *   (örn: /usr/bin/ls)
+ * - Bulunamazsa NULL döndürür
+ *
+ * Not:
+ * - Dönen string dinamik olarak ayrılmıştır (malloc / strdup).
+ * - İş bittikten sonra free() ile serbest bırakılmalıdır.
+ * - probes: denenen PATH klasörü sayısı, hit: hash tablosundan mı geldi
+ *   (trace için; resolve_executable_path bunları span'e yazar)
+ */
+static char *lookup_executable_path(const char *cmd, int *probes, bool *hit)
+{
+  // Eğer komut NULL ise veya boş string ise arama yapamayız.
+  if (cmd == NULL || strlen(cmd) == 0)
+    return NULL;
+
+  // Eğer komutun içinde '/' karakteri varsa, bu komut büyük ihtimalle
+  // zaten bir path olarak verilmiştir. (/bin/ls, ./program, ../test/a.out)
+  if (strchr(cmd, '/'))
+  {
+    // access(..., X_OK) dosyanın çalıştırılabilir olup olmadığını kontrol eder.
+    if (access(cmd, X_OK) == 0)
+      // Çalıştırılabiliyorsa bu path'in bir kopyasını döndür.
+      return strdup(cmd);
+
+    // Çalıştırılamıyorsa bulunamadı gibi davran.
+    return NULL;
+  }
+
+  // PATH ortam değişkenini al.
+  // PATH içinde komutların aranacağı klasörler bulunur.
+  // Örnek:
+  // /usr/local/bin:/usr/bin:/bin
+  char *path_env = getenv("PATH");
+
+  // Eğer PATH yoksa arama yapamayız.
+  if (path_env == NULL)
+    return NULL;
+
+  // Önce hash tablosuna bak: PATH değiştiyse tablo boşalır,
+  // kayıt varsa ve klasörü değişmediyse PATH taramasına gerek yok.
+  cmd_hash_check_path(path_env);
+  const char *cached = cmd_hash_lookup(cmd);
+  if (cached != NULL)
+  {
+    *hit = true;
+    return strdup(cached); // çağıran free edeceği için kopya dön
+  }
+
+  // strtok string'i değiştirdiği için PATH'in direkt kendisini parçalamıyoruz.
+  // Önce bir kopyasını alıyoruz.
+  char *path_copy = strdup(path_env);
+
+  // Kopya oluşturulamadıysa NULL dön.
+  if (path_copy == NULL)
+    return NULL;
+
+  // PATH'i ':' karakterine göre parçala.
+  // İlk klasörü al.
+  char *dir = strtok(path_copy, ":");
+
+  // Tüm PATH klasörlerinde sırayla dolaş.
+  while (dir != NULL)
+  {
+    // Oluşturacağımız tam path için gerekli uzunluğu hesapla.
+    // +2 sebebi:
+    // 1 karakter '/' için
+    // 1 karakter '\0' string sonu için
+    size_t full_len = strlen(dir) + strlen(cmd) + 2;
+
+    // Tam path string'i için bellek ayır.
+    char *full_path = (char *)malloc(full_len);
+
+    // Bellek ayrılamadıysa önce path_copy'yi temizle, sonra çık.
+    if (full_path == NULL)
+    {
+      free(path_copy);
+      return NULL;
+    }
+
+    // "klasör/komut" şeklinde tam path oluştur.
+    // Örnek:
+    // dir = /usr/bin
+    // cmd = ls
+    // sonuç = /usr/bin/ls
+    snprintf(full_path, full_len, "%s/%s", dir, cmd);
+
+    // Oluşturulan dosya gerçekten çalıştırılabilir mi kontrol et.
+    (*probes)++;
+    if (access(full_path, X_OK) == 0)
+    {
+      // Sonraki aramalar için tabloya ekle.
+      cmd_hash_insert(cmd, full_path, dir);
+
+      // PATH kopyasına artık ihtiyaç yok, temizle.
+      free(path_copy);
+
+      // Bulduğumuz tam yolu döndür.
+      return full_path;
+    }
+
+    // Bu klasörde bulunamadıysa bu path'i temizle.
+    free(full_path);
+
+    // PATH içindeki bir sonraki klasöre geç.
+    dir = strtok(NULL, ":");
+  }
+
+  // Hiçbir klasörde bulunamadıysa PATH kopyasını temizle.
+  free(path_copy);
+
+  // Komut bulunamadı.
+  return NULL;
+}
+
+// Komutun tam yolunu döndürür (yoksa NULL, sonuç free edilmeli).
+// Trace açıksa süre, PATH deneme sayısı ve hash isabeti span'e yazılır.
+char *resolve_executable_path(const char *cmd)
+{
+  int64_t t0 = trace_begin();
+  int probes = 0;
+  bool hit = false;
+  char *path = lookup_executable_path(cmd, &probes, &hit);
+  if (t0 != 0)
+  {
+    char nprobes[16];
+    snprintf(nprobes, sizeof(nprobes), "%d", probes);
+    trace_span("resolve_executable_path", t0, 0, "cmd", cmd, "path", path ? path : "",
+               "probes", nprobes, "hash", hit ? "hit" : "miss", NULL);
+  }
+  return path;
+}
+
+// waitpid status'unu shell çıkış koduna çevirir (sinyalle ölen: 128+sig)
+int status_from_wait(int status)
+{
+  if (WIFEXITED(status))
+    return WEXITSTATUS(status); // normal çıkış
+  if (WIFSIGNALED(status))
+    return 128 + WTERMSIG(status); // sinyalle sonlandı
+  return 1;
+}
+
+// Builtin dönüş kodunu last_status'a yansıtır ve aynen geri döndürür
+int builtin_status(int r)
+{
+  last_status = (r == SUCCESS) ? 0 : 1;
+  return r;
+}
+
+/*
+ * ===== Spawn motoru =====
+ * Dış komutlar iki yolla başlatılabilir:
+ * - SPAWN_MODE_SPAWN: posix_spawn (glibc'de CLONE_VM|CLONE_VFORK kullanır,
+ *   shell'in sayfa tablosu kopyalanmaz, büyük shell'de başlatma çok daha hızlı)
+ * - SPAWN_MODE_FORK : klasik fork() + execv()
+ * Pipe fd'leri ve redirects[0..2] her iki modda da aynı şekilde bağlanır.
+ * Mod "spawnmode" builtin'i veya SHELLISH_SPAWN=fork|spawn ile seçilir.
+ */
+enum spawn_modes
+{
+  SPAWN_MODE_FORK = 0,
+  SPAWN_MODE_SPAWN = 1,
+};
+
+static int spawn_mode = SPAWN_MODE_SPAWN; // varsayılan: posix_spawn
+
+// Shell'in kendisi için ignore ettiği / thread'lerde blokladığı sinyaller.
+// Child'larda bunların hepsi varsayılan davranışa döner.
+void shell_signal_set(sigset_t *set)
+{
+  sigemptyset(set);
+  sigaddset(set, SIGINT);
+  sigaddset(set, SIGQUIT);
+  sigaddset(set, SIGTSTP);
+  sigaddset(set, SIGTTIN);
+  sigaddset(set, SIGTTOU);
+  sigaddset(set, SIGCHLD);
+  sigaddset(set, SIGPIPE);
+}
+
+// fork ile oluşturulan child'da sinyal ayarlarını varsayılana döndürür
+void reset_child_signals()
+{
+  sigset_t set;
+  shell_signal_set(&set);
+  for (int sig = 1; sig < NSIG; sig++)
+    if (sigismember(&set, sig) == 1)
+      signal(sig, SIG_DFL);
+  sigemptyset(&set);
+  sigprocmask(SIG_SETMASK, &set, NULL); // SIGCHLD vb. blokları kaldır
+}
+
+/*
+ * Redirection'ları child içinde uygular (fork modu için).
+ * redirects[0] = "<input"   -> stdin dosyadan okunsun
+ * redirects[1] = ">output"  -> stdout dosyaya yazılsın (truncate)
+ * redirects[2] = ">>output" -> stdout dosyaya yazılsın (append)
+ * Dosya açılamazsa child'ı 1 ile bitirir.
+ */
+void apply_redirects_in_child(char *const redirects[3])
+{
+  if (redirects == NULL)
+    return; // yönlendirme yok
+
+  // <input : stdin'i dosyadan okumak için yönlendirme
+  if (redirects[0])
+  {                                            // Eğer "<" ile input dosyası verilmişse
+    int in_fd = open(redirects[0], O_RDONLY); // Dosyayı sadece okuma modunda aç
+    if (in_fd < 0)
+    { // Açma başarısızsa
+      printf("-%s: input dosyasi acilamadi %s: %s\n",
+             sysname, redirects[0], strerror(errno)); // Hata mesajı yaz
+      exit(1);                                        // Child process'i hata ile bitir
+    }
+    dup2(in_fd, STDIN_FILENO); // stdin(0) artık bu dosyadan gelsin
+    close(in_fd);              // Artık gerek kalmayan fd'yi kapat
+  }
+
+  // >output : stdout'u dosyaya yazmak (truncate: varsa içini sıfırlar)
+  if (redirects[1])
+  {                                               // Eğer ">" ile output dosyası verilmişse
+    int out_fd = open(redirects[1],               // Output dosyasını aç
+                      O_WRONLY | O_CREAT | O_TRUNC, // yazma + yoksa oluştur + varsa sıfırla
+                      0644);                        // dosya izinleri (rw-r--r--)
+    if (out_fd < 0)
+    { // Açma başarısızsa
+      printf("-%s: output dosyasi acilamadi %s: %s\n",
+             sysname, redirects[1], strerror(errno)); // Hata mesajı yaz
+      exit(1);                                        // Child process'i hata ile bitir
+    }
+    dup2(out_fd, STDOUT_FILENO); // stdout(1) artık bu dosyaya yazsın
+    close(out_fd);               // Artık gerek kalmayan fd'yi kapat
+  }
+
+  // >>output : stdout'u dosyaya yazmak (append: sona ekler)
+  if (redirects[2])
+  {                                                // Eğer ">>" ile append dosyası verilmişse
+    int app_fd = open(redirects[2],                // Append dosyasını aç
+                      O_WRONLY | O_CREAT | O_APPEND, // yazma + yoksa oluştur + sona ekle
+                      0644);                         // dosya izinleri
+    if (app_fd < 0)
+    { // Açma başarısızsa
+      printf("-%s: append dosyasi acilamadi %s: %s\n",
+             sysname, redirects[2], strerror(errno)); // Hata mesajı yaz
+      exit(1);                                        // Child process'i hata ile bitir
+    }
+    dup2(app_fd, STDOUT_FILENO); // stdout(1) artık bu dosyaya (sona ekleyerek) yazsın
+    close(app_fd);               // Artık gerek kalmayan fd'yi kapat
+  }
+}
+
+void pop_redirects(int saved[2]);
+
+/*
+ * Shell içinde (fork olmadan) çalışan builtin'ler için redirect uygular.
+ * stdin/stdout'un eski hali saved[0]/saved[1]'e dup edilir; builtin bittikten
+ * sonra pop_redirects() ile geri yüklenir. Dosya açılamazsa -1 döner.
+ */
+int push_redirects(char *const redirects[3], int saved[2])
+{
+  saved[0] = saved[1] = -1;
+  fflush(stdout); // eski stdout'a ait çıktı orada kalsın
+
+  for (int i = 0; i < 3; i++)
+  {
+    if (redirects[i] == NULL)
+      continue;
+    int fd;
+    if (i == 0)
+      fd = open(redirects[0], O_RDONLY | O_CLOEXEC); // <input
+    else if (i == 1)
+      fd = open(redirects[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644); // >output
+    else
+      fd = open(redirects[2], O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644); // >>output
+    if (fd < 0)
+    {
+      printf("-%s: %s: %s\n", sysname, redirects[i], strerror(errno));
+      pop_redirects(saved); // yarım kalanları geri al
+      return -1;
+    }
+
+    int target = (i == 0) ? STDIN_FILENO : STDOUT_FILENO;
+    int slot = (i == 0) ? 0 : 1;
+    if (saved[slot] < 0)
+      saved[slot] = fcntl(target, F_DUPFD_CLOEXEC, 3); // orijinali sakla (exec'e sızmasın)
+    dup2(fd, target);
+    close(fd);
+  }
+  return 0;
+}
+
+// push_redirects() ile değiştirilen stdin/stdout'u geri yükler
+void pop_redirects(int saved[2])
+{
+  fflush(stdout); // yönlendirilmiş stdout'a yazılanlar dosyaya gitsin
+  for (int slot = 0; slot < 2; slot++)
+  {
+    if (saved[slot] < 0)
+      continue;
+    dup2(saved[slot], slot == 0 ? STDIN_FILENO : STDOUT_FILENO);
+    close(saved[slot]);
+    saved[slot] = -1;
+  }
+}
+
+// Builtin'i shell içinde, komutun redirect'leri uygulanmış halde çalıştırır
+int run_redirected_builtin(struct command_t *command,
+                           int (*fn)(struct command_t *))
+{
+  int saved[2];
+  if (push_redirects(command->redirects, saved) != 0)
+    return UNKNOWN;
+  int r = fn(command);
+  pop_redirects(saved);
+  return r;
+}
+
+/*
+ * Dış bir komutu başlatır (beklemez).
+ * path     : çözülmüş tam yol (resolve_executable_path sonucu)
+ * argv     : NULL ile biten argüman listesi
+ * in_fd    : stdin'e bağlanacak fd (pipe read end), yoksa -1
+ * out_fd   : stdout'a bağlanacak fd (pipe write end), yoksa -1
+ * close_fd : child'da kapatılacak fd (kullanılmayan pipe ucu), yoksa -1
+ * redirects: <, >, >> hedefleri (NULL olabilir); pipe'tan sonra uygulanır
+ * pgid     : -1 process group'a dokunma, 0 yeni grup aç, >0 bu gruba katıl
+ * take_tty : true ise child'ın grubu terminalin foreground grubu olur
+ * Başarılıysa 0 döner ve *pid_out doldurulur, değilse errno değeri döner.
+ * Not: fork modunda redirect/exec hataları child içinde basılır.
+ */
+int spawn_command(const char *path, char *const argv[], int in_fd, int out_fd,
+                  int close_fd, char *const redirects[3], pid_t pgid, bool take_tty,
+                  pid_t *pid_out)
+{
+  int64_t t0 = trace_begin(); // fork/spawn fazı
+  fflush(stdout); // child'a yarım stdio buffer'ı kopyalanmasın
+
+  if (spawn_mode == SPAWN_MODE_FORK)
+  {
+    pid_t pid = fork(); // klasik yol: tüm adres alanını kopyala
+    if (pid < 0)
+      return errno; // fork hatası
+    if (pid == 0)
+    {
+      if (pgid >= 0)
+      {
+        setpgid(0, pgid); // job'ın process group'u
+        if (take_tty)
+          tcsetpgrp(STDIN_FILENO, pgid == 0 ? getpid() : pgid); // terminal bizim
+      }
+      reset_child_signals(); // shell'in ignore/bloklarını geri al
+
+      if (in_fd >= 0 && in_fd != STDIN_FILENO)
+      {
+        dup2(in_fd, STDIN_FILENO); // stdin(0) -> pipe read
+        close(in_fd);
+      }
+      if (out_fd >= 0 && out_fd != STDOUT_FILENO)
+      {
+        dup2(out_fd, STDOUT_FILENO); // stdout(1) -> pipe write
+        close(out_fd);
+      }
+      if (close_fd >= 0)
+        close(close_fd); // kullanılmayan pipe ucu
+
+      apply_redirects_in_child(redirects); // <, >, >>
+
+      trace_instant("exec", 0, "path", path, NULL); // trace fd'si exec'te kapanır
+      execv(path, argv); // başarılıysa geri dönmez
+      printf("-%s: %s: %s\n", sysname, argv[0], strerror(errno));
+      exit(127);
+    }
+    if (pgid >= 0)
+      setpgid(pid, pgid == 0 ? pid : pgid); // parent da ayarlar (yarış olmasın)
+    trace_thread_name(pid, argv[0]);
+    trace_span("fork", t0, 0, "path", path, NULL);
+    *pid_out = pid;
+    return 0;
+  }
+
+  // posix_spawn yolu: fd işlemleri file action olarak child'da sırayla uygulanır
+  posix_spawn_file_actions_t fa;
+  int err = posix_spawn_file_actions_init(&fa);
+  if (err != 0)
+    return err;
+
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 35))
+  // exec'ten önce terminali devral (SIGTTIN yarışı olmasın). File action'lar
+  // sırayla uygulanır: stdin pipe'a bağlanmadan önce, hâlâ terminalken yapılmalı
+  if (pgid >= 0 && take_tty)
+    posix_spawn_file_actions_addtcsetpgrp_np(&fa, STDIN_FILENO);
+#endif
+
+  if (in_fd >= 0 && in_fd != STDIN_FILENO)
+  {
+    posix_spawn_file_actions_adddup2(&fa, in_fd, STDIN_FILENO); // stdin -> pipe read
+    posix_spawn_file_actions_addclose(&fa, in_fd);
+  }
+  if (out_fd >= 0 && out_fd != STDOUT_FILENO)
+  {
+    posix_spawn_file_actions_adddup2(&fa, out_fd, STDOUT_FILENO); // stdout -> pipe write
+    posix_spawn_file_actions_addclose(&fa, out_fd);
+  }
+  if (close_fd >= 0)
+    posix_spawn_file_actions_addclose(&fa, close_fd); // kullanılmayan pipe ucu
+
+  if (redirects != NULL)
+  {
+    if (redirects[0]) // <input
+      posix_spawn_file_actions_addopen(&fa, STDIN_FILENO, redirects[0], O_RDONLY, 0);
+    if (redirects[1]) // >output
+      posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, redirects[1],
+                                       O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (redirects[2]) // >>output
+      posix_spawn_file_actions_addopen(&fa, STDOUT_FILENO, redirects[2],
+                                       O_WRONLY | O_CREAT | O_APPEND, 0644);
+  }
+
+  // Sinyaller: shell'in ignore ettikleri varsayılana dönsün, maske boş olsun
+  posix_spawnattr_t attr;
+  posix_spawnattr_init(&attr);
+  short flags = POSIX_SPAWN_SETSIGDEF | POSIX_SPAWN_SETSIGMASK;
+  sigset_t def, empty;
+  shell_signal_set(&def);
+  sigemptyset(&empty);
+  posix_spawnattr_setsigdefault(&attr, &def);
+  posix_spawnattr_setsigmask(&attr, &empty);
+  if (pgid >= 0)
+  {
+    flags |= POSIX_SPAWN_SETPGROUP; // job'ın process group'u
+    posix_spawnattr_setpgroup(&attr, pgid);
+  }
+  posix_spawnattr_setflags(&attr, flags);
+
+  extern char **environ; // child aynı environment'ı alsın
+  pid_t pid;
+  err = posix_spawn(&pid, path, &fa, &attr, argv, environ);
+  posix_spawn_file_actions_destroy(&fa);
+  posix_spawnattr_destroy(&attr);
+  if (err != 0)
+  {
+    // Child terminali aldıktan sonra exec'te düştüyse (ör: ENOEXEC) terminal
+    // ölü bir process group'ta kalır: geri al, yoksa shell okuyamaz
+    if (pgid >= 0 && take_tty)
+      tcsetpgrp(STDIN_FILENO, getpgrp());
+    return err; // file action veya exec hatası (glibc child'dan raporlar)
+  }
+
+  // glibc'de posix_spawn child exec edene kadar döner (CLONE_VFORK), yani
+  // span exec'i de kapsar; "exec" anı child'ın satırına dönüş anında yazılır
+  trace_thread_name(pid, argv[0]);
+  trace_span("posix_spawn", t0, 0, "path", path, NULL);
+  trace_instant("exec", pid, "path", path, NULL);
+  *pid_out = pid;
+  return 0;
+}
+
+// spawnmode builtin: spawn motorunu seçer veya gösterir
+// spawnmode            -> aktif modu yaz
+// spawnmode fork|spawn -> modu değiştir
+int run_spawnmode_builtin(struct command_t *command)
+{
+  const char *arg = command->args[1];
+  if (arg == NULL)
+  {
+    printf("%s\n", spawn_mode == SPAWN_MODE_FORK ? "fork" : "spawn");
+    return SUCCESS;
+  }
+  if (strcmp(arg, "fork") == 0)
+    spawn_mode = SPAWN_MODE_FORK;
+  else if (strcmp(arg, "spawn") == 0)
+    spawn_mode = SPAWN_MODE_SPAWN;
+  else
+  {
+    printf("-%s: spawnmode: usage: spawnmode [fork|spawn]\n", sysname);
+    return UNKNOWN;
+  }
+  return SUCCESS;
+}
+
+/*
+ * ===== Job tablosu =====
+ * Fork/spawn edilen her komut (veya pipeline) bir job olarak kaydedilir.
+ * Child'lar SIGCHLD handler'ında asenkron olarak toplanır (zombie kalmaz).
+ * Handler sadece tablodaki pid'leri waitpid(pid, WNOHANG) ile toplar;
+ * böylece repeat/chatroom gibi kendi child'ını bekleyen kodlar etkilenmez.
+ * Tabloyu değiştiren kod SIGCHLD'yi bloklar; shell'in diğer thread'leri
+ * SIGCHLD'yi hep bloklu tutar, handler sadece ana thread'de çalışır.
+ */
+#define MAX_JOBS 64 // aynı anda izlenebilecek job sayısı
+
+enum job_states
+{
+  JOB_FREE = 0, // slot boş
+  JOB_RUNNING,  // en az bir process çalışıyor
+  JOB_STOPPED,  // çalışan process'lerin hepsi durduruldu (Ctrl-Z)
+  JOB_DONE,     // tüm process'ler bitti
+};
+
+enum proc_states
+{
+  PROC_RUNNING = 0,
+  PROC_STOPPED,
+  PROC_DONE,
+};
+
+struct job
+{
+  volatile int state;   // JOB_* (handler günceller)
+  int id;               // kullanıcıya görünen no: [1], [2] ...
+  pid_t pgid;           // process group (job control yoksa 0)
+  int nprocs;           // aşama sayısı
+  pid_t *pids;          // her aşamanın pid'i (-1: process yok)
+  int *statuses;        // her aşamanın waitpid status'u
+  char *proc_state;     // her aşamanın PROC_* durumu
+  int64_t *started;     // her aşamanın başlama zamanı (trace, 0: ölçülmedi)
+  int64_t *ended;       // her aşamanın toplandığı zaman (trace, handler yazar)
+  int running;          // bitmemiş process sayısı
+  int stopped;          // durdurulmuş process sayısı
+  bool background;      // & ile mi başlatıldı
+  bool own_group;       // aşamalar kendi process group'unda mı (job control)
+  char *cmdline;        // jobs çıktısı için komut satırı
+};
+
+static struct job jobs[MAX_JOBS];
+static bool job_control = false; // etkileşimli mod: process group + terminal kontrolü
+static pid_t shell_pgid = 0;     // shell'in kendi process group'u
+
+// Tek bir job'ın process'lerini toplar ve durumunu günceller (handler'dan)
+static void job_reap(struct job *j)
+{
+  for (int i = 0; i < j->nprocs; i++)
+  {
+    if (j->pids[i] <= 0 || j->proc_state[i] == PROC_DONE)
+      continue;
+    int st;
+    pid_t r;
+    while ((r = waitpid(j->pids[i], &st, WNOHANG | WUNTRACED | WCONTINUED)) == j->pids[i])
+    {
+      if (WIFSTOPPED(st))
+      {
+        if (j->proc_state[i] == PROC_RUNNING)
+          j->stopped++;
+        j->proc_state[i] = PROC_STOPPED;
+      }
+      else if (WIFCONTINUED(st))
+      {
+        if (j->proc_state[i] == PROC_STOPPED)
+          j->stopped--;
+        j->proc_state[i] = PROC_RUNNING;
+      }
+      else
+      { // çıktı veya sinyalle öldü
+        if (j->proc_state[i] == PROC_STOPPED)
+          j->stopped--;
+        j->proc_state[i] = PROC_DONE;
+        j->statuses[i] = st; // aşamanın çıkış durumu
+        j->ended[i] = trace_begin();
+        j->running--;
+        break;
+      }
+    }
+  }
+
+  if (j->running == 0)
+    j->state = JOB_DONE;
+  else if (j->stopped == j->running)
+    j->state = JOB_STOPPED;
+  else
+    j->state = JOB_RUNNING;
+}
+
+// SIGCHLD: bitmiş/durmuş child'ları tablodan toplar (async-signal-safe)
+static void sigchld_handler(int sig)
+{
+  (void)sig;
+  int saved_errno = errno; // kesilen kodun errno'su bozulmasın
+  for (int i = 0; i < MAX_JOBS; i++)
+    if (jobs[i].state == JOB_RUNNING || jobs[i].state == JOB_STOPPED)
+      job_reap(&jobs[i]);
+  errno = saved_errno;
+}
+
+// SIGCHLD'yi bloklar (tablo değişirken handler araya girmesin)
+void jobs_block(sigset_t *old)
+{
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGCHLD);
+  sigprocmask(SIG_BLOCK, &set, old);
+}
+
+void jobs_unblock(sigset_t *old)
+{
+  sigprocmask(SIG_SETMASK, old, NULL);
+}
+
+// Komut zincirinden "a | b | c &" şeklinde metin üretir
+static char *job_cmdline(struct command_t *command)
+{
+  size_t len = 1;
+  for (struct command_t *c = command; c != NULL; c = c->next)
+    for (int i = 0; c->args[i] != NULL; i++)
+      len += strlen(c->args[i]) + 4; // boşluk / " | " payı
+  char *s = malloc(len + 2);
+  if (s == NULL)
+    return NULL;
+  s[0] = '\0';
+  for (struct command_t *c = command; c != NULL; c = c->next)
+  {
+    if (c != command)
+      strcat(s, " | ");
+    for (int i = 0; c->args[i] != NULL; i++)
+    {
+      if (i > 0)
+        strcat(s, " ");
+      strcat(s, c->args[i]);
+    }
+  }
+  if (command->background)
+    strcat(s, " &");
+  return s;
+}
+
+// Yeni job oluşturur (SIGCHLD bloklu iken çağrılmalı). Yer yoksa NULL.
+struct job *job_new(struct command_t *command, int nprocs)
+{
+  int max_id = 0;
+  struct job *j = NULL;
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    if (jobs[i].state == JOB_FREE)
+    {
+      if (j == NULL)
+        j = &jobs[i];
+    }
+    else if (jobs[i].id > max_id)
+      max_id = jobs[i].id;
+  }
+  if (j == NULL)
+    return NULL;
+
+  memset(j, 0, sizeof(*j));
+  j->pids = malloc(sizeof(pid_t) * nprocs);
+  j->statuses = calloc(nprocs, sizeof(int));
+  j->proc_state = calloc(nprocs, 1);
+  j->started = calloc(nprocs, sizeof(int64_t));
+  j->ended = calloc(nprocs, sizeof(int64_t));
+  if (j->pids == NULL || j->statuses == NULL || j->proc_state == NULL ||
+      j->started == NULL || j->ended == NULL)
+  {
+    free(j->pids);
+    free(j->statuses);
+    free(j->proc_state);
+    free(j->started);
+    free(j->ended);
+    return NULL;
+  }
+  for (int i = 0; i < nprocs; i++)
+    j->pids[i] = -1;
+  j->id = max_id + 1; // bash gibi: en büyük no + 1
+  j->nprocs = nprocs;
+  j->background = command->background;
+  j->own_group = job_control; // thread'li pipeline'da execute_pipeline kapatır
+  j->cmdline = job_cmdline(command);
+  j->state = JOB_DONE; // process eklenene kadar
+  return j;
+}
+
+// i. aşamanın process'ini kaydeder (SIGCHLD bloklu iken)
+void job_add_proc(struct job *j, int i, pid_t pid)
+{
+  j->pids[i] = pid;
+  if (pid <= 0)
+    return;
+  j->started[i] = trace_begin();
+  if (j->pgid == 0 && j->own_group)
+    j->pgid = pid; // ilk process grubun lideri
+  j->running++;
+  j->state = JOB_RUNNING;
+}
+
+// Job slotunu boşaltır. Trace açıksa biten her aşama kendi satırında
+// (tid = pid) başlamadan toplanmaya kadar süren bir span olarak yazılır.
+void job_free(struct job *j)
+{
+  for (int i = 0; i < j->nprocs; i++)
+  {
+    if (j->pids[i] <= 0 || j->ended[i] == 0)
+      continue;
+    char idx[16], status[16];
+    snprintf(idx, sizeof(idx), "%d", i);
+    snprintf(status, sizeof(status), "%d", status_from_wait(j->statuses[i]));
+    trace_span_at("stage", j->started[i], j->ended[i], j->pids[i],
+                  "index", idx, "status", status, NULL);
+  }
+  free(j->pids);
+  free(j->statuses);
+  free(j->proc_state);
+  free(j->started);
+  free(j->ended);
+  free(j->cmdline);
+  memset(j, 0, sizeof(*j)); // state = JOB_FREE
+}
+
+// Job'ın process'lerine SIGCONT gönderir (grubu yoksa bitmemiş olanlara tek tek)
+static void job_continue(struct job *j)
+{
+  if (j->pgid > 0)
+  {
+    kill(-j->pgid, SIGCONT);
+    return;
+  }
+  for (int i = 0; i < j->nprocs; i++)
+    if (j->pids[i] > 0 && j->proc_state[i] != PROC_DONE)
+      kill(j->pids[i], SIGCONT);
+}
+
+// Son aşamanın çıkış kodunu last_status'a yazar (bash gibi)
+static void job_set_last_status(struct job *j)
+{
+  int last = j->nprocs - 1;
+  if (j->pids[last] > 0 && j->proc_state[last] == PROC_DONE)
+    last_status = status_from_wait(j->statuses[last]);
+}
+
+/*
+ * Job bitene (veya durdurulana) kadar bekler. SIGCHLD bloklu iken çağrılır;
+ * old: bloklamadan önceki maske (sigsuspend bununla uyur).
+ * Foreground'da terminali job'a verir, bitince geri alır.
+ * Job bittiyse slotu boşaltır; durduysa tabloda bırakır.
+ * Kendi grubu olmayan job (cut thread'li pipeline) durdurulamaz: thread'ler
+ * shell'in içinde çalıştığı için durmuş bir aşama onları sonsuza kadar
+ * bekletirdi. Ctrl-Z ile duran aşamaları hemen devam ettirir.
+ */
+void job_wait(struct job *j, sigset_t *old, bool foreground)
+{
+  bool tty = foreground && job_control && j->pgid > 0;
+  int64_t t0 = trace_begin();
+  if (tty)
+    tcsetpgrp(STDIN_FILENO, j->pgid); // terminal job'ın
+
+  while (j->state == JOB_RUNNING || (j->state == JOB_STOPPED && !j->own_group))
+  {
+    if (j->state == JOB_STOPPED)
+      job_continue(j);
+    sigsuspend(old); // SIGCHLD gelince handler toplar, döngü kontrol eder
+  }
+  trace_span("wait", t0, 0, NULL);
+
+  if (tty)
+    tcsetpgrp(STDIN_FILENO, shell_pgid); // terminal tekrar shell'in
+
+  if (j->state == JOB_STOPPED)
+  {
+    j->background = true; // artık arka planda bekliyor
+    printf("\n[%d]+  Stopped                 %s\n", j->id, j->cmdline ? j->cmdline : "");
+    last_status = 128 + SIGTSTP;
+    return;
+  }
+
+  job_set_last_status(j);
+  job_free(j);
+}
+
+// Arka planda bitmiş job'ları bildirir ve slotlarını boşaltır
+void jobs_notify(bool print)
+{
+  sigset_t old;
+  jobs_block(&old);
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    struct job *j = &jobs[i];
+    if (j->state == JOB_DONE && j->background)
+    {
+      if (print)
+        printf("[%d]+  Done                    %s\n", j->id, j->cmdline ? j->cmdline : "");
+      job_free(j);
+    }
+  }
+  jobs_unblock(&old);
+}
+
+// "%2", "2" veya NULL (en son job) ile job bulur
+static struct job *job_find(const char *spec)
+{
+  struct job *best = NULL;
+  int id = -1;
+  if (spec != NULL)
+    id = atoi(spec[0] == '%' ? spec + 1 : spec);
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    struct job *j = &jobs[i];
+    if (j->state == JOB_FREE)
+      continue;
+    if (id >= 0 ? j->id == id : (best == NULL || j->id > best->id))
+      best = j;
+  }
+  return best;
+}
+
+static const char *job_state_name(int state)
+{
+  switch (state)
+  {
+  case JOB_RUNNING:
+    return "Running";
+  case JOB_STOPPED:
+    return "Stopped";
+  default:
+    return "Done";
+  }
+}
+
+// jobs builtin: job listesini basar; -l ile her aşamanın pid ve durumu
+int run_jobs_builtin(struct command_t *command)
+{
+  bool longfmt = command->args[1] != NULL && strcmp(command->args[1], "-l") == 0;
+  sigset_t old;
+  jobs_block(&old);
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    struct job *j = &jobs[i];
+    if (j->state == JOB_FREE)
+      continue;
+    printf("[%d]  %-22s  %s\n", j->id, job_state_name(j->state), j->cmdline ? j->cmdline : "");
+    if (!longfmt)
+      continue;
+    for (int k = 0; k < j->nprocs; k++)
+    {
+      if (j->pids[k] <= 0)
+        printf("      stage %d: not started\n", k + 1);
+      else if (j->proc_state[k] == PROC_DONE)
+        printf("      stage %d: pid %d exit %d\n", k + 1, (int)j->pids[k],
+               status_from_wait(j->statuses[k]));
+      else
+        printf("      stage %d: pid %d %s\n", k + 1, (int)j->pids[k],
+               j->proc_state[k] == PROC_STOPPED ? "stopped" : "running");
+    }
+  }
+  jobs_unblock(&old);
+  jobs_notify(false); // listelenen bitmiş job'lar artık silinebilir
+  return SUCCESS;
+}
+
+// wait builtin: wait -> tüm arka plan job'ları, wait N / wait %N -> o job
+int run_wait_builtin(struct command_t *command)
+{
+  sigset_t old;
+  jobs_block(&old);
+  if (command->args[1] != NULL)
+  {
+    struct job *j = job_find(command->args[1]);
+    if (j == NULL)
+    {
+      jobs_unblock(&old);
+      printf("-%s: wait: %s: no such job\n", sysname, command->args[1]);
+      return UNKNOWN;
+    }
+    while (j->state == JOB_RUNNING)
+      sigsuspend(&old);
+    job_set_last_status(j);
+    if (j->state == JOB_DONE)
+      job_free(j);
+    jobs_unblock(&old);
+    return SUCCESS;
+  }
+
+  for (int i = 0; i < MAX_JOBS; i++)
+  {
+    while (jobs[i].state == JOB_RUNNING)
+      sigsuspend(&old);
+    if (jobs[i].state == JOB_DONE)
+      job_free(&jobs[i]);
+  }
+  jobs_unblock(&old);
+  last_status = 0;
+  return SUCCESS;
+}
+
+// fg / bg builtin'leri: durmuş veya arka plandaki job'ı devam ettirir
+int run_fg_bg_builtin(struct command_t *command, bool foreground)
+{
+  const char *name = foreground ? "fg" : "bg";
+  if (!job_control)
+  {
+    printf("-%s: %s: no job control\n", sysname, name);
+    return UNKNOWN;
+  }
+
+  sigset_t old;
+  jobs_block(&old);
+  struct job *j = job_find(command->args[1]);
+  if (j == NULL || j->state == JOB_DONE)
+  {
+    jobs_unblock(&old);
+    printf("-%s: %s: %s: no such job\n", sysname, name,
+           command->args[1] ? command->args[1] : "current");
+    return UNKNOWN;
+  }
+
+  // Durmuş process'ler devam etsin (handler WIFCONTINUED ile günceller)
+  for (int k = 0; k < j->nprocs; k++)
+    if (j->proc_state[k] == PROC_STOPPED)
+    {
+      j->proc_state[k] = PROC_RUNNING;
+      j->stopped--;
+    }
+  j->state = JOB_RUNNING;
+
+  if (foreground)
+  {
+    printf("%s\n", j->cmdline ? j->cmdline : "");
+    j->background = false;
+    if (j->pgid > 0)
+      tcsetpgrp(STDIN_FILENO, j->pgid); // SIGCONT'tan önce terminali ver
+    job_continue(j);
+    job_wait(j, &old, true);
+  }
+  else
+  {
+    j->background = true;
+    job_continue(j);
+    printf("[%d]+ %s\n", j->id, j->cmdline ? j->cmdline : "");
+  }
+  jobs_unblock(&old);
+  return SUCCESS;
+}
+
+// Sinyal ayarları: SIGCHLD handler'ı her modda; job control sadece etkileşimli
+void jobs_init(bool interactive)
+{
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = sigchld_handler;
+  sigemptyset(&sa.sa_mask);
+  sa.sa_flags = SA_RESTART; // read/waitpid gibi çağrılar kesilmesin
+  sigaction(SIGCHLD, &sa, NULL);
+
+  if (!interactive)
+    return;
+
+  // Shell kendi grubunda olsun ve terminalin sahibi olsun
+  job_control = true;
+  signal(SIGINT, SIG_IGN); // Ctrl-C / Ctrl-Z foreground job'a gider
+  signal(SIGQUIT, SIG_IGN);
+  signal(SIGTSTP, SIG_IGN);
+  signal(SIGTTIN, SIG_IGN);
+  signal(SIGTTOU, SIG_IGN); // tcsetpgrp sırasında durmayalım
+  shell_pgid = getpid();
+  if (getpgrp() != shell_pgid)
+    setpgid(0, shell_pgid);
+  tcsetpgrp(STDIN_FILENO, shell_pgid);
+}
+
+// Builtin kontrol fonksiyonu (cut/help/chatroom gibi komutlar builtin mi?)
+bool is_builtin_child(const char *name);
+
+// Builtin komut çalıştırma fonksiyonu (child içinde çağrılacak)
+int run_builtin_child(struct command_t *command);
+
+/*
+ * ===== Bellek içi ring buffer =====
+ * Pipeline'da yan yana iki builtin aşaması (ör: cut | cut) shell içinde
+ * thread olarak çalışır ve aralarındaki veri kernel pipe'ı yerine bu
+ * ring'den geçer (syscall ve context switch yok).
+ */
+#define BYTE_RING_SIZE (1024 * 1024) // ring kapasitesi
+
+struct byte_ring
+{
+  pthread_mutex_t lock;      // tüm alanları korur
+  pthread_cond_t not_empty;  // okuyucu bekler
+  pthread_cond_t not_full;   // yazıcı bekler
+  char *buf;                 // veri
+  size_t cap;                // kapasite
+  size_t head;               // sıradaki okunacak byte
+  size_t count;              // ring'deki byte sayısı
+  bool write_closed;         // yazıcı bitti (okuyucu için EOF)
+  bool read_closed;          // okuyucu bıraktı (yazıcı için EPIPE)
+};
+
+struct byte_ring *ring_new()
+{
+  struct byte_ring *r = calloc(1, sizeof(struct byte_ring));
+  if (r == NULL)
+    return NULL;
+  r->buf = malloc(BYTE_RING_SIZE);
+  if (r->buf == NULL)
+  {
+    free(r);
+    return NULL;
+  }
+  r->cap = BYTE_RING_SIZE;
+  pthread_mutex_init(&r->lock, NULL);
+  pthread_cond_init(&r->not_empty, NULL);
+  pthread_cond_init(&r->not_full, NULL);
+  return r;
+}
+
+void ring_free(struct byte_ring *r)
+{
+  if (r == NULL)
+    return;
+  pthread_mutex_destroy(&r->lock);
+  pthread_cond_destroy(&r->not_empty);
+  pthread_cond_destroy(&r->not_full);
+  free(r->buf);
+  free(r);
+}
+
+// En fazla n byte okur. Veri yoksa bekler; yazıcı kapattıysa 0 (EOF) döner.
+ssize_t ring_read(struct byte_ring *r, char *dst, size_t n)
+{
+  pthread_mutex_lock(&r->lock);
+  while (r->count == 0 && !r->write_closed)
+    pthread_cond_wait(&r->not_empty, &r->lock);
+
+  size_t total = 0;
+  while (total < n && r->count > 0)
+  {
+    size_t chunk = r->cap - r->head; // sona kadar olan kısım
+    if (chunk > r->count)
+      chunk = r->count;
+    if (chunk > n - total)
+      chunk = n - total;
+    memcpy(dst + total, r->buf + r->head, chunk);
+    r->head = (r->head + chunk) % r->cap;
+    r->count -= chunk;
+    total += chunk;
+  }
+  pthread_cond_signal(&r->not_full); // yazıcıya yer açıldı
+  pthread_mutex_unlock(&r->lock);
+  return (ssize_t)total;
+}
+
+// n byte'ın hepsini yazar (yer açılana kadar bekler).
+// Okuyucu bıraktıysa -1 döner (pipe'taki EPIPE gibi).
+ssize_t ring_write(struct byte_ring *r, const char *src, size_t n)
+{
+  size_t total = 0;
+  pthread_mutex_lock(&r->lock);
+  while (total < n)
+  {
+    while (r->count == r->cap && !r->read_closed)
+      pthread_cond_wait(&r->not_full, &r->lock);
+    if (r->read_closed)
+    {
+      pthread_mutex_unlock(&r->lock);
+      return -1;
+    }
+    size_t tail = (r->head + r->count) % r->cap; // yazma konumu
+    size_t chunk = r->cap - r->count;            // boş yer
+    if (chunk > r->cap - tail)
+      chunk = r->cap - tail; // sona kadar
+    if (chunk > n - total)
+      chunk = n - total;
+    memcpy(r->buf + tail, src + total, chunk);
+    r->count += chunk;
+    total += chunk;
+    pthread_cond_signal(&r->not_empty); // okuyucuyu uyandır
+  }
+  pthread_mutex_unlock(&r->lock);
+  return (ssize_t)total;
+}
+
+// Yazıcı işini bitirdi: okuyucu kalan veriyi alıp EOF görür
+void ring_close_write(struct byte_ring *r)
+{
+  pthread_mutex_lock(&r->lock);
+  r->write_closed = true;
+  pthread_cond_broadcast(&r->not_empty);
+  pthread_mutex_unlock(&r->lock);
+}
+
+// Okuyucu işini bitirdi: bekleyen yazıcı -1 alır
+void ring_close_read(struct byte_ring *r)
+{
+  pthread_mutex_lock(&r->lock);
+  r->read_closed = true;
+  pthread_cond_broadcast(&r->not_full);
+  pthread_mutex_unlock(&r->lock);
+}
+
+/*
+ * Bir pipeline aşamasının girdi/çıktısı. Ring verilmişse fd yerine o kullanılır.
+ * Shell içinde çalışan (stream) builtin'ler stdin/stdout yerine bunu kullanır.
+ */
+struct stage_io
+{
+  int in_fd;                  // girdi fd'si (ring yoksa)
+  struct byte_ring *in_ring;  // önceki builtin aşamasından gelen ring
+  int out_fd;                 // çıktı fd'si (ring yoksa)
+  struct byte_ring *out_ring; // sonraki builtin aşamasına giden ring
+};
+
+// Pipeline'da thread olarak çalışan builtin aşaması
+struct builtin_stage
+{
+  pthread_t tid;             // thread
+  struct command_t *command; // aşamanın komutu
+  struct stage_io io;        // girdi/çıktı uçları
+  int result;                // builtin'in dönüş kodu (SUCCESS/UNKNOWN)
+};
+
+// Shell içinde thread olarak çalışabilen builtin mi? (stdin -> stdout filtreleri)
+bool is_stream_builtin(const char *name)
+{
+  if (!name)
+    return false;
+  return strcmp(name, "cut") == 0;
+}
+
+// Stream builtin'i verilen uçlarla çalıştırır (cut tanımının yanında)
+int run_stream_builtin(struct command_t *command, struct stage_io *io);
+
+// Builtin aşama thread'i: redirect'leri uygular, builtin'i çalıştırır,
+// bitince kendi uçlarını kapatır (okuyan taraf EOF görsün).
+void *builtin_stage_main(void *arg)
+{
+  struct builtin_stage *st = arg;
+  struct stage_io *io = &st->io;
+
+  // Okuyan taraf kapandığında write() SIGPIPE ile tüm shell'i öldürmesin:
+  // sinyal sadece bu thread'de bloklanır, write EPIPE döner.
+  // SIGCHLD da bloklu: job tablosu handler'ı sadece ana thread'de çalışsın.
+  sigset_t set;
+  sigemptyset(&set);
+  sigaddset(&set, SIGPIPE);
+  sigaddset(&set, SIGCHLD);
+  pthread_sigmask(SIG_BLOCK, &set, NULL);
+
+  // <file: girdi dosyadan gelsin (pipe/ring ucu bırakılır)
+  char **redirects = st->command->redirects;
+  if (redirects[0] != NULL)
+  {
+    int fd = open(redirects[0], O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+      printf("-%s: %s: %s\n", sysname, redirects[0], strerror(errno));
+      st->result = UNKNOWN;
+      goto done;
+    }
+    if (io->in_ring != NULL)
+      ring_close_read(io->in_ring);
+    else if (io->in_fd != STDIN_FILENO)
+      close(io->in_fd);
+    io->in_ring = NULL;
+    io->in_fd = fd;
+  }
+
+  // >file / >>file: çıktı dosyaya gitsin (sonraki aşama EOF görür)
+  if (redirects[1] != NULL || redirects[2] != NULL)
+  {
+    int fd = redirects[1] != NULL
+                 ? open(redirects[1], O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644)
+                 : open(redirects[2], O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+      printf("-%s: %s: %s\n", sysname,
+             redirects[1] != NULL ? redirects[1] : redirects[2], strerror(errno));
+      st->result = UNKNOWN;
+      goto done;
+    }
+    if (io->out_ring != NULL)
+      ring_close_write(io->out_ring);
+    else if (io->out_fd != STDOUT_FILENO)
+      close(io->out_fd);
+    io->out_ring = NULL;
+    io->out_fd = fd;
+  }
+
+  // Trace: thread aşaması kendi satırında (tid = thread id) bir span
+  pid_t tid = gettid();
+  int64_t t0 = trace_begin();
+  trace_thread_name(tid, st->command->name);
+  st->result = run_stream_builtin(st->command, io);
+  trace_span("stage", t0, tid, "builtin", st->command->name, NULL);
+
+done:
+  // Uçları kapat: ring'ler sinyallenir, sahip olunan fd'ler kapanır
+  if (io->out_ring != NULL)
+    ring_close_write(io->out_ring);
+  else if (io->out_fd != STDOUT_FILENO)
+    close(io->out_fd);
+  if (io->in_ring != NULL)
+    ring_close_read(io->in_ring);
+  else if (io->in_fd != STDIN_FILENO)
+    close(io->in_fd);
+  return NULL;
+}
+
+// PIPELINE çalıştırır: cmd1 | cmd2 | cmd3 ... (command->next zinciri)
+// Dış komutlar ve child'da çalışması gereken builtin'ler için process oluşturur,
+// stream builtin'leri (cut) shell içinde thread olarak çalıştırır.
+// Yan yana iki builtin ring ile, diğer sınırlar gerçek pipe ile bağlanır.
+int execute_pipeline(struct command_t *cmd)
+{
+  int in_fd = STDIN_FILENO;         // İlk komutun input'u normal stdin (fd=0)
+  struct byte_ring *in_ring = NULL; // önceki builtin thread'inden gelen ring
+  int pipefd[2];                    // pipefd[0]=read end, pipefd[1]=write end
+  pid_t pid = -1;                   // fork sonucu child pid
+  int ret = SUCCESS;                // pipeline kurulumu başarılı mı
+
+  // Aşama sayısı kadar thread/ring yeri ayır
+  int nstages = 0;
+  for (struct command_t *c = cmd; c != NULL; c = c->next)
+    nstages++;
+  struct builtin_stage *stages = calloc(nstages, sizeof(struct builtin_stage));
+  struct byte_ring **rings = calloc(nstages, sizeof(struct byte_ring *));
+  if (stages == NULL || rings == NULL)
+  {
+    free(stages);
+    free(rings);
+    return UNKNOWN;
+  }
+  int nthreads = 0;                         // başlatılan thread sayısı
+  int nrings = 0;                           // ayrılan ring sayısı
+  struct builtin_stage *last_thread = NULL; // son aşama thread ise
+
+  // Arka plan pipeline'ında builtin'ler thread yerine fork ile çalışır
+  // (shell beklemeyeceği için thread'leri join edecek kimse yok)
+  bool background = cmd->background;
+  bool any_thread = false;
+  for (struct command_t *c = cmd; c != NULL; c = c->next)
+    if (is_stream_builtin(c->name) && !background)
+      any_thread = true;
+
+  // Job kaydı: SIGCHLD kurulum boyunca bloklu (handler pid'leri kaçırmasın).
+  // Thread aşamaları shell'in grubunda kaldığı için o zaman job control yok.
+  bool own_group = job_control && !any_thread;
+  sigset_t old_mask;
+  jobs_block(&old_mask);
+  struct job *job = job_new(cmd, nstages);
+  if (job == NULL)
+  {
+    jobs_unblock(&old_mask);
+    printf("-%s: too many jobs\n", sysname);
+    free(stages);
+    free(rings);
+    return UNKNOWN;
+  }
+  job->own_group = own_group;
+  int stage = 0; // job içindeki aşama indexi
+
+  struct command_t *current = cmd; // Zincirde gezen pointer
+
+  while (current != NULL)
+  { // Zincirde komut olduğu sürece dön
+    // shell içinde thread mi
+    bool threaded = is_stream_builtin(current->name) && !background;
+    pid_t pgid = own_group ? job->pgid : -1; // 0: ilk process yeni grup açar
+    struct byte_ring *out_ring = NULL;                // sonraki thread'e ring
+
+    pipefd[0] = -1; // pipe yoksa işaret amaçlı -1
+    pipefd[1] = -1;
+
+    // Eğer son komut değilse çıktı bir sonraki komuta gidecek:
+    // iki builtin yan yanaysa ring, aksi halde gerçek pipe
+    if (current->next != NULL)
+    {
+      if (threaded && is_stream_builtin(current->next->name) && !background)
+      {
+        out_ring = ring_new();
+        if (out_ring == NULL)
+        {
+          ret = UNKNOWN;
+          break;
+        }
+        rings[nrings++] = out_ring;
+      }
+      else if (pipe2(pipefd, O_CLOEXEC) < 0)
+      {                 // pipe oluştur (başarısızsa hata)
+        perror("pipe"); // sistem hata mesajı bas
+        ret = UNKNOWN;
+        break;
+      }
+      // O_CLOEXEC: thread'lerin tuttuğu uçlar spawn edilen komutlara sızmasın
+      // (dup2 ile stdin/stdout'a bağlanan kopyalarda bu bayrak olmaz)
+    }
+
+    pid = -1; // başlatılamazsa -1 kalır
+    if (threaded)
+    {
+      // Stream builtin (ör: cut): fork yok, shell içinde thread olarak çalışır.
+      // Uçlar artık thread'e ait; bitince kendisi kapatır.
+      struct builtin_stage *st = &stages[nthreads];
+      st->command = current;
+      st->io.in_fd = in_fd;
+      st->io.in_ring = in_ring;
+      st->io.out_fd = (current->next != NULL) ? pipefd[1] : STDOUT_FILENO;
+      st->io.out_ring = out_ring;
+      if (pthread_create(&st->tid, NULL, builtin_stage_main, st) != 0)
+      {
+        printf("-%s: %s: cannot start thread\n", sysname, current->name);
+        ret = UNKNOWN;
+        break;
+      }
+      nthreads++;
+      if (current->next == NULL)
+        last_thread = st;
+    }
+    else if (!is_builtin_child(current->name))
+    {
+      // Dış komut: yolu parent'ta çöz (hash tablosu shell'de dolsun)
+      // ve spawn motoruyla başlat; pipe uçları file action olarak bağlanır.
+      // Plan cache'inden gelen aşamanın yolu zaten çözülmüştür.
+      char *resolved_path = current->path != NULL ? strdup(current->path)
+                                                  : resolve_executable_path(current->name);
+      if (resolved_path == NULL)
+      {
+        printf("-%s: %s: command not found\n", sysname, current->name);
+      }
+      else
+      {
+        int err = spawn_command(resolved_path, current->args, in_fd, pipefd[1],
+                                pipefd[0], current->redirects, pgid,
+                                own_group && !background, &pid);
+        if (err != 0)
+          printf("-%s: %s: %s\n", sysname, current->name, strerror(err));
+        free(resolved_path); // parent'ın kopyasını temizle
+      }
+    }
+    else
+    {
+      // Builtin: child içinde çalışması gerektiği için düz fork kullan
+      int64_t t_fork = trace_begin();
+      fflush(stdout); // child'a yarım stdio buffer'ı kopyalanmasın
+      pid = fork();   // Yeni child process oluştur
+      if (pid < 0)
+      {                 // fork başarısızsa
+        perror("fork"); // hata yaz
+        ret = UNKNOWN;
+        break;
+      }
+
+      if (pid == 0)
+      {
+        // =========================
+        // CHILD PROCESS
+        // =========================
+
+        if (pgid >= 0)
+        {
+          setpgid(0, pgid); // job'ın process group'u
+          if (!background)
+            tcsetpgrp(STDIN_FILENO, pgid == 0 ? getpid() : pgid);
+        }
+        reset_child_signals(); // shell'in ignore/bloklarını geri al
+
+        // Eğer önceki komuttan gelen bir input fd varsa, stdin'e bağla
+        if (in_fd != STDIN_FILENO)
+        {                            // stdin değilse (yani pipe read end)
+          dup2(in_fd, STDIN_FILENO); // stdin(0) artık in_fd olsun
+          close(in_fd);              // eski fd'yi kapat
+        }
+
+        // Eğer son komut değilsek, stdout'u pipe'ın write end'ine bağla
+        if (current->next != NULL)
+        {                                 // bir sonraki komut varsa
+          close(pipefd[0]);               // child read end'i kullanmayacak, kapat
+          dup2(pipefd[1], STDOUT_FILENO); // stdout(1) -> pipe write
+          close(pipefd[1]);               // write end artık dup edildi, kapat
+        }
+
+        // Thread aşamalarının pipe uçları exec olmadığı için kendiliğinden
+        // kapanmaz: 0-2 dışındaki her şeyi kapat ki okuyanlar EOF görsün
+        // (trace fd'si de kapanır; numarası yeniden kullanılabileceği için
+        // bu child'da izleme kapalı)
+        trace_fd = -1;
+        close_range(3, ~0U, 0);
+
+        // <, >, >> varsa pipe'tan sonra uygula (bash gibi redirect kazanır)
+        apply_redirects_in_child(current->redirects);
+
+        // builtin'i çalıştır (help/repeat/chatroom)
+        int br = run_builtin_child(current); // builtin'i çalıştır
+        fflush(stdout);                      // exit'ten önce çıktıyı boşalt
+        exit(br == SUCCESS ? 0 : 1);         // başarılıysa 0, değilse 1 ile çık
+      }
+      trace_thread_name(pid, current->name);
+      trace_span("fork", t_fork, 0, "builtin", current->name, NULL);
+    }
+
+    // =========================
+    // PARENT PROCESS
+    // =========================
+
+    if (!threaded && pid > 0)
+    {
+      if (pgid >= 0)
+        setpgid(pid, pgid == 0 ? pid : pgid); // parent da ayarlar (yarış olmasın)
+      job_add_proc(job, stage, pid);          // aşamayı job'a kaydet
+    }
+    stage++;
+
+    if (current->next == NULL && !threaded)
+      last_status = 127; // başlatılamadıysa "bulunamadı" kalsın
+
+    if (!threaded)
+    {
+      // Parent artık eski in_fd'yi tutmasın (zincir ilerledi)
+      if (in_fd != STDIN_FILENO)
+        close(in_fd); // önceki pipe read end kapanır
+      // parent write end'i kapatır (child'da kopyası var)
+      if (pipefd[1] >= 0)
+        close(pipefd[1]);
+    }
+
+    // next komut stdin'ini buradan okuyacak (pipe read end veya ring)
+    in_fd = (pipefd[0] >= 0) ? pipefd[0] : STDIN_FILENO;
+    in_ring = out_ring;
+
+    current = current->next; // zincirde bir sonraki komuta geç
+  }
+
+  // Kurulum yarıda kaldıysa sahipsiz kalan uçları kapat
+  if (ret != SUCCESS)
+  {
+    if (in_fd != STDIN_FILENO)
+      close(in_fd);
+    if (pipefd[1] >= 0)
+      close(pipefd[1]);
+    if (in_ring != NULL)
+      ring_close_read(in_ring); // bekleyen yazıcı thread takılmasın
+  }
+
+  if (background)
+  {
+    // Arka plan: beklemeden dön, handler toplar
+    if (job_control)
+      printf("[%d] %d\n", job->id, (int)job->pgid);
+    if (job->running == 0)
+      job_free(job); // hiçbir process başlamadı
+    jobs_unblock(&old_mask);
+    last_status = 0;
+  }
+  else
+  {
+    // Sadece bu pipeline'ın pid'lerini bekle (arka plandaki job'ları değil).
+    // Pipeline'ın durumu son komutun durumudur (bash gibi)
+    job_wait(job, &old_mask, true);
+    jobs_unblock(&old_mask);
+  }
+
+  // Builtin thread'lerinin bitmesini bekle
+  int64_t t_join = nthreads > 0 ? trace_begin() : 0;
+  for (int i = 0; i < nthreads; i++)
+    pthread_join(stages[i].tid, NULL);
+  trace_span("join", t_join, 0, NULL);
+  if (last_thread != NULL)
+    last_status = (last_thread->result == SUCCESS) ? 0 : 1;
+
+  for (int i = 0; i < nrings; i++)
+    ring_free(rings[i]);
+  free(rings);
+  free(stages);
+  return ret; // pipeline tamamlandı
+}
+
+// Builtin mi? (cut/chatroom/custom burada sayılacak)
+bool is_builtin_child(const char *name)
+{
+  if (!name)
+    return false;
+  return (strcmp(name, "cut") == 0) ||
+         (strcmp(name, "cat") == 0) ||
+         (strcmp(name, "tee") == 0) ||
+         (strcmp(name, "history") == 0) ||
+         (strcmp(name, "help") == 0) ||
+         (strcmp(name, "repeat") == 0) ||
+         (strcmp(name, "parallel") == 0) ||
+         (strcmp(name, "chatroom") == 0); // chatroom'u sonra yazacağız
+}
+
+// Builtin komutu çalıştırır (child içinde çağrılacak şekilde tasarlanır)
+// Başarılıysa SUCCESS, değilse UNKNOWN döner.
+int run_builtin_child(struct command_t *command);
+
+// "1,3,10" gibi alan listesini int dizisine çevirir
+// count: kaç tane alan çıktığını döndürür
+// Not: dönen dizi malloc/realloc ile ayrılır, sonunda free edilmelidir
+int *parse_fields_list(const char *s, int *count)
+{
+  *count = 0; // başlangıçta 0 alan
+
+  if (s == NULL)
+    return NULL; // liste yoksa NULL
+
+  char *copy = strdup(s); // strtok_r bozacağı için kopya al
+  if (copy == NULL)
+    return NULL; // kopya alınamazsa NULL
+
+  int *arr = NULL;               // dinamik alan dizisi
+  char *save = NULL;                     // strtok_r durumu (thread'lerde güvenli)
+  char *tok = strtok_r(copy, ",", &save); // virgüle göre böl
+
+  while (tok != NULL)
+  {                    // token oldukça devam et
+    int v = atoi(tok); // token'ı sayıya çevir
+    if (v > 0)
+    {                                                 // sadece 1+ değerleri kabul et
+      arr = realloc(arr, sizeof(int) * (*count + 1)); // diziyi büyüt
+      arr[*count] = v;                                // yeni alanı ekle
+      (*count)++;                                     // sayacı artır
+    }
+    tok = strtok_r(NULL, ",", &save); // sıradaki token
+  }
+
+  free(copy); // kopyayı temizle
+  return arr; // alan dizisini döndür
+}
+
+// ===== Çıktı buffer'ı =====
+// Builtin'ler çıktıyı tek büyük buffer'da biriktirip büyük write()'larla yazar
+// (satır başına putchar/fputs yerine).
+#define OUT_BUF_SIZE 65536
+
+struct out_buf
+{
+  int fd;                 // yazılacak fd
+  struct byte_ring *ring; // NULL değilse fd yerine ring'e yazılır
+  char *buf;              // biriktirme buffer'ı
+  size_t len;             // buffer'daki veri
+  size_t cap;             // buffer kapasitesi
+  bool failed;            // okuyan taraf kapandı (EPIPE): üretmeyi bırak
+  bool wrote;             // ilk çıktı yazıldı mı (trace "first_output")
+};
+
+void out_buf_init(struct out_buf *ob, int fd)
+{
+  fflush(stdout); // daha önce printf ile basılanlar önce çıksın
+  ob->fd = fd;
+  ob->ring = NULL;
+  ob->buf = malloc(OUT_BUF_SIZE);
+  ob->len = 0;
+  ob->cap = OUT_BUF_SIZE;
+  ob->failed = false;
+  ob->wrote = false;
+}
+
+// Bellek modu: hiçbir yere yazmaz, buffer gerektikçe büyür ve veri
+// buf[0..len) içinde kalır (paralel cut'ta chunk çıktıları için)
+void out_buf_init_mem(struct out_buf *ob, size_t cap)
+{
+  ob->fd = -1;
+  ob->ring = NULL;
+  ob->buf = malloc(cap);
+  ob->len = 0;
+  ob->cap = cap;
+  ob->failed = ob->buf == NULL;
+  ob->wrote = false;
+}
+
+// Çıktıyı aşamanın ucuna bağlar (ring varsa ring, yoksa fd)
+void out_buf_init_io(struct out_buf *ob, struct stage_io *io)
+{
+  out_buf_init(ob, io->out_fd);
+  ob->ring = io->out_ring;
+}
+
+// p[0..n) verisini fd'ye (veya ring'e) yazar (kısmi write'ları tamamlar)
+static int out_buf_emit(struct out_buf *ob, const char *p, size_t n)
+{
+  if (!ob->wrote && n > 0)
+  { // aşamanın ilk çıktısı: shell'in görebildiği tek "ilk çıktı" anı
+    ob->wrote = true;
+    trace_instant("first_output", 0, NULL);
+  }
+  if (ob->ring != NULL)
+  {
+    if (n > 0 && ring_write(ob->ring, p, n) < 0)
+      ob->failed = true; // sonraki aşama okumayı bıraktı
+    return ob->failed ? -1 : 0;
+  }
+
+  size_t off = 0;
+  while (off < n)
+  {
+    ssize_t w = write(ob->fd, p + off, n - off);
+    if (w < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      ob->failed = true; // okuyan kapattı (EPIPE) veya hata: çağıran üretmeyi bıraksın
+      return -1;
+    }
+    off += w;
+  }
+  return 0;
+}
+
+// Buffer'daki veriyi fd'ye (veya ring'e) yazar; hata olursa veri atılır
+int out_buf_flush(struct out_buf *ob)
+{
+  if (ob->fd < 0 && ob->ring == NULL)
+    return 0; // bellek modu: veri buffer'da kalır
+  int r = out_buf_emit(ob, ob->buf, ob->len);
+  ob->len = 0;
+  return r;
+}
+
+// Büyük bir bloğu buffer'a kopyalamadan yazar (önce bekleyenleri boşaltır)
+int out_buf_write(struct out_buf *ob, const char *p, size_t n)
+{
+  if (out_buf_flush(ob) != 0)
+    return -1;
+  return out_buf_emit(ob, p, n);
+}
+
+// n byte'ı buffer'a ekler, dolunca yazar
+void out_buf_put(struct out_buf *ob, const char *p, size_t n)
+{
+  if (ob->buf == NULL)
+  { // buffer ayrılamadıysa doğrudan yaz
+    if (ob->ring != NULL)
+      ring_write(ob->ring, p, n);
+    else
+      write(ob->fd, p, n);
+    return;
+  }
+  while (n > 0)
+  {
+    size_t room = ob->cap - ob->len; // kalan yer
+    if (room == 0 && ob->fd < 0 && ob->ring == NULL)
+    { // bellek modu: boşaltmak yerine büyü
+      char *nbuf = realloc(ob->buf, ob->cap * 2);
+      if (nbuf == NULL)
+      {
+        ob->failed = true;
+        return;
+      }
+      ob->buf = nbuf;
+      room = ob->cap;
+      ob->cap *= 2;
+    }
+    else if (room == 0)
+    {
+      out_buf_flush(ob);
+      room = ob->cap;
+    }
+    size_t c = n < room ? n : room;
+    memcpy(ob->buf + ob->len, p, c);
+    ob->len += c;
+    p += c;
+    n -= c;
+  }
+}
+
+void out_buf_free(struct out_buf *ob)
+{
+  free(ob->buf);
+  ob->buf = NULL;
+}
+
+// ===== Girdi katmanı =====
+// stdin'den okuyan builtin'ler getline/stdio yerine bunu kullanır.
+// - Normal dosya (ör: <file redirect): mmap + MADV_SEQUENTIAL, hiç kopya yok
+// - Pipe/terminal: büyük read() blokları
+// Her iki durumda da satırlar kopyalanmadan (pointer + uzunluk) döner.
+#define LINE_READER_BLOCK (256 * 1024) // pipe modunda read() blok boyutu
+
+struct line_reader
+{
+  int fd;          // okunan fd
+  struct byte_ring *ring; // NULL değilse fd yerine ring'den okunur
+  char *map;       // mmap modunda haritalanan bölge (NULL: read modu)
+  size_t map_len;  // haritalanan uzunluk
+  off_t map_base;  // haritanın dosyadaki başlangıç offset'i (sayfa hizalı)
+  char *buf;       // read modunda blok buffer'ı
+  size_t cap;      // buffer kapasitesi
+  size_t start;    // sıradaki satırın başı (map veya buf içinde)
+  size_t end;      // geçerli verinin sonu
+  bool eof;        // girdi bitti mi
+  bool got_input;  // ilk blok geldi mi (trace "first_input")
+};
+
+// fd için okuyucu hazırlar. Normal dosyalarda mevcut offset'ten itibaren
+// dosyayı mmap eder, diğerlerinde read buffer'ı ayırır. Hata: -1.
+int line_reader_open(struct line_reader *lr, int fd)
+{
+  memset(lr, 0, sizeof(*lr));
+  lr->fd = fd;
+
+  struct stat st;
+  off_t off = lseek(fd, 0, SEEK_CUR); // dosyanın neresindeyiz
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && off >= 0)
+  {
+    if (off >= st.st_size)
+    { // okunacak bir şey yok
+      lr->eof = true;
+      return 0;
+    }
+    long page = sysconf(_SC_PAGESIZE);
+    off_t base = off - (off % page); // mmap offset'i sayfa hizalı olmalı
+    size_t len = (size_t)(st.st_size - base);
+    void *m = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, base);
+    if (m != MAP_FAILED)
+    {
+      madvise(m, len, MADV_SEQUENTIAL); // kernel agresif read-ahead yapsın
+      lr->map = m;
+      lr->map_len = len;
+      lr->map_base = base;
+      lr->start = (size_t)(off - base);
+      lr->end = len;
+      return 0;
+    }
+    // mmap olmadıysa read moduna düş
+  }
+
+  lr->cap = LINE_READER_BLOCK;
+  lr->buf = malloc(lr->cap);
+  return lr->buf == NULL ? -1 : 0;
+}
+
+// Sıradaki satırı döndürür (sondaki '\n' hariç, '\0' ile bitmez!).
+// Satır uzunluğunu döner, girdi bittiyse -1.
+ssize_t line_reader_next(struct line_reader *lr, const char **line)
+{
+  char *base = lr->map != NULL ? lr->map : lr->buf;
+  while (1)
+  {
+    char *nl = memchr(base + lr->start, '\n', lr->end - lr->start);
+    if (nl != NULL)
+    { // tam satır bulundu
+      *line = base + lr->start;
+      size_t len = nl - (base + lr->start);
+      lr->start += len + 1;
+      return (ssize_t)len;
+    }
+
+    if (lr->map != NULL || lr->eof)
+    { // '\n' ile bitmeyen son satır
+      if (lr->start == lr->end)
+        return -1;
+      *line = base + lr->start;
+      size_t len = lr->end - lr->start;
+      lr->start = lr->end;
+      return (ssize_t)len;
+    }
+
+    // read modu: yarım satırı başa kaydır, gerekirse büyüt, yeni blok oku
+    if (lr->start > 0)
+    {
+      memmove(lr->buf, lr->buf + lr->start, lr->end - lr->start);
+      lr->end -= lr->start;
+      lr->start = 0;
+    }
+    if (lr->end == lr->cap)
+    {
+      char *nbuf = realloc(lr->buf, lr->cap * 2); // buffer'dan uzun satır
+      if (nbuf == NULL)
+        return -1;
+      lr->buf = nbuf;
+      lr->cap *= 2;
+      base = lr->buf;
+    }
+    ssize_t n = (lr->ring != NULL)
+                    ? ring_read(lr->ring, lr->buf + lr->end, lr->cap - lr->end)
+                    : read(lr->fd, lr->buf + lr->end, lr->cap - lr->end);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+      lr->eof = true;
+    else
+    {
+      if (!lr->got_input)
+      { // önceki aşamanın (ör: dış komutun) ilk çıktısı shell'e ulaştı
+        lr->got_input = true;
+        trace_instant("first_input", 0, NULL);
+      }
+      lr->end += n;
+    }
+  }
+}
+
+// Buffer'da (read() yapmadan) dönülebilecek tam bir satır var mı?
+bool line_reader_has_line(struct line_reader *lr)
+{
+  if (lr->map != NULL)
+    return lr->start < lr->end;
+  return lr->buf != NULL && memchr(lr->buf + lr->start, '\n', lr->end - lr->start) != NULL;
+}
+
+// Aşamanın girdi ucu için okuyucu hazırlar (ring varsa ring, yoksa fd)
+int line_reader_open_io(struct line_reader *lr, struct stage_io *io)
+{
+  if (io->in_ring == NULL)
+    return line_reader_open(lr, io->in_fd);
+
+  memset(lr, 0, sizeof(*lr));
+  lr->fd = -1;
+  lr->ring = io->in_ring;
+  lr->cap = LINE_READER_BLOCK;
+  lr->buf = malloc(lr->cap);
+  return lr->buf == NULL ? -1 : 0;
+}
+
+// Okuyucuyu kapatır. mmap modunda fd offset'i tüketilen yere taşınır
+// (read() ile okunmuş gibi davranır).
+void line_reader_close(struct line_reader *lr)
+{
+  if (lr->map != NULL)
+  {
+    lseek(lr->fd, lr->map_base + (off_t)lr->start, SEEK_SET);
+    munmap(lr->map, lr->map_len);
+  }
+  free(lr->buf);
+  memset(lr, 0, sizeof(*lr));
+}
+
+// cut seçenekleri (parse edildikten sonra salt okunur, thread'ler paylaşır)
+struct cut_spec
+{
+  char delim;    // alan ayırıcı
+  int *fields;   // istenen alanlar (1-based, istenen sırada)
+  int fcount;    // fields uzunluğu
+  int max_field; // en büyük istenen alan: satırda bundan sonrası taranmaz
+};
+
+// Tek satırın seçilen alanlarını out'a yazar (line '\n' içermez).
+// span_ptr/span_len: çağırana ait, max_field elemanlık çalışma alanı.
+static inline void cut_line(const struct cut_spec *cs, const char *line, size_t len,
+                            const char **span_ptr, size_t *span_len, struct out_buf *out)
+{
+  // Tek geçişte alanları bul: memchr ile delimiter ara,
+  // max_field'a ulaşınca dur. (strtok gibi boş alanlar atlanır)
+  char delim = cs->delim;
+  int tok_count = 0; // bulunan alan sayısı
+  const char *p = line;
+  const char *end = line + len;
+  while (tok_count < cs->max_field && p < end)
+  {
+    while (p < end && *p == delim)
+      p++; // ardışık delimiter'ları atla
+    if (p == end)
+      break;
+    const char *d = memchr(p, delim, end - p); // sıradaki delimiter
+    if (d == NULL)
+      d = end; // son alan
+    span_ptr[tok_count] = p;
+    span_len[tok_count] = d - p;
+    tok_count++;
+    p = d + 1; // delimiter'ın arkasına geç
+  }
+
+  // İstenen field'ları sırayla bas (1-based)
+  for (int k = 0; k < cs->fcount; k++)
+  {                           // her istenen field
+    int want = cs->fields[k]; // 1-based alan no
+
+    if (k > 0)
+      out_buf_put(out, &delim, 1); // araya delimiter koy
+    if (want <= tok_count)          // aralık kontrolü (yoksa boş)
+      out_buf_put(out, span_ptr[want - 1], span_len[want - 1]);
+  }
+
+  out_buf_put(out, "\n", 1); // satır sonu
+}
+
+/*
+ * ===== Paralel cut =====
+ * Girdi mmap edilmiş büyük bir normal dosyaysa (cut ... <huge.csv) bölge
+ * satır sonuna hizalı chunk'lara bölünür ve bir thread havuzunda işlenir.
+ * Her chunk'ın çıktısı reorder buffer'daki bir slota (bellek modunda
+ * out_buf) yazılır; çağıran thread slotları chunk sırasıyla çıktıya basar,
+ * böylece çıktı seri cut ile birebir aynıdır. Slot sayısı sınırlı
+ * (2 x thread) olduğu için yazma yavaşsa işçiler bekler, bellek büyümez.
+ * Küçük girdiler, pipe'lar ve -j 1 seri yoldan gider.
+ */
+#define CUT_PAR_MIN (8 << 20)    // bundan küçük girdiler seri işlenir
+#define CUT_CHUNK_SIZE (4 << 20) // bir işin yaklaşık boyu (satır sonuna uzatılır)
+#define CUT_MAX_THREADS 64       // en fazla işçi thread
+
+enum cut_slot_states
+{
+  CUT_SLOT_FREE = 0, // yazıldı, yeni chunk alabilir
+  CUT_SLOT_BUSY,     // bir işçi dolduruyor
+  CUT_SLOT_READY,    // dolu, sırası gelince yazılacak
+};
+
+struct cut_slot
+{
+  long idx;           // bu slottaki chunk'ın sırası
+  int state;          // CUT_SLOT_*
+  struct out_buf out; // chunk'ın çıktısı (bellek modu)
+};
+
+struct cut_par
+{
+  const struct cut_spec *cs;
+  const char *next;       // sıradaki chunk'ın başı
+  const char *end;        // verinin sonu
+  long nchunks;           // dağıtılan chunk sayısı
+  bool all_assigned;      // veri bitti, yeni chunk yok
+  bool stop;              // hata: herkes dursun
+  struct cut_slot *slots; // reorder buffer (chunk i -> slots[i % nslots])
+  int nslots;
+  pthread_mutex_t lock;
+  pthread_cond_t cond; // slot boşaldı / chunk hazır / dağıtım bitti
+};
+
+// İşçi: sıradaki chunk'ı alır, slotu boşalınca doldurur, hazır işaretler
+static void *cut_worker(void *arg)
+{
+  struct cut_par *cp = arg;
+  const struct cut_spec *cs = cp->cs;
+  const char **span_ptr = malloc(sizeof(char *) * cs->max_field);
+  size_t *span_len = malloc(sizeof(size_t) * cs->max_field);
+
+  pthread_mutex_lock(&cp->lock);
+  if (span_ptr == NULL || span_len == NULL)
+    cp->stop = true;
+  while (!cp->stop && !cp->all_assigned)
+  {
+    // Chunk sınırı: CUT_CHUNK_SIZE ilerisindeki ilk '\n'den sonrası
+    long idx = cp->nchunks++;
+    const char *start = cp->next;
+    const char *stop_at = cp->end;
+    if ((size_t)(cp->end - start) > CUT_CHUNK_SIZE)
+    {
+      const char *nl = memchr(start + CUT_CHUNK_SIZE, '\n',
+                              cp->end - (start + CUT_CHUNK_SIZE));
+      if (nl != NULL)
+        stop_at = nl + 1;
+    }
+    cp->next = stop_at;
+    if (cp->next >= cp->end)
+      cp->all_assigned = true;
+
+    // Slot, chunk idx - nslots yazılınca boşalır
+    struct cut_slot *slot = &cp->slots[idx % cp->nslots];
+    while (!cp->stop && slot->state != CUT_SLOT_FREE)
+      pthread_cond_wait(&cp->cond, &cp->lock);
+    if (cp->stop)
+      break;
+    slot->state = CUT_SLOT_BUSY;
+    slot->idx = idx;
+    pthread_mutex_unlock(&cp->lock);
+
+    int64_t t0 = trace_begin();
+    slot->out.len = 0;
+    for (const char *p = start; p < stop_at && !slot->out.failed;)
+    {
+      const char *nl = memchr(p, '\n', stop_at - p);
+      size_t len = (nl != NULL ? nl : stop_at) - p;
+      cut_line(cs, p, len, span_ptr, span_len, &slot->out);
+      p += len + 1;
+    }
+    trace_span("cut_chunk", t0, 0, NULL);
+
+    pthread_mutex_lock(&cp->lock);
+    if (slot->out.failed)
+      cp->stop = true; // bellek yetmedi
+    slot->state = CUT_SLOT_READY;
+    pthread_cond_broadcast(&cp->cond);
+  }
+  pthread_cond_broadcast(&cp->cond); // dağıtım bitti / durdu: yazıcı uyansın
+  pthread_mutex_unlock(&cp->lock);
+
+  free(span_ptr);
+  free(span_len);
+  return NULL;
+}
+
+// [data, end) bölgesini nthreads işçiyle işler, sırayla out'a yazar
+static void cut_parallel(const struct cut_spec *cs, const char *data, const char *end,
+                         int nthreads, struct out_buf *out)
+{
+  struct cut_par cp = {0};
+  cp.cs = cs;
+  cp.next = data;
+  cp.end = end;
+  cp.nslots = nthreads * 2;
+  cp.slots = calloc(cp.nslots, sizeof(struct cut_slot));
+  pthread_t *tids = calloc(nthreads, sizeof(pthread_t));
+  if (cp.slots == NULL || tids == NULL)
+  {
+    free(cp.slots);
+    free(tids);
+    out->failed = true;
+    return;
+  }
+  for (int i = 0; i < cp.nslots; i++)
+    out_buf_init_mem(&cp.slots[i].out, CUT_CHUNK_SIZE);
+  pthread_mutex_init(&cp.lock, NULL);
+  pthread_cond_init(&cp.cond, NULL);
+
+  // İşçiler hiçbir sinyali almasın (SIGCHLD handler'ı ana thread'de kalsın)
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+  int started = 0;
+  for (; started < nthreads; started++)
+    if (pthread_create(&tids[started], NULL, cut_worker, &cp) != 0)
+      break;
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+
+  // Yazıcı: chunk'ları sırasıyla bekle ve bas
+  for (long idx = 0; started > 0; idx++)
+  {
+    struct cut_slot *slot = &cp.slots[idx % cp.nslots];
+    pthread_mutex_lock(&cp.lock);
+    while (!cp.stop && !(slot->state == CUT_SLOT_READY && slot->idx == idx) &&
+           !(cp.all_assigned && idx >= cp.nchunks))
+      pthread_cond_wait(&cp.cond, &cp.lock);
+    bool ready = !cp.stop && slot->state == CUT_SLOT_READY && slot->idx == idx;
+    pthread_mutex_unlock(&cp.lock);
+    if (!ready)
+      break; // hepsi yazıldı veya hata
+
+    bool failed = out_buf_write(out, slot->out.buf, slot->out.len) != 0;
+
+    pthread_mutex_lock(&cp.lock);
+    slot->state = CUT_SLOT_FREE;
+    if (failed)
+      cp.stop = true; // okuyan kapandı: işçiler dursun
+    pthread_cond_broadcast(&cp.cond);
+    pthread_mutex_unlock(&cp.lock);
+  }
+  if (started == 0 || cp.stop)
+    out->failed = true;
+
+  for (int i = 0; i < started; i++)
+    pthread_join(tids[i], NULL);
+  for (int i = 0; i < cp.nslots; i++)
+    out_buf_free(&cp.slots[i].out);
+  pthread_mutex_destroy(&cp.lock);
+  pthread_cond_destroy(&cp.cond);
+  free(cp.slots);
+  free(tids);
+}
+
+// cut builtin: girdiden satır okur, delimiter'a göre böler, seçilen alanları basar
+// io: girdi/çıktı uçları (shell'de stdin/stdout, pipeline thread'inde pipe/ring)
+// -j N / --threads N: büyük dosya girdisinde işçi sayısı (varsayılan: CPU sayısı)
+int cut_stream(struct command_t *command, struct stage_io *io)
+{
+  struct cut_spec cs = {'\t', NULL, 0, 0}; // varsayılan delimiter TAB
+  const char *fields_str = NULL;           // -f/--fields ile gelecek liste
+  int nthreads = 0;                        // 0: CPU sayısı kadar
+
+  // Argümanları tara: -d/--delimiter, -f/--fields ve -j/--threads
+  for (int i = 1; command->args[i] != NULL; i++)
+  { // args[0]=cut
+    // delimiter seçeneği
+    if ((strcmp(command->args[i], "-d") == 0 || strcmp(command->args[i], "--delimiter") == 0) &&
+        command->args[i + 1] != NULL)
+    {
+      cs.delim = command->args[i + 1][0]; // tek karakter al
+      i++;                                // bir sonraki arg tüketildi
+    }
+    // fields seçeneği
+    else if ((strcmp(command->args[i], "-f") == 0 || strcmp(command->args[i], "--fields") == 0) &&
+             command->args[i + 1] != NULL)
+    {
+      fields_str = command->args[i + 1]; // "1,3,10" gibi liste
+      i++;                               // bir sonraki arg tüketildi
+    }
+    // thread sayısı seçeneği
+    else if ((strcmp(command->args[i], "-j") == 0 || strcmp(command->args[i], "--threads") == 0) &&
+             command->args[i + 1] != NULL)
+    {
+      nthreads = atoi(command->args[i + 1]); // 1: her zaman seri
+      i++;
+    }
+  }
+
+  // -f verilmediyse hata
+  if (fields_str == NULL)
+  {
+    printf("-%s: cut: missing -f/--fields option\n", sysname); // hata mesajı
+    return UNKNOWN;                                            // başarısız
+  }
+
+  // Field listesini parse et
+  cs.fields = parse_fields_list(fields_str, &cs.fcount); // listeyi dizi yap
+  if (cs.fields == NULL || cs.fcount == 0)
+  {
+    printf("-%s: cut: invalid fields list\n", sysname); // hata mesajı
+    free(cs.fields);                                    // temizlik
+    return UNKNOWN;                                     // başarısız
+  }
+
+  // En büyük istenen alan: satırda bundan sonrasını taramaya gerek yok
+  for (int k = 0; k < cs.fcount; k++)
+    if (cs.fields[k] > cs.max_field)
+      cs.max_field = cs.fields[k];
+
+  // Alan başlangıç/uzunlukları (satır başına malloc yok, bir kez ayrılır)
+  const char **span_ptr = malloc(sizeof(char *) * cs.max_field);
+  size_t *span_len = malloc(sizeof(size_t) * cs.max_field);
+  if (span_ptr == NULL || span_len == NULL)
+  {
+    free(span_ptr);
+    free(span_len);
+    free(cs.fields);
+    return UNKNOWN;
+  }
+
+  struct out_buf out;           // tüm çıktı tek büyük buffer'dan yazılır
+  out_buf_init_io(&out, io);
+
+  struct line_reader in; // girdi (dosyaysa mmap, pipe ise büyük read, ring)
+  if (line_reader_open_io(&in, io) != 0)
+  {
+    free(span_ptr);
+    free(span_len);
+    free(cs.fields);
+    out_buf_free(&out);
+    return UNKNOWN;
+  }
+
+  // Paralel mod: sadece mmap edilmiş, yeterince büyük girdi
+  size_t remaining = in.end - in.start;
+  if (nthreads <= 0)
+    nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+  if ((size_t)nthreads > remaining / CUT_CHUNK_SIZE + 1)
+    nthreads = (int)(remaining / CUT_CHUNK_SIZE + 1); // chunk'tan fazla işçi olmasın
+  if (nthreads > CUT_MAX_THREADS)
+    nthreads = CUT_MAX_THREADS;
+
+  if (in.map != NULL && nthreads > 1 && remaining >= CUT_PAR_MIN)
+  {
+    cut_parallel(&cs, in.map + in.start, in.map + in.end, nthreads, &out);
+    in.start = in.end; // hepsi tüketildi (close fd offset'ini sona taşır)
+  }
+  else
+  {
+    const char *line; // satır başı (kopya değil, okuyucunun belleği)
+    ssize_t r;        // okunan satır uzunluğu ('\n' hariç)
+
+    // girdiden satır satır oku (sonraki aşama kapandıysa dur)
+    while (!out.failed && (r = line_reader_next(&in, &line)) != -1)
+      cut_line(&cs, line, (size_t)r, span_ptr, span_len, &out);
+  }
+
+  out_buf_flush(&out); // kalan çıktıyı yaz
+  out_buf_free(&out);
+  line_reader_close(&in);
+  free(span_ptr);
+  free(span_len);
+  free(cs.fields); // fields dizisini temizle
+  return SUCCESS;  // başarılı
+}
+
+// cut builtin'i shell'in stdin/stdout'u ile çalıştırır
+int run_cut_builtin(struct command_t *command)
+{
+  struct stage_io io = {STDIN_FILENO, NULL, STDOUT_FILENO, NULL};
+  return cut_stream(command, &io);
+}
+
+// Pipeline thread'inden çağrılır: stream builtin'i aşamanın uçlarıyla çalıştırır
+int run_stream_builtin(struct command_t *command, struct stage_io *io)
+{
+  if (strcmp(command->name, "cut") == 0)
+    return cut_stream(command, io);
+  return UNKNOWN;
+}
+
+/*
+ * ===== cat / tee (kopyasız) =====
+ * Veri mümkün olduğunca kullanıcı alanına hiç girmeden taşınır:
+ * - dosya -> dosya : copy_file_range (aynı fs'te reflink/sunucu taraflı kopya)
+ * - bir uç pipe    : splice (sayfalar pipe'a/pipe'tan taşınır)
+ * - dosya -> diğer : sendfile
+ * - tee            : tee(2) pipe içeriğini tüketmeden çoğaltır
+ * fd türü desteklemiyorsa (EINVAL, EXDEV, ...) sıradaki yönteme, en son
+ * read/write'a düşülür. Tüm çağrılar dosya offset'lerini kullandığı için
+ * kopyanın ortasında yöntem değiştirmek güvenlidir.
+ */
+#define ZC_CHUNK (1 << 20)       // tek çağrıda taşınacak en fazla byte
+#define ZC_COPY_BUF (128 * 1024) // read/write yedeği için buffer
+
+// Kernel içi yöntem bu fd çifti için desteklenmiyor mu (yedeğe düşülsün)
+static bool zc_unsupported(int err)
+{
+  return err == EINVAL || err == ENOSYS || err == EXDEV || err == EOPNOTSUPP;
+}
+
+// n byte'ın hepsini yazar (kısmi write'ları tamamlar). Hata: -1.
+static int zc_write_all(int fd, const char *p, size_t n)
+{
+  while (n > 0)
+  {
+    ssize_t w = write(fd, p, n);
+    if (w < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return -1;
+    }
+    p += w;
+    n -= w;
+  }
+  return 0;
+}
+
+/*
+ * in'den EOF'a kadar okuyup out'a yazar.
+ * Dönüş: 0 başarılı, -1 hata (errno ayarlı).
+ */
+int zc_copy(int in, int out)
+{
+  struct stat ist, ost;
+  if (fstat(in, &ist) != 0 || fstat(out, &ost) != 0)
+    return -1;
+  bool in_reg = S_ISREG(ist.st_mode), out_reg = S_ISREG(ost.st_mode);
+  bool append = (fcntl(out, F_GETFL) & O_APPEND) != 0;
+  ssize_t n;
+
+  // "cat f >>f" sonsuza kadar büyümesin (GNU cat gibi reddet)
+  if (in_reg && out_reg && ist.st_dev == ost.st_dev && ist.st_ino == ost.st_ino &&
+      ist.st_size > 0)
+  {
+    errno = EINVAL;
+    return -1;
+  }
+
+  // dosya -> dosya (O_APPEND'de copy_file_range EBADF verir, atla)
+  if (in_reg && out_reg && !append)
+  {
+    while ((n = copy_file_range(in, NULL, out, NULL, ZC_CHUNK, 0)) > 0 ||
+           (n < 0 && errno == EINTR))
+      ;
+    if (n == 0)
+      return 0;
+    if (!zc_unsupported(errno))
+      return -1;
+  }
+
+  // uçlardan biri pipe: splice
+  if (S_ISFIFO(ist.st_mode) || S_ISFIFO(ost.st_mode))
+  {
+    while ((n = splice(in, NULL, out, NULL, ZC_CHUNK, SPLICE_F_MOVE | SPLICE_F_MORE)) > 0 ||
+           (n < 0 && errno == EINTR))
+      ;
+    if (n == 0)
+      return 0;
+    if (!zc_unsupported(errno))
+      return -1;
+  }
+
+  // dosya -> soket/diğer: sendfile
+  if (in_reg)
+  {
+    while ((n = sendfile(out, in, NULL, ZC_CHUNK)) > 0 || (n < 0 && errno == EINTR))
+      ;
+    if (n == 0)
+      return 0;
+    if (!zc_unsupported(errno))
+      return -1;
+  }
+
+  // yedek: kullanıcı alanından kopya (terminal, O_APPEND, eski kernel ...)
+  char *buf = malloc(ZC_COPY_BUF);
+  if (buf == NULL)
+    return -1;
+  int ret = 0;
+  while (1)
+  {
+    n = read(in, buf, ZC_COPY_BUF);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n <= 0)
+    {
+      ret = (n < 0) ? -1 : 0;
+      break;
+    }
+    if (zc_write_all(out, buf, n) != 0)
+    {
+      ret = -1;
+      break;
+    }
+  }
+  int saved = errno;
+  free(buf);
+  errno = saved;
+  return ret;
+}
+
+// cat builtin: dosyaları (yoksa veya "-" ise stdin'i) sırayla stdout'a yazar
+// cat [file...]
+int run_cat_builtin(struct command_t *command)
+{
+  fflush(stdout); // önceki printf çıktısı dosya verisinden önce çıksın
+  int ret = SUCCESS;
+  char *stdin_only[] = {"-", NULL}; // argüman yoksa sadece stdin
+  char **files = command->args[1] != NULL ? command->args + 1 : stdin_only;
+  for (int i = 0; files[i] != NULL; i++)
+  {
+    const char *name = files[i];
+    int fd = strcmp(name, "-") == 0 ? STDIN_FILENO : open(name, O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+      printf("-%s: cat: %s: %s\n", sysname, name, strerror(errno));
+      ret = UNKNOWN;
+      continue;
+    }
+    if (zc_copy(fd, STDOUT_FILENO) != 0)
+    {
+      printf("-%s: cat: %s: %s\n", sysname, name,
+             errno == EINVAL ? "input file is output file" : strerror(errno));
+      ret = UNKNOWN;
+    }
+    if (fd != STDIN_FILENO)
+      close(fd);
+  }
+  fflush(stdout); // hata mesajları
+  return ret;
+}
+
+enum tee_kinds
+{
+  TEE_PIPE = 0, // çıktı bir pipe: tee(2) doğrudan ona
+  TEE_FILE,     // normal dosya: tee(2) -> ara pipe -> splice(dosya)
+  TEE_COPY,     // diğer (terminal, O_APPEND ...): kullanıcı alanından write
+};
+
+struct tee_out
+{
+  const char *name; // hata mesajı için ("-": stdout)
+  int fd;           // çıktı fd'si
+  int kind;         // TEE_*
+  int pipe[2];      // TEE_FILE için ara pipe
+  ssize_t got;      // bu turda kernel içinde aldığı byte
+  bool failed;      // yazma hatası: bu çıktı bırakıldı
+};
+
+// Çıktıyı kullanıcı alanı kopyasına çevirir (kernel yolu desteklemiyor)
+static void tee_to_copy(struct tee_out *o)
+{
+  if (o->kind == TEE_FILE)
+  {
+    close(o->pipe[0]);
+    close(o->pipe[1]);
+  }
+  o->kind = TEE_COPY;
+}
+
+static void tee_fail(struct tee_out *o)
+{
+  printf("-%s: tee: %s: %s\n", sysname, strcmp(o->name, "-") == 0 ? "standard output" : o->name,
+         strerror(errno));
+  o->failed = true;
+}
+
+// TEE_FILE çıktısının ara pipe'ındaki n byte'ı dosyaya taşır. splice
+// desteklenmiyorsa kalanı read/write ile boşaltır ve çıktıyı TEE_COPY yapar.
+static void tee_drain(struct tee_out *o, size_t n, char *buf, size_t cap)
+{
+  while (n > 0)
+  {
+    ssize_t s = splice(o->pipe[0], NULL, o->fd, NULL, n, SPLICE_F_MOVE | SPLICE_F_MORE);
+    if (s < 0 && errno == EINTR)
+      continue;
+    if (s > 0)
+    {
+      n -= s;
+      continue;
+    }
+    bool fallback = s < 0 && zc_unsupported(errno);
+    if (!fallback)
+      tee_fail(o);
+    while (n > 0) // ara pipe her durumda boşalmalı
+    {
+      ssize_t r = read(o->pipe[0], buf, n < cap ? n : cap);
+      if (r <= 0)
+        break;
+      if (fallback && !o->failed && zc_write_all(o->fd, buf, r) != 0)
+        tee_fail(o);
+      n -= r;
+    }
+    tee_to_copy(o);
+  }
+}
+
+/*
+ * stdin'i tüm çıktılara kopyalar. stdin bir pipe ise her turda:
+ * 1. tee(2) ile içerik, tüketilmeden her kernel-yolu çıktısına çoğaltılır
+ *    (ilk çıktının aldığı miktar turun boyu m olur)
+ * 2. dosya çıktılarının ara pipe'ları splice ile dosyaya boşaltılır
+ * 3. stdin'den m byte tüketilir: kimse eksik almadıysa /dev/null'a splice,
+ *    eksik alan (pipe doluydu) veya TEE_COPY çıktısı varsa read() ile
+ *    buffer'a alınıp eksik kısımları write() edilir
+ * stdin pipe değilse hepsi TEE_COPY'dir (düz read/write döngüsü).
+ */
+static int tee_stream(struct tee_out *outs, int nouts)
+{
+  struct stat st;
+  bool in_pipe = fstat(STDIN_FILENO, &st) == 0 && S_ISFIFO(st.st_mode);
+  int cap = in_pipe ? fcntl(STDIN_FILENO, F_GETPIPE_SZ) : 0;
+  if (cap < 65536)
+    cap = 65536;
+  int devnull = in_pipe ? open("/dev/null", O_WRONLY | O_CLOEXEC) : -1;
+
+  for (int i = 0; i < nouts; i++)
+  {
+    struct tee_out *o = &outs[i];
+    o->kind = TEE_COPY;
+    if (!in_pipe || fstat(o->fd, &st) != 0)
+      continue;
+    if (S_ISFIFO(st.st_mode))
+      o->kind = TEE_PIPE;
+    else if (S_ISREG(st.st_mode) && !(fcntl(o->fd, F_GETFL) & O_APPEND) &&
+             pipe2(o->pipe, O_CLOEXEC) == 0)
+    {
+      fcntl(o->pipe[1], F_SETPIPE_SZ, cap); // stdin kadar yer: tee kısa kalmasın
+      o->kind = TEE_FILE;
+    }
+  }
+
+  char *buf = malloc(cap);
+  if (buf == NULL)
+    return UNKNOWN;
+  int ret = SUCCESS;
+  while (1)
+  {
+    ssize_t m = -1; // turun boyu (henüz bilinmiyor)
+    int alive = 0;
+    for (int i = 0; i < nouts; i++)
+    {
+      struct tee_out *o = &outs[i];
+      o->got = 0;
+      if (o->failed)
+        continue;
+      alive++;
+      if (o->kind == TEE_COPY)
+        continue;
+      int dst = (o->kind == TEE_PIPE) ? o->fd : o->pipe[1];
+      ssize_t n;
+      do
+        n = tee(STDIN_FILENO, dst, m < 0 ? ZC_CHUNK : (size_t)m, 0);
+      while (n < 0 && errno == EINTR);
+      if (n < 0)
+      {
+        if (zc_unsupported(errno))
+          tee_to_copy(o);
+        else
+          tee_fail(o);
+        continue;
+      }
+      if (m < 0)
+        m = n; // 0: EOF
+      o->got = n;
+    }
+    if (alive == 0 || m == 0)
+      break; // yazacak çıktı kalmadı veya EOF
+
+    for (int i = 0; i < nouts; i++)
+      if (outs[i].kind == TEE_FILE && !outs[i].failed && outs[i].got > 0)
+        tee_drain(&outs[i], outs[i].got, buf, cap);
+
+    bool need_copy = false;
+    for (int i = 0; i < nouts; i++)
+      if (!outs[i].failed && (outs[i].kind == TEE_COPY || outs[i].got < m))
+        need_copy = true;
+
+    if (m < 0)
+    { // kernel yolu olan çıktı yok: düz read
+      do
+        m = read(STDIN_FILENO, buf, cap);
+      while (m < 0 && errno == EINTR);
+      if (m <= 0)
+      {
+        if (m < 0)
+          ret = UNKNOWN;
+        break;
+      }
+    }
+    else
+    { // çoğaltılan m byte'ı stdin'den tüket
+      size_t off = 0;
+      while (!need_copy && off < (size_t)m)
+      {
+        ssize_t s = splice(STDIN_FILENO, NULL, devnull, NULL, m - off, SPLICE_F_MOVE);
+        if (s < 0 && errno == EINTR)
+          continue;
+        if (s <= 0)
+          need_copy = true; // /dev/null'a splice olmadı: kalanı read ile
+        else
+          off += s;
+      }
+      while (need_copy && off < (size_t)m)
+      {
+        ssize_t r = read(STDIN_FILENO, buf + off, m - off);
+        if (r < 0 && errno == EINTR)
+          continue;
+        if (r <= 0)
+          break;
+        off += r;
+      }
+      m = off;
+    }
+
+    for (int i = 0; i < nouts && need_copy; i++)
+    {
+      struct tee_out *o = &outs[i];
+      if (!o->failed && o->got < m &&
+          zc_write_all(o->fd, buf + o->got, m - o->got) != 0)
+        tee_fail(o);
+    }
+  }
+
+  for (int i = 0; i < nouts; i++)
+  {
+    if (outs[i].failed)
+      ret = UNKNOWN;
+    if (outs[i].kind == TEE_FILE)
+      tee_to_copy(&outs[i]); // ara pipe'ı kapat
+  }
+  if (devnull >= 0)
+    close(devnull);
+  free(buf);
+  return ret;
+}
+
+// tee builtin: stdin'i hem stdout'a hem dosyalara yazar
+// tee [-a] [file...]   (-a: dosyaların sonuna ekle)
+int run_tee_builtin(struct command_t *command)
+{
+  fflush(stdout);
+  int first = 1;
+  int flags = O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC;
+  if (command->args[1] != NULL && strcmp(command->args[1], "-a") == 0)
+  {
+    flags = O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC;
+    first = 2;
+  }
+
+  int nfiles = 0;
+  while (command->args[first + nfiles] != NULL)
+    nfiles++;
+  struct tee_out *outs = calloc(nfiles + 1, sizeof(struct tee_out));
+  if (outs == NULL)
+    return UNKNOWN;
+
+  int ret = SUCCESS;
+  int nouts = 0;
+  outs[nouts].name = "-";
+  outs[nouts++].fd = STDOUT_FILENO;
+  for (int i = 0; i < nfiles; i++)
+  {
+    const char *name = command->args[first + i];
+    int fd = open(name, flags, 0644);
+    if (fd < 0)
+    {
+      printf("-%s: tee: %s: %s\n", sysname, name, strerror(errno));
+      ret = UNKNOWN;
+      continue;
+    }
+    outs[nouts].name = name;
+    outs[nouts++].fd = fd;
+  }
+
+  if (tee_stream(outs, nouts) != SUCCESS)
+    ret = UNKNOWN;
+
+  for (int i = 1; i < nouts; i++)
+    close(outs[i].fd);
+  free(outs);
+  fflush(stdout);
+  return ret;
+}
+
+// hash builtin: komut hash tablosunu listeler, doldurur veya temizler
+// hash           -> tablodaki kayıtları listele
+// hash -r        -> tabloyu boşalt
+// hash cmd...    -> komutları çözüp tabloya ekle
+int run_hash_builtin(struct command_t *command)
+{
+  // Argüman yoksa listele (bash formatına benzer)
+  if (command->args[1] == NULL)
+  {
+    bool any = false; // en az bir kayıt var mı
+    for (int i = 0; i < CMD_HASH_SIZE; i++)
+    {
+      for (struct cmd_hash_entry *e = cmd_hash[i]; e != NULL; e = e->next)
+      {
+        if (!any)
+          printf("hits\tcommand\n"); // başlık
+        any = true;
+        printf("%4d\t%s\n", e->hits, e->path);
+      }
+    }
+    if (!any)
+      printf("-%s: hash: hash table empty\n", sysname);
+    return SUCCESS;
+  }
+
+  int ret = SUCCESS;
+  for (int i = 1; command->args[i] != NULL; i++)
+  {
+    // -r: tüm tabloyu temizle
+    if (strcmp(command->args[i], "-r") == 0)
+    {
+      cmd_hash_clear();
+      continue;
+    }
+
+    // Komutu çöz: bulunursa resolve_executable_path tabloya ekler
+    char *path = resolve_executable_path(command->args[i]);
+    if (path == NULL)
+    {
+      printf("-%s: hash: %s: not found\n", sysname, command->args[i]);
+      ret = UNKNOWN;
+      continue;
+    }
+    free(path);
+  }
+  return ret;
+}
+
+// repeat --bench seçenekleri
+struct bench_options
+{
+  int warmup;              // ölçülmeyen ısınma koşuları
+  bool discard;            // komutun stdout'u /dev/null'a gitsin
+  const char *csv_path;    // --export-csv dosyası (NULL: yok)
+  const char *json_path;   // --export-json dosyası (NULL: yok)
+};
+
+// Tek bir benchmark koşusunun ölçümleri
+struct bench_sample
+{
+  double wall_ms;  // duvar saati süresi
+  double user_ms;  // child'ın user CPU süresi (wait4 rusage)
+  double sys_ms;   // child'ın sys CPU süresi
+  long max_rss_kb; // child'ın en yüksek RSS'i
+  int status;      // çıkış kodu
+};
+
+static int cmp_double(const void *a, const void *b)
+{
+  double x = *(const double *)a, y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Sıralı dizide p. yüzdelik (doğrusal interpolasyon)
+static double percentile(const double *sorted, int n, double p)
+{
+  if (n == 1)
+    return sorted[0];
+  double rank = p / 100.0 * (n - 1);
+  int lo = (int)rank;
+  if (lo >= n - 1)
+    return sorted[n - 1];
+  double frac = rank - lo;
+  return sorted[lo] + (sorted[lo + 1] - sorted[lo]) * frac;
+}
+
+static double timeval_ms(struct timeval tv)
+{
+  return tv.tv_sec * 1000.0 + tv.tv_usec / 1000.0;
+}
+
+// Komutu bir kez çalıştırır ve ölçer. Başlatılamazsa errno değeri döner.
+static int bench_run_once(const char *path, char **argv, char *const redirects[3],
+                          struct bench_sample *out)
+{
+  struct timespec t0, t1;
+  clock_gettime(CLOCK_MONOTONIC, &t0);
+
+  pid_t pid;
+  int err = spawn_command(path, argv, -1, -1, -1, redirects, -1, false, &pid);
+  if (err != 0)
+    return err;
+
+  int status = 0;
+  struct rusage ru;
+  wait4(pid, &status, 0, &ru); // bitişi bekle + kaynak kullanımını al
+  clock_gettime(CLOCK_MONOTONIC, &t1);
+
+  if (out != NULL)
+  {
+    out->wall_ms = (t1.tv_sec - t0.tv_sec) * 1000.0 + (t1.tv_nsec - t0.tv_nsec) / 1e6;
+    out->user_ms = timeval_ms(ru.ru_utime);
+    out->sys_ms = timeval_ms(ru.ru_stime);
+    out->max_rss_kb = ru.ru_maxrss; // Linux'ta KB
+    out->status = status_from_wait(status);
+  }
+  return 0;
+}
+
+// repeat --bench: komutu N kez ölçerek çalıştırır ve istatistik basar
+int run_repeat_bench(const char *path, char **argv, int n, struct bench_options *opt)
+{
+  char *null_redirects[3] = {NULL, "/dev/null", NULL}; // --discard
+  char *const *redirects = opt->discard ? null_redirects : NULL;
+
+  // Isınma: page cache, hash tablosu vb. dolsun, sonuçlara katılmaz
+  for (int i = 0; i < opt->warmup; i++)
+  {
+    int err = bench_run_once(path, argv, redirects, NULL);
+    if (err != 0)
+    {
+      printf("-%s: %s: %s\n", sysname, argv[0], strerror(err));
+      return UNKNOWN;
+    }
+  }
+
+  struct bench_sample *samples = calloc(n, sizeof(struct bench_sample));
+  double *walls = malloc(sizeof(double) * n); // yüzdelikler için sıralanacak
+  if (samples == NULL || walls == NULL)
+  {
+    free(samples);
+    free(walls);
+    return UNKNOWN;
+  }
+
+  for (int i = 0; i < n; i++)
+  {
+    int err = bench_run_once(path, argv, redirects, &samples[i]);
+    if (err != 0)
+    {
+      printf("-%s: %s: %s\n", sysname, argv[0], strerror(err));
+      free(samples);
+      free(walls);
+      return UNKNOWN;
+    }
+    walls[i] = samples[i].wall_ms;
+  }
+
+  // İstatistikler
+  double sum = 0, user = 0, sys = 0;
+  long max_rss = 0;
+  int failed = 0; // sıfırdan farklı çıkış kodu sayısı
+  for (int i = 0; i < n; i++)
+  {
+    sum += samples[i].wall_ms;
+    user += samples[i].user_ms;
+    sys += samples[i].sys_ms;
+    if (samples[i].max_rss_kb > max_rss)
+      max_rss = samples[i].max_rss_kb;
+    if (samples[i].status != 0)
+      failed++;
+  }
+  double mean = sum / n;
+  double var = 0;
+  for (int i = 0; i < n; i++)
+    var += (samples[i].wall_ms - mean) * (samples[i].wall_ms - mean);
+  double stddev = n > 1 ? sqrt(var / (n - 1)) : 0; // örneklem standart sapması
+
+  qsort(walls, n, sizeof(double), cmp_double);
+  double p50 = percentile(walls, n, 50);
+  double p95 = percentile(walls, n, 95);
+  double p99 = percentile(walls, n, 99);
+
+  printf("Benchmark: %s", argv[0]);
+  for (int i = 1; argv[i] != NULL; i++)
+    printf(" %s", argv[i]);
+  printf("  (%d runs, %d warmup)\n", n, opt->warmup);
+  printf("  Time (mean ± σ):  %9.3f ms ± %.3f ms\n", mean, stddev);
+  printf("  Range (min … max): %8.3f ms … %.3f ms\n", walls[0], walls[n - 1]);
+  printf("  p50 / p95 / p99:   %8.3f ms / %.3f ms / %.3f ms\n", p50, p95, p99);
+  printf("  User / Sys (mean): %8.3f ms / %.3f ms\n", user / n, sys / n);
+  printf("  Max RSS:           %8ld KB\n", max_rss);
+  if (failed > 0)
+    printf("  Warning: %d run(s) exited with non-zero status\n", failed);
+
+  int ret = SUCCESS;
+
+  // CSV: her koşu bir satır
+  if (opt->csv_path != NULL)
+  {
+    FILE *f = fopen(opt->csv_path, "w");
+    if (f == NULL)
+    {
+      printf("-%s: repeat: %s: %s\n", sysname, opt->csv_path, strerror(errno));
+      ret = UNKNOWN;
+    }
+    else
+    {
+      fprintf(f, "run,wall_ms,user_ms,sys_ms,max_rss_kb,exit_status\n");
+      for (int i = 0; i < n; i++)
+        fprintf(f, "%d,%.6f,%.6f,%.6f,%ld,%d\n", i + 1, samples[i].wall_ms,
+                samples[i].user_ms, samples[i].sys_ms, samples[i].max_rss_kb,
+                samples[i].status);
+      fclose(f);
+    }
+  }
+
+  // JSON: özet + tüm koşuların süreleri
+  if (opt->json_path != NULL)
+  {
+    FILE *f = fopen(opt->json_path, "w");
+    if (f == NULL)
+    {
+      printf("-%s: repeat: %s: %s\n", sysname, opt->json_path, strerror(errno));
+      ret = UNKNOWN;
+    }
+    else
+    {
+      fprintf(f, "{\n  \"command\": \"");
+      for (int i = 0; argv[i] != NULL; i++)
+      { // basit JSON kaçışı
+        if (i > 0)
+          fputc(' ', f);
+        for (const char *c = argv[i]; *c; c++)
+        {
+          if (*c == '"' || *c == '\\')
+            fputc('\\', f);
+          fputc(*c, f);
+        }
+      }
+      fprintf(f, "\",\n  \"runs\": %d,\n  \"warmup\": %d,\n", n, opt->warmup);
+      fprintf(f, "  \"mean_ms\": %.6f,\n  \"stddev_ms\": %.6f,\n", mean, stddev);
+      fprintf(f, "  \"min_ms\": %.6f,\n  \"max_ms\": %.6f,\n", walls[0], walls[n - 1]);
+      fprintf(f, "  \"p50_ms\": %.6f,\n  \"p95_ms\": %.6f,\n  \"p99_ms\": %.6f,\n", p50, p95, p99);
+      fprintf(f, "  \"user_mean_ms\": %.6f,\n  \"sys_mean_ms\": %.6f,\n", user / n, sys / n);
+      fprintf(f, "  \"max_rss_kb\": %ld,\n  \"failed_runs\": %d,\n", max_rss, failed);
+      fprintf(f, "  \"times_ms\": [");
+      for (int i = 0; i < n; i++)
+        fprintf(f, "%s%.6f", i > 0 ? ", " : "", samples[i].wall_ms);
+      fprintf(f, "]\n}\n");
+      fclose(f);
+    }
+  }
+
+  free(samples);
+  free(walls);
+  return ret;
+}
+
+// repeat builtin: komutu N kez çalıştırır
+// repeat [--bench] [--warmup W] [--discard] [--export-csv F] [--export-json F] N cmd args...
+int run_repeat_builtin(struct command_t *command)
+{
+  bool bench = false;                        // ölçüm modu
+  struct bench_options opt = {0, false, NULL, NULL};
+
+  // Seçenekleri N'den önce tara (herhangi bir bench seçeneği --bench demektir)
+  int a = 1; // args'ta sıradaki index
+  while (command->args[a] != NULL && strncmp(command->args[a], "--", 2) == 0)
+  {
+    const char *o = command->args[a];
+    const char *v = command->args[a + 1]; // seçeneğin değeri (varsa)
+    if (strcmp(o, "--bench") == 0)
+      bench = true;
+    else if (strcmp(o, "--discard") == 0)
+      opt.discard = bench = true;
+    else if (strcmp(o, "--warmup") == 0 && v != NULL)
+    {
+      opt.warmup = atoi(v);
+      bench = true;
+      a++;
+    }
+    else if (strcmp(o, "--export-csv") == 0 && v != NULL)
+    {
+      opt.csv_path = v;
+      bench = true;
+      a++;
+    }
+    else if (strcmp(o, "--export-json") == 0 && v != NULL)
+    {
+      opt.json_path = v;
+      bench = true;
+      a++;
+    }
+    else
+    {
+      printf("-%s: repeat: unknown option %s\n", sysname, o);
+      return UNKNOWN;
+    }
+    a++;
+  }
+
+  // Kullanım: repeat N cmd args...
+  if (command->args[a] == NULL || command->args[a + 1] == NULL)
+  {
+    printf("-%s: repeat: usage: repeat [--bench] [--warmup W] [--discard] "
+           "[--export-csv F] [--export-json F] N <command> [args...]\n",
+           sysname); // kullanım mesajı
+    return UNKNOWN;  // hata
+  }
+
+  int n = atoi(command->args[a]); // N sayısını al
+  if (n <= 0)
+  {
+    printf("-%s: repeat: N must be > 0\n", sysname); // N kontrolü
+    return UNKNOWN;
+  }
+
+  // Çalıştırılacak komut adı: N'den sonraki argüman
+  const char *cmd = command->args[a + 1];
+
+  // repeat için yeni argv oluştur: [cmd, a1, a2, ..., NULL]
+  // command->args şu an: [repeat, seçenekler..., N, cmd, a1, a2, ..., NULL]
+  char **new_argv = &command->args[a + 1]; // cmd'den itibaren başlat
+
+  // Komutun path'ini çöz
+  char *resolved_path = resolve_executable_path(cmd); // PATH içinde bul
+  if (resolved_path == NULL)
+  {
+    printf("-%s: %s: command not found\n", sysname, cmd); // bulunamadı
+    return UNKNOWN;
+  }
+
+  // Benchmark modu: ölç ve istatistik bas
+  if (bench)
+  {
+    int r = run_repeat_bench(resolved_path, new_argv, n, &opt);
+    free(resolved_path);
+    return r;
+  }
+
+  // N kez çalıştır
+  for (int i = 0; i < n; i++)
+  {
+    pid_t pid;
+    int err = spawn_command(resolved_path, new_argv, -1, -1, -1, NULL, -1, false, &pid); // komutu başlat
+    if (err != 0)
+    {
+      printf("-%s: %s: %s\n", sysname, cmd, strerror(err)); // spawn/exec hata
+      free(resolved_path);
+      return UNKNOWN;
+    }
+    int status = 0;
+    waitpid(pid, &status, 0); // her turda bitmesini bekle
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT)
+      break; // Ctrl-C: kalan turları çalıştırma
+  }
+
+  free(resolved_path); // path'i temizle
+  return SUCCESS;      // başarılı
+}
+
+/*
+ * parallel builtin: stdin'deki her satır için komutu çalıştırır, aynı anda en
+ * fazla N komut (xargs -P gibi). Argümanlardaki "{}" satırla değiştirilir;
+ * hiçbirinde yoksa satır son argüman olarak eklenir. Komutun yolu bir kez
+ * çözülür (isim "{}" içermiyorsa).
+ *
+ * Her job'ın stdout/stderr'i kendi pipe'ından belleğe toplanır ve job bitince
+ * tek seferde yazılır: çıktılar hiç karışmaz. -k ile girdi sırasında, yoksa
+ * bitiş sırasında yazılır. Bitenler tek tek waitpid ile beklenmez: tek bir
+ * poll döngüsü çıktı pipe'larını ve pidfd'leri birlikte izler.
+ */
+#define PAR_KEEP_WINDOW 4 // -k: en yavaş job'ın önüne geçebilecek job sayısı = 4*N
+
+enum par_states
+{
+  PAR_FREE = 0, // slot boş
+  PAR_RUNNING,  // process çalışıyor veya çıktısı hâlâ okunuyor
+  PAR_DONE,     // bitti, çıktısı yazılmayı bekliyor (-k)
+};
+
+struct par_job
+{
+  int state;     // PAR_*
+  long seq;      // girdi sırası
+  pid_t pid;     // -1: toplandı
+  int pidfd;     // process bitince okunabilir olur (-1: desteklenmiyor)
+  int fds[2];    // stdout/stderr pipe'larının okuma uçları (-1: EOF)
+  char *buf[2];  // toplanan stdout/stderr
+  size_t len[2];
+  size_t cap[2];
+  int status;    // waitpid status'u
+  bool exited;   // pidfd okunabilir oldu: waitpid bloklamaz
+};
+
+// Job'ın biriken çıktısını yazar ve slotu boşaltır
+static void par_flush(struct par_job *j)
+{
+  if (j->len[0] > 0)
+    zc_write_all(STDOUT_FILENO, j->buf[0], j->len[0]);
+  if (j->len[1] > 0)
+    zc_write_all(STDERR_FILENO, j->buf[1], j->len[1]);
+  j->len[0] = j->len[1] = 0; // buffer'lar sonraki job'a kalır
+  j->state = PAR_FREE;
+}
+
+// Pipe'ta ne varsa job'ın buffer'ına ekler; EOF'ta ucu kapatır
+static void par_drain(struct par_job *j, int k)
+{
+  while (1)
+  {
+    if (j->cap[k] - j->len[k] < 4096)
+    {
+      size_t cap = j->cap[k] ? j->cap[k] * 2 : 65536;
+      char *nb = realloc(j->buf[k], cap);
+      if (nb == NULL)
+        break; // bellek yok: pipe'ta kalsın, sonra tekrar denenir
+      j->buf[k] = nb;
+      j->cap[k] = cap;
+    }
+    ssize_t n = read(j->fds[k], j->buf[k] + j->len[k], j->cap[k] - j->len[k]);
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && errno == EAGAIN)
+      return; // şimdilik bu kadar
+    if (n <= 0)
+    {
+      close(j->fds[k]);
+      j->fds[k] = -1;
+      return;
+    }
+    j->len[k] += n;
+  }
+}
+
+// "{}" geçen argümanları item ile değiştirir. Kopyalanan argümanlar
+// free edilmek üzere owned'a yazılır. Hiç "{}" yoksa item sona eklenir.
+static void par_build_argv(char **tmpl, int n, const char *item, char **argv, char **owned)
+{
+  size_t ilen = strlen(item);
+  bool used = false;
+  for (int i = 0; i < n; i++)
+  {
+    owned[i] = NULL;
+    argv[i] = tmpl[i];
+    if (strstr(tmpl[i], "{}") == NULL)
+      continue;
+    size_t count = 0;
+    for (const char *p = tmpl[i]; (p = strstr(p, "{}")) != NULL; p += 2)
+      count++;
+    char *s = malloc(strlen(tmpl[i]) + count * ilen + 1);
+    if (s == NULL)
+      continue; // bellek yok: şablon aynen kalır
+    char *w = s;
+    for (const char *p = tmpl[i];;)
+    {
+      const char *q = strstr(p, "{}");
+      size_t l = q ? (size_t)(q - p) : strlen(p);
+      memcpy(w, p, l);
+      w += l;
+      if (q == NULL)
+        break;
+      memcpy(w, item, ilen);
+      w += ilen;
+      p = q + 2;
+    }
+    *w = '\0';
+    argv[i] = owned[i] = s;
+    used = true;
+  }
+  owned[n] = NULL;
+  argv[n] = used ? NULL : (char *)item;
+  argv[n + 1] = NULL;
+}
+
+// parallel builtin
+// parallel [-j N] [-k] cmd [args...]   ("{}": satır)
+int run_parallel_builtin(struct command_t *command)
+{
+  long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+  int njobs = ncpu > 0 ? (int)ncpu : 1; // varsayılan: CPU sayısı
+  bool keep = false;                   // -k: girdi sırasında yaz
+  int a = 1;
+  while (command->args[a] != NULL && command->args[a][0] == '-')
+  {
+    const char *o = command->args[a];
+    if (strcmp(o, "-k") == 0 || strcmp(o, "--keep-order") == 0)
+      keep = true;
+    else if ((strcmp(o, "-j") == 0 || strcmp(o, "--jobs") == 0) && command->args[a + 1] != NULL)
+      njobs = atoi(command->args[++a]);
+    else if (strncmp(o, "-j", 2) == 0 && o[2] >= '0' && o[2] <= '9') // -j8
+      njobs = atoi(o + 2);
+    else
+    {
+      printf("-%s: parallel: unknown option %s\n", sysname, o);
+      return UNKNOWN;
+    }
+    a++;
+  }
+  if (command->args[a] == NULL)
+  {
+    printf("-%s: parallel: usage: parallel [-j N] [-k] <command> [args...]\n", sysname);
+    return UNKNOWN;
+  }
+  if (njobs < 1)
+  {
+    printf("-%s: parallel: N must be > 0\n", sysname);
+    return UNKNOWN;
+  }
+
+  char **tmpl = &command->args[a]; // [cmd, args..., NULL]
+  int ntmpl = 0;
+  while (tmpl[ntmpl] != NULL)
+    ntmpl++;
+
+  // Komut adı sabitse yolu bir kez çöz (her job'da PATH taranmasın)
+  char *path = NULL;
+  if (strstr(tmpl[0], "{}") == NULL)
+  {
+    path = resolve_executable_path(tmpl[0]);
+    if (path == NULL)
+    {
+      printf("-%s: %s: command not found\n", sysname, tmpl[0]);
+      return UNKNOWN;
+    }
+  }
+
+  int nslots = keep ? njobs * PAR_KEEP_WINDOW : njobs;
+  struct par_job *jobs = calloc(nslots, sizeof(*jobs));
+  struct pollfd *pfds = calloc((size_t)njobs * 3, sizeof(*pfds));
+  struct par_job **pjob = calloc((size_t)njobs * 3, sizeof(*pjob));
+  char **argv = calloc(ntmpl + 2, sizeof(char *));
+  char **owned = calloc(ntmpl + 1, sizeof(char *));
+  struct line_reader lr;
+  int devnull = open("/dev/null", O_RDONLY | O_CLOEXEC); // job'ların stdin'i
+  if (jobs == NULL || pfds == NULL || pjob == NULL || argv == NULL || owned == NULL ||
+      devnull < 0 || line_reader_open(&lr, STDIN_FILENO) != 0)
+  {
+    printf("-%s: parallel: %s\n", sysname, strerror(errno ? errno : ENOMEM));
+    free(jobs);
+    free(pfds);
+    free(pjob);
+    free(argv);
+    free(owned);
+    free(path);
+    if (devnull >= 0)
+      close(devnull);
+    return UNKNOWN;
+  }
+
+  fflush(stdout); // kendi printf'lerimiz job çıktılarından önce
+  int saved_err = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
+  long next_seq = 0, next_flush = 0; // başlatılacak / yazılacak sıradaki job
+  int running = 0, failed = 0;
+  bool eof = false;
+  while (1)
+  {
+    // Boş slot oldukça yeni satır oku ve başlat
+    while (!eof && running < njobs)
+    {
+      struct par_job *j = NULL;
+      if (keep)
+        j = jobs[next_seq % nslots].state == PAR_FREE ? &jobs[next_seq % nslots] : NULL;
+      else
+        for (int i = 0; i < nslots && j == NULL; i++)
+          if (jobs[i].state == PAR_FREE)
+            j = &jobs[i];
+      if (j == NULL)
+        break; // -k: en eski job'ın çıktısı yazılmadan pencere dolu
+
+      const char *line;
+      ssize_t len = line_reader_next(&lr, &line);
+      if (len < 0)
+      {
+        eof = true;
+        break;
+      }
+      char *item = strndup(line, len);
+      if (item == NULL)
+        continue;
+      par_build_argv(tmpl, ntmpl, item, argv, owned);
+      char *job_path = path != NULL ? path : resolve_executable_path(argv[0]);
+
+      int out[2], err[2];
+      int rc = ENOENT;
+      if (job_path != NULL && pipe2(out, O_CLOEXEC) == 0)
+      {
+        if (pipe2(err, O_CLOEXEC) == 0)
+        {
+          // stderr için spawn_command'da parametre yok: fd 2'yi spawn
+          // süresince job'ın pipe'ına bağla (child miras alır)
+          dup2(err[1], STDERR_FILENO);
+          rc = spawn_command(job_path, argv, devnull, out[1], -1, NULL, -1, false, &j->pid);
+          dup2(saved_err, STDERR_FILENO);
+          close(err[1]);
+          if (rc == 0)
+          {
+            j->fds[1] = err[0];
+            fcntl(err[0], F_SETFL, O_NONBLOCK);
+          }
+          else
+            close(err[0]);
+        }
+        else
+          rc = errno;
+        close(out[1]);
+        if (rc == 0)
+        {
+          j->fds[0] = out[0];
+          fcntl(out[0], F_SETFL, O_NONBLOCK);
+        }
+        else
+          close(out[0]);
+      }
+      if (rc != 0)
+      {
+        if (job_path == NULL)
+          printf("-%s: %s: command not found\n", sysname, argv[0]);
+        else
+          printf("-%s: %s: %s\n", sysname, argv[0], strerror(rc));
+        fflush(stdout);
+        failed++;
+      }
+      else
+      {
+        j->state = PAR_RUNNING;
+        j->seq = next_seq++;
+        j->exited = false;
+#ifdef SYS_pidfd_open
+        j->pidfd = (int)syscall(SYS_pidfd_open, j->pid, 0);
+#else
+        j->pidfd = -1;
+#endif
+        running++;
+      }
+      if (job_path != path)
+        free(job_path);
+      for (int i = 0; i < ntmpl; i++)
+        free(owned[i]);
+      free(item);
+    }
+    if (running == 0)
+      break; // hepsi bitti ve yazıldı
+
+    // Çıktı pipe'larını ve pidfd'leri birlikte bekle
+    int np = 0;
+    bool sweep = false; // pidfd'siz job varsa arada WNOHANG ile yokla
+    for (int i = 0; i < nslots; i++)
+    {
+      struct par_job *j = &jobs[i];
+      if (j->state != PAR_RUNNING)
+        continue;
+      for (int k = 0; k < 2; k++)
+        if (j->fds[k] >= 0)
+        {
+          pfds[np] = (struct pollfd){j->fds[k], POLLIN, 0};
+          pjob[np++] = j;
+        }
+      if (j->pid > 0 && j->pidfd >= 0)
+      {
+        pfds[np] = (struct pollfd){j->pidfd, POLLIN, 0};
+        pjob[np++] = j;
+      }
+      else if (j->pid > 0)
+        sweep = true;
+    }
+    if (poll(pfds, np, sweep ? 20 : -1) < 0 && errno != EINTR)
+      break;
+
+    for (int p = 0; p < np; p++)
+    {
+      struct par_job *j = pjob[p];
+      if (pfds[p].revents == 0)
+        continue;
+      if (pfds[p].fd == j->fds[0] || pfds[p].fd == j->fds[1])
+        par_drain(j, pfds[p].fd == j->fds[0] ? 0 : 1);
+      else
+        j->exited = true; // pidfd
+    }
+    for (int i = 0; i < nslots; i++)
+    {
+      struct par_job *j = &jobs[i];
+      if (j->state != PAR_RUNNING)
+        continue;
+      if (j->pid > 0 && (j->exited || j->pidfd < 0) &&
+          waitpid(j->pid, &j->status, WNOHANG) == j->pid)
+      {
+        j->pid = -1; // toplandı
+        if (j->pidfd >= 0)
+          close(j->pidfd);
+        j->pidfd = -1;
+        if (!WIFEXITED(j->status) || WEXITSTATUS(j->status) != 0)
+          failed++;
+        if (WIFSIGNALED(j->status) && WTERMSIG(j->status) == SIGINT)
+          eof = true; // Ctrl-C: yeni job başlatma, çalışanları bekle
+      }
+      if (j->pid < 0 && j->fds[0] < 0 && j->fds[1] < 0)
+      {
+        j->state = PAR_DONE;
+        running--;
+        if (!keep)
+          par_flush(j); // bitiş sırası
+      }
+    }
+    while (keep && jobs[next_flush % nslots].state == PAR_DONE &&
+           jobs[next_flush % nslots].seq == next_flush)
+      par_flush(&jobs[next_flush++ % nslots]); // girdi sırası
+  }
+
+  line_reader_close(&lr);
+  if (saved_err >= 0)
+    close(saved_err);
+  close(devnull);
+  for (int i = 0; i < nslots; i++)
+  {
+    free(jobs[i].buf[0]);
+    free(jobs[i].buf[1]);
+  }
+  free(jobs);
+  free(pfds);
+  free(pjob);
+  free(argv);
+  free(owned);
+  free(path);
+  return failed == 0 ? SUCCESS : UNKNOWN;
+}
+
+/*
+ * ===== Chatroom FIFO framing =====
+ * FIFO'ya giden her şey çerçevelidir: [chat_frame başlığı][payload].
+ * Bir çerçeve en fazla PIPE_BUF byte olduğu için tek write'la atomik gider,
+ * birden fazla gönderen aynı FIFO'ya yazsa da çerçeveler karışmaz. Uzun
+ * mesajlar CHAT_FRAME_MORE bayraklı parçalara bölünür; okuyucu parçaları
+ * gönderen pid'ine göre birleştirir (chat_decoder). Mesaj boyu sınırsızdır.
+ * Her çerçeve payload'ının mesaj içindeki byte offset'ini taşır: aradan bir
+ * çerçeve kaybolursa (dolu FIFO'da vazgeçilen grup) okuyucu boşluğu görür
+ * ve mesajı bozuk birleştirmek yerine atar.
+ */
+#define CHAT_FRAME_MAGIC 0x43464d32u // "CFM2"
+#define CHAT_FRAME_MORE 0x1          // mesajın devamı sonraki çerçevede
+#define CHAT_FRAME_PAYLOAD (PIPE_BUF - sizeof(struct chat_frame))
+#define CHAT_READ_BLOCK 65536        // okuyucunun tek read() boyutu
+#define CHAT_MAX_PARTIAL 64          // aynı anda yarım kalabilecek mesaj
+#define CHAT_MSG_LIMIT (16 << 20)    // okuyucunun birleştireceği en büyük mesaj
+
+struct chat_frame
+{
+  uint32_t magic;  // CHAT_FRAME_MAGIC
+  uint32_t pid;    // gönderen process
+  uint32_t msg_id; // gönderen içinde mesaj numarası
+  uint32_t offset; // payload'ın mesaj içindeki byte offset'i
+  uint16_t len;    // bu çerçevedeki payload uzunluğu
+  uint16_t flags;  // CHAT_FRAME_MORE
+};
+
+// Okuyucu tarafında birleştirilmekte olan mesaj
+struct chat_partial
+{
+  uint32_t pid;
+  uint32_t msg_id;
+  char *buf;
+  size_t len;
+  size_t cap;
+};
+
+struct chat_decoder
+{
+  char *buf;  // FIFO'dan okunan ama henüz çözülmemiş byte'lar
+  size_t len; // buf'taki byte sayısı
+  struct chat_partial parts[CHAT_MAX_PARTIAL];
+  int nparts;
+};
+
+int chat_decoder_init(struct chat_decoder *dec)
+{
+  memset(dec, 0, sizeof(*dec));
+  dec->buf = malloc(CHAT_READ_BLOCK + PIPE_BUF); // blok + yarım çerçeve
+  return dec->buf == NULL ? -1 : 0;
+}
+
+void chat_decoder_free(struct chat_decoder *dec)
+{
+  for (int i = 0; i < dec->nparts; i++)
+    free(dec->parts[i].buf);
+  free(dec->buf);
+  memset(dec, 0, sizeof(*dec));
+}
+
+static void chat_partial_drop(struct chat_decoder *dec, int i)
+{
+  free(dec->parts[i].buf);
+  dec->parts[i] = dec->parts[--dec->nparts];
+}
+
+// Bir çerçeveyi işler; mesaj tamamlandıysa emit'i çağırır
+static void chat_decode_frame(struct chat_decoder *dec, const struct chat_frame *f,
+                              const char *payload,
+                              void (*emit)(void *ctx, const char *msg, size_t len), void *ctx)
+{
+  int i;
+  for (i = 0; i < dec->nparts; i++)
+    if (dec->parts[i].pid == f->pid)
+      break;
+  if (i < dec->nparts &&
+      (dec->parts[i].msg_id != f->msg_id || dec->parts[i].len != f->offset))
+  {
+    chat_partial_drop(dec, i); // mesajın bir parçası kayboldu, at
+    i = dec->nparts;
+  }
+  if (i == dec->nparts && f->offset != 0)
+    return; // başı kaybolmuş mesajın devamı
+
+  if (i == dec->nparts && !(f->flags & CHAT_FRAME_MORE))
+  {
+    emit(ctx, payload, f->len); // tek çerçevelik mesaj: kopyasız
+    return;
+  }
+  if (i == dec->nparts)
+  {
+    if (dec->nparts == CHAT_MAX_PARTIAL)
+      chat_partial_drop(dec, 0); // yer yok: en eskisini feda et
+    i = dec->nparts++;
+    dec->parts[i] = (struct chat_partial){f->pid, f->msg_id, NULL, 0, 0};
+  }
+
+  struct chat_partial *p = &dec->parts[i];
+  if (p->len + f->len > CHAT_MSG_LIMIT)
+  {
+    chat_partial_drop(dec, i);
+    return;
+  }
+  if (p->len + f->len > p->cap)
+  {
+    size_t ncap = p->cap ? p->cap * 2 : 4 * PIPE_BUF;
+    while (ncap < p->len + f->len)
+      ncap *= 2;
+    char *nbuf = realloc(p->buf, ncap);
+    if (nbuf == NULL)
+    {
+      chat_partial_drop(dec, i);
+      return;
+    }
+    p->buf = nbuf;
+    p->cap = ncap;
+  }
+  memcpy(p->buf + p->len, payload, f->len);
+  p->len += f->len;
+  if (!(f->flags & CHAT_FRAME_MORE))
+  {
+    emit(ctx, p->buf, p->len);
+    chat_partial_drop(dec, i);
+  }
+}
+
+// fd'den tek büyük read() yapar ve içindeki tüm tam çerçeveleri çözer.
+// Okunan byte sayısını döner (0: EOF, -1: hata).
+ssize_t chat_decoder_read(struct chat_decoder *dec, int fd,
+                          void (*emit)(void *ctx, const char *msg, size_t len), void *ctx)
+{
+  ssize_t n = read(fd, dec->buf + dec->len, CHAT_READ_BLOCK);
+  if (n <= 0)
+    return n;
+  dec->len += n;
+
+  size_t pos = 0;
+  while (dec->len - pos >= sizeof(struct chat_frame))
+  {
+    struct chat_frame f;
+    memcpy(&f, dec->buf + pos, sizeof(f)); // hizasız olabilir
+    if (f.magic != CHAT_FRAME_MAGIC || f.len > CHAT_FRAME_PAYLOAD)
+    {
+      pos = dec->len; // senkron kayboldu (çerçevesiz yazan biri): tamponu at
+      break;
+    }
+    if (dec->len - pos < sizeof(f) + f.len)
+      break; // yarım çerçeve: sonraki read'i bekle
+    chat_decode_frame(dec, &f, dec->buf + pos + sizeof(f), emit, ctx);
+    pos += sizeof(f) + f.len;
+  }
+  memmove(dec->buf, dec->buf + pos, dec->len - pos);
+  dec->len -= pos;
+  return n;
+}
+
+/*
+ * ===== Chatroom fan-out =====
+ * Gönderen process, odadaki her üyenin FIFO'su için açık bir
+ * O_WRONLY|O_NONBLOCK fd'yi cache'ler ve mesajı tek process'ten hepsine yazar
+ * (mesaj başına fork/open/close yok). Üye listesi girişte bir kez readdir ile
+ * yüklenir, sonra oda klasöründeki inotify olaylarıyla güncel tutulur; mesaj
+ * başına klasör taranmaz.
+ *
+ * Mesajlar önce çerçevelenip kuyruğa alınır (chat_queue); chat_flush kuyruğu
+ * her üyeye writev ile yollar. Art arda gelen mesajların çerçeveleri PIPE_BUF'ı
+ * aşmayacak şekilde tek writev'de birleştirilir (atomiklik korunur).
+ *
+ * Her üye FIFO'sunu gizli bir adla (".<user>") oluşturup okuma ucunu açar,
+ * sonra gerçek adına rename eder. Böylece klasörde görünen bir FIFO'nun
+ * her zaman okuyucusu vardır; açarken ENXIO alınırsa sahibi çökmüştür ve
+ * FIFO silinir.
+ */
+#define CHAT_SEND_RETRIES 3     // EAGAIN'de kaç kez tekrar denensin
+#define CHAT_RETRY_WAIT_MS 10   // her denemeden önce POLLOUT bekleme süresi
+#define CHAT_INOTIFY_MASK (IN_CREATE | IN_DELETE | IN_MOVED_TO | IN_MOVED_FROM)
+
+struct chat_member
+{
+  char *name; // FIFO dosya adı (= kullanıcı adı)
+  int fd;     // açık yazma fd'si (-1: henüz açılmadı / kapatıldı)
+};
+
+struct chat_room
+{
+  char dir[512];               // /tmp/chatroom-<room>
+  const char *user;            // kendi kullanıcı adımız (kendimize yazmayız)
+  struct chat_member *members; // bilinen üyeler
+  int nmembers;                // üye sayısı
+  int cap;                     // dizi kapasitesi
+  int ino_fd;                  // oda klasörünü izleyen inotify fd'si
+
+  // Gönderim kuyruğu: çerçeve başlıkları ve sırayla yan yana duran payload'lar
+  struct chat_frame *frames; // kuyruktaki çerçeve başlıkları
+  size_t nframes;            // çerçeve sayısı
+  size_t frames_cap;         // başlık dizisi kapasitesi
+  char *data;                // payload'lar (çerçeve sırasıyla)
+  size_t data_len;           // payload byte sayısı
+  size_t data_cap;           // payload buffer kapasitesi
+  uint32_t next_msg_id;      // sıradaki mesaj numarası
+};
+
+static struct chat_member *chat_find_member(struct chat_room *room, const char *name)
+{
+  for (int i = 0; i < room->nmembers; i++)
+    if (strcmp(room->members[i].name, name) == 0)
+      return &room->members[i];
+  return NULL;
+}
+
+// Üyeyi listeden çıkarır (fd'si kapatılır)
+static void chat_remove_member(struct chat_room *room, int i)
+{
+  if (room->members[i].fd >= 0)
+    close(room->members[i].fd);
+  free(room->members[i].name);
+  room->members[i] = room->members[--room->nmembers]; // sonuncuyu yerine koy
+}
+
+static struct chat_member *chat_add_member(struct chat_room *room, const char *name)
+{
+  if (room->nmembers == room->cap)
+  {
+    int ncap = room->cap ? room->cap * 2 : 16;
+    struct chat_member *m = realloc(room->members, sizeof(struct chat_member) * ncap);
+    if (m == NULL)
+      return NULL;
+    room->members = m;
+    room->cap = ncap;
+  }
+  struct chat_member *m = &room->members[room->nmembers];
+  m->name = strdup(name);
+  if (m->name == NULL)
+    return NULL;
+  m->fd = -1;
+  room->nmembers++;
+  return m;
+}
+
+// Klasördeki bir ad üye FIFO'su mu? (".", "..", gizli geçici adlar ve kendimiz değil)
+static bool chat_is_member_name(const struct chat_room *room, const char *name)
+{
+  return name[0] != '.' && strcmp(name, room->user) != 0;
+}
+
+// inotify fd'sindeki bekleyen olayları okuyup her biri için fn'i çağırır.
+// Okunacak olay kalmadıysa 0, hata/EOF'ta -1 döner.
+int chat_read_events(int fd, void (*fn)(void *ctx, const struct inotify_event *ev), void *ctx)
+{
+  char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+  while (1)
+  {
+    ssize_t n = read(fd, buf, sizeof(buf));
+    if (n < 0 && errno == EINTR)
+      continue;
+    if (n < 0 && errno == EAGAIN)
+      return 0;
+    if (n <= 0)
+      return -1;
+    for (char *p = buf; p < buf + n;)
+    {
+      const struct inotify_event *ev = (const struct inotify_event *)p;
+      if (ev->len > 0)
+        fn(ctx, ev);
+      p += sizeof(struct inotify_event) + ev->len;
+    }
+  }
+}
+
+// Gönderen tarafı: giriş/çıkış olaylarıyla üye listesini günceller
+static void chat_member_event(void *ctx, const struct inotify_event *ev)
+{
+  struct chat_room *room = ctx;
+  if (!chat_is_member_name(room, ev->name))
+    return;
+  struct chat_member *m = chat_find_member(room, ev->name);
+  if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+  {
+    if (m == NULL)
+      chat_add_member(room, ev->name); // yeni üye (fd ilk gönderimde açılır)
+    else if (m->fd >= 0)
+    {
+      close(m->fd); // aynı adla yeniden girdi: eski FIFO'nun fd'si bayat
+      m->fd = -1;
+    }
+  }
+  else if (m != NULL)
+    chat_remove_member(room, (int)(m - room->members)); // çıktı
+}
+
+// İzlemeyi başlatır ve mevcut üyeleri bir kez readdir ile yükler
+int chat_room_load(struct chat_room *room)
+{
+  room->ino_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (room->ino_fd < 0)
+    return -1;
+  // Önce izlemeyi kur, sonra tara: arada giren kimse kaçmasın
+  if (inotify_add_watch(room->ino_fd, room->dir, CHAT_INOTIFY_MASK) < 0)
+  {
+    close(room->ino_fd);
+    room->ino_fd = -1;
+    return -1;
+  }
+
+  DIR *d = opendir(room->dir);
+  if (d == NULL)
+    return -1;
+  struct dirent *ent;
+  while ((ent = readdir(d)) != NULL)
+    if (chat_is_member_name(room, ent->d_name) && chat_find_member(room, ent->d_name) == NULL)
+      chat_add_member(room, ent->d_name);
+  closedir(d);
+  return 0;
+}
+
+// Üyenin FIFO'sunu non-blocking yazma modunda açar
+static int chat_open_member(struct chat_room *room, struct chat_member *m)
+{
+  char path[1024];
+  int n = snprintf(path, sizeof(path), "%s/%s", room->dir, m->name);
+  if (n < 0 || n >= (int)sizeof(path))
+    return -1;
+  m->fd = open(path, O_WRONLY | O_NONBLOCK | O_CLOEXEC);
+  if (m->fd < 0 && errno == ENXIO)
+  {
+    // Okuyucusu olmayan FIFO: sahibi /exit demeden öldü, temizle
+    unlink(path);
+    errno = ENXIO;
+  }
+  return m->fd;
+}
+
+// Tek bir üyeye bir çerçeve grubu yazar (toplam <= PIPE_BUF: atomik).
+// EAGAIN'de FIFO boşalana kadar kısa süre bekleyip tekrar dener; EPIPE'ta
+// (okuyan kapandı) fd'yi atıp bir kez yeniden açar.
+// Üye artık yoksa (bayat FIFO silindi) false döner.
+static bool chat_write_member(struct chat_room *room, struct chat_member *m,
+                              const struct iovec *iov, int iovcnt, size_t len)
+{
+  bool reopened = false;
+  for (int attempt = 0; attempt <= CHAT_SEND_RETRIES; attempt++)
+  {
+    if (m->fd < 0 && chat_open_member(room, m) < 0)
+      return errno != ENXIO && errno != ENOENT;
+
+    ssize_t w = writev(m->fd, iov, iovcnt);
+    if (w == (ssize_t)len)
+      return true;
+    if (w < 0 && errno == EAGAIN)
+    {
+      // FIFO dolu: okuyucunun boşaltmasını kısa süre bekle
+      struct pollfd p = {m->fd, POLLOUT, 0};
+      poll(&p, 1, CHAT_RETRY_WAIT_MS);
+      continue;
+    }
+    if (w < 0 && errno == EPIPE && !reopened)
+    {
+      // Okuyan kapandı: cache'teki fd bayat, at ve (üye yeniden girdiyse) tekrar aç
+      close(m->fd);
+      m->fd = -1;
+      reopened = true;
+      continue;
+    }
+    break; // başka hata: bu grubu bu üyeye bırak (okuyucu offset boşluğunu görüp mesajı atar)
+  }
+  return true;
+}
+
+// Mesajı çerçevelere bölüp gönderim kuyruğuna ekler (henüz yazmaz)
+int chat_queue(struct chat_room *room, const char *msg, size_t len)
+{
+  size_t nf = len == 0 ? 1 : (len + CHAT_FRAME_PAYLOAD - 1) / CHAT_FRAME_PAYLOAD;
+  if (room->nframes + nf > room->frames_cap)
+  {
+    size_t ncap = room->frames_cap ? room->frames_cap * 2 : 64;
+    while (ncap < room->nframes + nf)
+      ncap *= 2;
+    struct chat_frame *f = realloc(room->frames, ncap * sizeof(*f));
+    if (f == NULL)
+      return -1;
+    room->frames = f;
+    room->frames_cap = ncap;
+  }
+  if (room->data_len + len > room->data_cap)
+  {
+    size_t ncap = room->data_cap ? room->data_cap * 2 : CHAT_READ_BLOCK;
+    while (ncap < room->data_len + len)
+      ncap *= 2;
+    char *d = realloc(room->data, ncap);
+    if (d == NULL)
+      return -1;
+    room->data = d;
+    room->data_cap = ncap;
+  }
+  memcpy(room->data + room->data_len, msg, len);
+  room->data_len += len;
+
+  uint32_t id = room->next_msg_id++;
+  for (size_t off = 0, i = 0; i < nf; i++, off += CHAT_FRAME_PAYLOAD)
+  {
+    size_t chunk = len - off < CHAT_FRAME_PAYLOAD ? len - off : CHAT_FRAME_PAYLOAD;
+    room->frames[room->nframes++] = (struct chat_frame){
+        CHAT_FRAME_MAGIC, (uint32_t)getpid(), id, (uint32_t)off, (uint16_t)chunk,
+        i + 1 < nf ? CHAT_FRAME_MORE : 0};
+  }
+  return 0;
+}
+
+// Kuyruktaki tüm çerçeveleri odadaki diğer üyelere yollar.
+// Ardışık çerçeveler PIPE_BUF'ı aşmayacak gruplar halinde tek writev'le gider.
+void chat_flush(struct chat_room *room)
+{
+  if (room->nframes == 0)
+    return;
+  // Son gönderimden beri giren/çıkan var mı (olay yoksa tek read() = EAGAIN)
+  if (room->ino_fd >= 0)
+    chat_read_events(room->ino_fd, chat_member_event, room);
+
+  struct iovec iov[2 * 64]; // bir grupta en fazla 64 çerçeve
+  size_t f = 0;
+  char *payload = room->data;
+  while (f < room->nframes)
+  {
+    int iovcnt = 0;
+    size_t group = 0;
+    while (f < room->nframes && iovcnt < (int)(sizeof(iov) / sizeof(iov[0])))
+    {
+      size_t sz = sizeof(struct chat_frame) + room->frames[f].len;
+      if (group + sz > PIPE_BUF)
+        break;
+      iov[iovcnt++] = (struct iovec){&room->frames[f], sizeof(struct chat_frame)};
+      iov[iovcnt++] = (struct iovec){payload, room->frames[f].len};
+      payload += room->frames[f].len;
+      group += sz;
+      f++;
+    }
+    for (int i = room->nmembers - 1; i >= 0; i--)
+      if (!chat_write_member(room, &room->members[i], iov, iovcnt, group))
+        chat_remove_member(room, i);
+  }
+  room->nframes = 0;
+  room->data_len = 0;
+}
+
+// Mesajı odadaki diğer tüm üyelere hemen gönderir
+void chat_send(struct chat_room *room, const char *msg, size_t len)
+{
+  if (chat_queue(room, msg, len) == 0)
+    chat_flush(room);
+}
+
+// Cache'lenmiş tüm fd'leri kapatır ve üye listesini temizler
+void chat_room_close(struct chat_room *room)
+{
+  while (room->nmembers > 0)
+    chat_remove_member(room, room->nmembers - 1);
+  free(room->members);
+  room->members = NULL;
+  room->cap = 0;
+  if (room->ino_fd >= 0)
+    close(room->ino_fd);
+  room->ino_fd = -1;
+  free(room->frames);
+  free(room->data);
+  room->frames = NULL;
+  room->data = NULL;
+  room->nframes = room->frames_cap = room->data_len = room->data_cap = 0;
+}
+
+/*
+ * ===== Chatroom shared-memory transport (chatroom --shm) =====
+ * Oda tek bir mmap'lenmiş dosyadır: /dev/shm/chatroom-<room>.
+ * İçinde çok yazıcılı (multi-producer) bir mesaj slot ring'i ve okuyucu
+ * tablosu (her okuyucunun kendi cursor'ı) vardır.
+ *
+ * Gönderme: head'i atomik artırıp bir sıra numarası (seq) al, slot'a kopyala,
+ * slot'un seq'ini yayınla, bekleyen varsa futex ile uyandır. Odadaki üye
+ * sayısından bağımsız O(1) (kernel kopyası yok).
+ * Okuma: her okuyucu kendi cursor'ındaki slot'u okur; yeni mesaj yoksa odanın
+ * futex word'ünde uyur. Yavaş okuyucu ring tarafından geçilirse (lapped)
+ * kaçırdığı mesajlar atlanır ve sayılır (yazıcılar okuyucuyu beklemez).
+ * Sahiplenilmiş ama yayınlanmamış slot'ta okuyucu kısa aralıklarla bekler;
+ * yazıcı seq'i alıp yayınlamadan öldüyse slot CHAT_SHM_STALL_MS sonra atlanır
+ * ve kayıp sayılır (okuyucular sonsuza kadar dönmez).
+ */
+#define CHAT_SHM_MAGIC 0x43485348u // "CHSH"
+#define CHAT_SHM_SLOTS 1024        // ring'deki slot sayısı (2'nin kuvveti)
+#define CHAT_SHM_MSG_MAX 1200      // bir mesajın en büyük boyutu (msg[1200] ile aynı)
+#define CHAT_SHM_READERS 64        // odadaki en fazla okuyucu
+#define CHAT_SHM_NAME_MAX 32       // okuyucu tablosundaki kullanıcı adı
+#define CHAT_SHM_STALL_MS 1000     // yayınlanmayan slot bu kadar sonra atlanır
+#define CHAT_SHM_PENDING_NS 1000000L // yayın beklerken futex timeout'u (1 ms)
+
+struct chat_shm_slot
+{
+  _Atomic uint64_t seq; // 0: yazılıyor/boş, s+1: s numaralı mesaj hazır
+  pid_t pid;            // gönderen (kendi mesajlarımızı basmamak için)
+  uint32_t len;         // mesaj uzunluğu
+  char data[CHAT_SHM_MSG_MAX];
+} __attribute__((aligned(64)));
+
+struct chat_shm_reader
+{
+  _Atomic pid_t pid;              // 0: boş giriş
+  _Atomic uint64_t cursor;        // okunacak sıradaki seq
+  _Atomic uint64_t dropped;       // ring tarafından geçilip kaçırılan mesaj sayısı
+  char name[CHAT_SHM_NAME_MAX];   // kullanıcı adı
+  int64_t stall_since;            // cursor'daki slot'un yayınlanmadığı ilk an (0: yok)
+} __attribute__((aligned(64)));
+
+struct chat_shm
+{
+  uint32_t magic;            // CHAT_SHM_MAGIC (başlatıldı mı)
+  uint32_t nslots;           // CHAT_SHM_SLOTS
+  _Atomic uint64_t head;     // sıradaki boş seq (yazıcılar fetch_add yapar)
+  _Atomic uint32_t futex;    // her yayında artar, okuyucular bunda uyur
+  _Atomic uint32_t waiters;  // futex'te uyuyan okuyucu sayısı
+  struct chat_shm_reader readers[CHAT_SHM_READERS];
+  struct chat_shm_slot slots[CHAT_SHM_SLOTS];
+};
+
+static long chat_futex(_Atomic uint32_t *addr, int op, uint32_t val,
+                       const struct timespec *timeout)
+{
+  // Process'ler arası paylaşılan mapping olduğu için FUTEX_PRIVATE_FLAG yok
+  return syscall(SYS_futex, (uint32_t *)addr, op, val, timeout, NULL, 0);
+}
+
+// Okuyucu tablosunda kendimize yer ayırır, cursor'ı şimdiki head'e koyar
+static struct chat_shm_reader *chat_shm_join(struct chat_shm *shm, const char *user, pid_t pid)
+{
+  for (int i = 0; i < CHAT_SHM_READERS; i++)
+  {
+    struct chat_shm_reader *r = &shm->readers[i];
+    pid_t owner = atomic_load(&r->pid);
+    // Sahibi ölmüş girişleri (temiz çıkmamış üyeler) geri al
+    if (owner != 0 && kill(owner, 0) == -1 && errno == ESRCH)
+      atomic_compare_exchange_strong(&r->pid, &owner, 0);
+    owner = 0;
+    if (atomic_compare_exchange_strong(&r->pid, &owner, pid))
+    {
+      snprintf(r->name, sizeof(r->name), "%s", user);
+      atomic_store(&r->dropped, 0);
+      atomic_store(&r->cursor, atomic_load(&shm->head)); // sadece yeni mesajlar
+      return r;
+    }
+  }
+  return NULL; // oda dolu
+}
+
+// Oda dosyasını açar/oluşturur, map'ler ve okuyucu tablosuna katılır.
+// Başlatma ve katılma flock altında yapılır (chat_shm_leave ile yarışmasın).
+struct chat_shm *chat_shm_open(const char *room, const char *user, char *path,
+                               size_t path_size, struct chat_shm_reader **reader)
+{
+  int n = snprintf(path, path_size, "/dev/shm/chatroom-%s", room);
+  if (n < 0 || n >= (int)path_size)
+  {
+    printf("-%s: chatroom: path too long\n", sysname);
+    return NULL;
+  }
+
+  int fd;
+  struct stat st;
+  while (1)
+  {
+    fd = open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+    if (fd < 0)
+    {
+      printf("-%s: chatroom: %s: %s\n", sysname, path, strerror(errno));
+      return NULL;
+    }
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &st) == 0 && st.st_nlink > 0)
+      break;
+    close(fd); // son üye biz kilidi beklerken dosyayı sildi, yeniden aç
+  }
+
+  bool fresh = st.st_size == 0;
+  if (fresh && ftruncate(fd, sizeof(struct chat_shm)) != 0)
+  {
+    printf("-%s: chatroom: ftruncate: %s\n", sysname, strerror(errno));
+    close(fd); // kilit fd ile birlikte bırakılır
+    return NULL;
+  }
+  if (!fresh && st.st_size != (off_t)sizeof(struct chat_shm))
+  {
+    printf("-%s: chatroom: %s: not a chatroom file\n", sysname, path);
+    close(fd);
+    return NULL;
+  }
+
+  struct chat_shm *shm = mmap(NULL, sizeof(struct chat_shm), PROT_READ | PROT_WRITE,
+                              MAP_SHARED, fd, 0);
+  if (shm == MAP_FAILED)
+  {
+    printf("-%s: chatroom: mmap: %s\n", sysname, strerror(errno));
+    close(fd);
+    return NULL;
+  }
+  if (fresh)
+  {
+    // ftruncate sayfaları sıfırladı; sadece başlığı doldur
+    shm->nslots = CHAT_SHM_SLOTS;
+    shm->magic = CHAT_SHM_MAGIC;
+  }
+  if (shm->magic != CHAT_SHM_MAGIC || shm->nslots != CHAT_SHM_SLOTS)
+  {
+    printf("-%s: chatroom: %s: not a chatroom file\n", sysname, path);
+    munmap(shm, sizeof(struct chat_shm));
+    close(fd);
+    return NULL;
+  }
+
+  *reader = chat_shm_join(shm, user, getpid());
+  // mmap open file description'ı tuttuğu için close() kilidi bırakmaz
+  flock(fd, LOCK_UN);
+  close(fd); // mapping fd olmadan da yaşar
+  if (*reader == NULL)
+  {
+    printf("-%s: chatroom: room '%s' is full\n", sysname, room);
+    munmap(shm, sizeof(struct chat_shm));
+    return NULL;
+  }
+  return shm;
+}
+
+// Mesajı ring'e yazar ve bekleyen okuyucuları uyandırır
+void chat_shm_send(struct chat_shm *shm, const char *msg, size_t len)
+{
+  if (len > CHAT_SHM_MSG_MAX)
+    len = CHAT_SHM_MSG_MAX;
+  uint64_t s = atomic_fetch_add(&shm->head, 1); // slot'u sahiplen
+  struct chat_shm_slot *slot = &shm->slots[s & (CHAT_SHM_SLOTS - 1)];
+
+  // Yazarken okuyucular bu slot'u geçersiz görsün (seqlock gibi)
+  atomic_store_explicit(&slot->seq, 0, memory_order_relaxed);
+  atomic_thread_fence(memory_order_release);
+  slot->pid = getpid();
+  slot->len = (uint32_t)len;
+  memcpy(slot->data, msg, len);
+  atomic_store_explicit(&slot->seq, s + 1, memory_order_release); // yayınla
+
+  atomic_fetch_add(&shm->futex, 1);
+  if (atomic_load(&shm->waiters) > 0) // uyuyan yoksa syscall yapma
+    chat_futex(&shm->futex, FUTEX_WAKE, INT32_MAX, NULL);
+}
+
+// Reader tarafı: cursor'daki mesajı buf'a kopyalar.
+// 1: mesaj var, 0: henüz yok, -1: ring bizi geçti (cursor ilerletildi)
+int chat_shm_recv(struct chat_shm *shm, struct chat_shm_reader *r,
+                  char *buf, uint32_t *len, pid_t *from)
+{
+  uint64_t cur = atomic_load_explicit(&r->cursor, memory_order_relaxed);
+  uint64_t head = atomic_load(&shm->head);
+  if (head - cur > CHAT_SHM_SLOTS)
+  {
+    // Yazıcılar bir tur öne geçti: en eski hâlâ geçerli slot'a atla
+    atomic_fetch_add(&r->dropped, head - CHAT_SHM_SLOTS - cur);
+    atomic_store(&r->cursor, head - CHAT_SHM_SLOTS);
+    return -1;
+  }
+  if (cur == head)
+    return 0;
+
+  struct chat_shm_slot *slot = &shm->slots[cur & (CHAT_SHM_SLOTS - 1)];
+  if (atomic_load_explicit(&slot->seq, memory_order_acquire) != cur + 1)
+  {
+    // seq alındı ama yazıcı henüz yayınlamadı. Yazıcı arada öldüyse hiç
+    // yayınlamayacak: süre dolunca slot'u atla ve kayıp say.
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    int64_t now = (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+    if (r->stall_since == 0)
+      r->stall_since = now;
+    else if (now - r->stall_since > CHAT_SHM_STALL_MS * 1000000LL)
+    {
+      r->stall_since = 0;
+      atomic_fetch_add(&r->dropped, 1);
+      atomic_store(&r->cursor, cur + 1);
+      return -1;
+    }
+    return 0;
+  }
+  r->stall_since = 0;
+
+  uint32_t n = slot->len;
+  if (n > CHAT_SHM_MSG_MAX)
+    n = CHAT_SHM_MSG_MAX;
+  *from = slot->pid;
+  memcpy(buf, slot->data, n);
+  *len = n;
+
+  // Kopyalarken slot'un üstüne yazıldıysa bu mesaj kayıp sayılır
+  atomic_thread_fence(memory_order_acquire);
+  if (atomic_load_explicit(&slot->seq, memory_order_relaxed) != cur + 1)
+  {
+    atomic_fetch_add(&r->dropped, 1);
+    atomic_store(&r->cursor, cur + 1);
+    return -1;
+  }
+  atomic_store(&r->cursor, cur + 1);
+  return 1;
+}
+
+// Yeni mesaj gelene (ya da timeout dolana, NULL: sonsuz) kadar futex'te uyur.
+// Cursor'daki slot sahiplenilmiş ama yayınlanmamışsa en fazla
+// CHAT_SHM_PENDING_NS uyur: yayın uyandırır, ölü yazıcıyı recv'in süresi yakalar.
+void chat_shm_wait(struct chat_shm *shm, struct chat_shm_reader *r,
+                   const struct timespec *timeout)
+{
+  static const struct timespec pending = {0, CHAT_SHM_PENDING_NS};
+  uint32_t word = atomic_load(&shm->futex);
+  atomic_fetch_add(&shm->waiters, 1);
+  // futex word'ünü okuduktan sonra mesaj geldiyse uyuma (kayıp uyandırma yok)
+  uint64_t cur = atomic_load(&r->cursor);
+  if (atomic_load(&shm->head) == cur)
+    chat_futex(&shm->futex, FUTEX_WAIT, word, timeout);
+  else if (atomic_load_explicit(&shm->slots[cur & (CHAT_SHM_SLOTS - 1)].seq,
+                                memory_order_acquire) != cur + 1)
+  {
+    if (timeout == NULL || timeout->tv_sec > 0 || timeout->tv_nsec > CHAT_SHM_PENDING_NS)
+      timeout = &pending;
+    chat_futex(&shm->futex, FUTEX_WAIT, word, timeout);
+  }
+  atomic_fetch_sub(&shm->waiters, 1);
+}
+
+// Okuyucu tablosundan çıkar; odada kimse kalmadıysa dosyayı sil
+void chat_shm_leave(struct chat_shm *shm, struct chat_shm_reader *r, const char *path)
+{
+  int fd = open(path, O_RDWR | O_CLOEXEC);
+  if (fd >= 0)
+    flock(fd, LOCK_EX); // katılan biriyle yarışmasın
+  atomic_store(&r->pid, 0);
+  bool empty = true;
+  for (int i = 0; i < CHAT_SHM_READERS; i++)
+    if (atomic_load(&shm->readers[i].pid) != 0)
+      empty = false;
+  munmap(shm, sizeof(struct chat_shm));
+  if (empty && fd >= 0)
+    unlink(path);
+  if (fd >= 0)
+    close(fd);
+}
+
+/*
+ * ===== Chatroom log (chatroom --log / --replay N / --since T) =====
+ * Oda başına append-only kayıt dosyası: /tmp/chatroom-<room>.log
+ * (oda klasörünün dışında, üye sanılmasın). Dosya 64 byte'lık bir başlıkla
+ * başlar (sıradaki seq, yazılmış son offset, son zaman damgası, diske
+ * senkronlanmış son seq), ardından sabit başlıklı kayıtlar gelir:
+ *   [magic | len | seq | ts_ns] + mesaj + 8 byte hizalama
+ * Yanındaki .idx dosyası seyrek index'tir: her CHAT_LOG_INDEX_EVERY'inci
+ * kaydın (seq, ts, offset)'i. seq'ler ardışık olduğu için N. mesajın index
+ * girişi doğrudan hesaplanır, zaman için index'te binary search yapılır;
+ * replay dosyayı baştan taramaz, mmap edip en yakın index girişinden yürür.
+ *
+ * Yazma flock altında yapılır (birden fazla gönderen aynı dosyaya yazar).
+ * fdatasync satır başına değil gruplar halinde yapılır (group commit):
+ * CHAT_LOG_SYNC_EVERY mesajda ya da CHAT_LOG_SYNC_MS geçince, bir de çıkarken.
+ * Başka bir üyenin sync'i bizim kayıtlarımızı da kapsadıysa tekrar sync yok.
+ */
+#define CHAT_LOG_MAGIC 0x43484c47u     // "CHLG"
+#define CHAT_LOG_REC_MAGIC 0x4d534721u // "MSG!"
+#define CHAT_LOG_HEADER_SIZE 64        // dosya başlığı boyutu
+#define CHAT_LOG_INDEX_EVERY 64        // kaç kayıtta bir index girişi
+#define CHAT_LOG_SYNC_EVERY 64         // en fazla kaç mesaj senkronsuz kalsın
+#define CHAT_LOG_SYNC_MS 1000          // en fazla kaç ms senkronsuz kalsın
+
+struct chat_log_header
+{
+  uint32_t magic;      // CHAT_LOG_MAGIC
+  uint32_t version;    // 1
+  uint64_t next_seq;   // sıradaki mesajın seq'i
+  uint64_t end_off;    // son tam kaydın bittiği offset
+  int64_t last_ts;     // son zaman damgası (ns, monoton tutulur)
+  uint64_t synced_seq; // bu seq'ten önceki kayıtlar diskte
+  char pad[CHAT_LOG_HEADER_SIZE - 40];
+};
+
+struct chat_log_rec
+{
+  uint32_t magic; // CHAT_LOG_REC_MAGIC
+  uint32_t len;   // mesaj uzunluğu (hizalama hariç)
+  uint64_t seq;   // mesaj sıra numarası
+  int64_t ts_ns;  // gönderim zamanı (CLOCK_REALTIME, ns)
+};
+
+struct chat_log_idx
+{
+  uint64_t seq;  // kaydın seq'i (CHAT_LOG_INDEX_EVERY'nin katı)
+  int64_t ts_ns; // kaydın zamanı
+  uint64_t off;  // kaydın log dosyasındaki offset'i
+};
+
+struct chat_log
+{
+  int fd;                     // log dosyası
+  int idx_fd;                 // index dosyası
+  uint64_t last_seq;          // yazdığımız son mesajın seq'i + 1
+  int unsynced;               // son sync'ten beri yazdığımız mesaj sayısı
+  struct timespec last_sync;  // son sync zamanı (CLOCK_MONOTONIC)
+};
+
+static int64_t chat_now_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_REALTIME, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static size_t chat_log_rec_size(uint32_t len)
+{
+  return (sizeof(struct chat_log_rec) + len + 7) & ~(size_t)7; // 8 byte hizala
+}
+
+static int chat_log_paths(const char *room, char *log_path, char *idx_path, size_t size)
+{
+  int n1 = snprintf(log_path, size, "/tmp/chatroom-%s.log", room);
+  int n2 = snprintf(idx_path, size, "/tmp/chatroom-%s.idx", room);
+  return (n1 < 0 || n1 >= (int)size || n2 < 0 || n2 >= (int)size) ? -1 : 0;
+}
+
+// Log ve index dosyalarını açar (yoksa oluşturur). Başarılıysa 0 döner.
+int chat_log_open(const char *room, struct chat_log *log)
+{
+  char log_path[512], idx_path[512];
+  memset(log, 0, sizeof(*log));
+  log->fd = log->idx_fd = -1;
+  if (chat_log_paths(room, log_path, idx_path, sizeof(log_path)) != 0)
+  {
+    printf("-%s: chatroom: path too long\n", sysname);
+    return -1;
+  }
+  log->fd = open(log_path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+  log->idx_fd = open(idx_path, O_RDWR | O_CREAT | O_CLOEXEC, 0666);
+  if (log->fd < 0 || log->idx_fd < 0)
+  {
+    printf("-%s: chatroom: %s: %s\n", sysname, log->fd < 0 ? log_path : idx_path,
+           strerror(errno));
+    if (log->fd >= 0)
+      close(log->fd);
+    if (log->idx_fd >= 0)
+      close(log->idx_fd);
+    return -1;
+  }
+
+  // İlk açan başlığı yazar
+  flock(log->fd, LOCK_EX);
+  struct chat_log_header h;
+  if (pread(log->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h))
+  {
+    memset(&h, 0, sizeof(h));
+    h.magic = CHAT_LOG_MAGIC;
+    h.version = 1;
+    h.end_off = CHAT_LOG_HEADER_SIZE;
+    if (pwrite(log->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) ||
+        ftruncate(log->idx_fd, 0) != 0)
+      h.magic = 0;
+  }
+  flock(log->fd, LOCK_UN);
+  if (h.magic != CHAT_LOG_MAGIC)
+  {
+    printf("-%s: chatroom: %s: not a chatroom log\n", sysname, log_path);
+    close(log->fd);
+    close(log->idx_fd);
+    return -1;
+  }
+  clock_gettime(CLOCK_MONOTONIC, &log->last_sync);
+  return 0;
+}
+
+// Biriken kayıtları diske indirir (group commit). force değilse sadece
+// eşik aşıldıysa sync eder.
+void chat_log_sync(struct chat_log *log, bool force)
+{
+  if (log->unsynced == 0)
+    return;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long ms = (now.tv_sec - log->last_sync.tv_sec) * 1000 +
+            (now.tv_nsec - log->last_sync.tv_nsec) / 1000000;
+  if (!force && log->unsynced < CHAT_LOG_SYNC_EVERY && ms < CHAT_LOG_SYNC_MS)
+    return;
+
+  flock(log->fd, LOCK_EX);
+  struct chat_log_header h;
+  if (pread(log->fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) && h.synced_seq < log->last_seq)
+  {
+    // Bizim son kaydımızı kapsayan bir sync henüz yok: herkesinkini birlikte indir
+    uint64_t upto = h.next_seq;
+    fdatasync(log->idx_fd);
+    fdatasync(log->fd);
+    h.synced_seq = upto;
+    pwrite(log->fd, &h, sizeof(h), 0);
+  }
+  flock(log->fd, LOCK_UN);
+  log->unsynced = 0;
+  log->last_sync = now;
+}
+
+// Mesajı log'a ekler (seq ve zaman damgası flock altında verilir)
+void chat_log_append(struct chat_log *log, const char *msg, size_t len)
+{
+  struct chat_log_rec rec = {CHAT_LOG_REC_MAGIC, (uint32_t)len, 0, 0};
+  static const char zeros[8];
+  size_t pad = chat_log_rec_size(rec.len) - sizeof(rec) - len;
+
+  flock(log->fd, LOCK_EX);
+  struct chat_log_header h;
+  if (pread(log->fd, &h, sizeof(h), 0) != (ssize_t)sizeof(h) || h.magic != CHAT_LOG_MAGIC)
+  {
+    flock(log->fd, LOCK_UN);
+    return;
+  }
+  rec.seq = h.next_seq;
+  rec.ts_ns = chat_now_ns();
+  if (rec.ts_ns < h.last_ts)
+    rec.ts_ns = h.last_ts; // saat geri gitse de zaman sırası bozulmasın
+
+  // Kaydı tek writev ile end_off'a yaz (yarım kalmış eski kaydın üstüne yazar)
+  struct iovec iov[3] = {{&rec, sizeof(rec)}, {(void *)msg, len}, {(void *)zeros, pad}};
+  ssize_t w = pwritev(log->fd, iov, 3, (off_t)h.end_off);
+  if (w == (ssize_t)chat_log_rec_size(rec.len))
+  {
+    if (rec.seq % CHAT_LOG_INDEX_EVERY == 0)
+    {
+      struct chat_log_idx e = {rec.seq, rec.ts_ns, h.end_off};
+      pwrite(log->idx_fd, &e, sizeof(e),
+             (off_t)(rec.seq / CHAT_LOG_INDEX_EVERY * sizeof(e)));
+    }
+    h.next_seq++;
+    h.end_off += w;
+    h.last_ts = rec.ts_ns;
+    pwrite(log->fd, &h, sizeof(h), 0); // kayıt ancak başlık güncellenince görünür
+    log->last_seq = h.next_seq;
+    log->unsynced++;
+  }
+  flock(log->fd, LOCK_UN);
+  chat_log_sync(log, false);
+}
+
+// Zamanla yapılacak sync'e kalan süre (ms); senkronsuz kayıt yoksa -1
+int chat_log_sync_timeout(const struct chat_log *log)
+{
+  if (log->unsynced == 0)
+    return -1;
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  long ms = (now.tv_sec - log->last_sync.tv_sec) * 1000 +
+            (now.tv_nsec - log->last_sync.tv_nsec) / 1000000;
+  return ms >= CHAT_LOG_SYNC_MS ? 0 : (int)(CHAT_LOG_SYNC_MS - ms);
+}
+
+// fd okunabilir olana kadar bekler; bu sırada CHAT_LOG_SYNC_MS dolarsa
+// senkronsuz kayıtları indirir (yeni mesaj gelmese de süre sınırı tutar)
+void chat_log_wait_input(struct chat_log *log, int fd)
+{
+  int t;
+  while ((t = chat_log_sync_timeout(log)) >= 0)
+  {
+    struct pollfd p = {fd, POLLIN, 0};
+    int n = poll(&p, 1, t);
+    if (n > 0 || (n < 0 && errno != EINTR))
+      return;
+    if (n == 0)
+      chat_log_sync(log, false);
+  }
+}
+
+void chat_log_close(struct chat_log *log)
+{
+  if (log->fd < 0)
+    return;
+  chat_log_sync(log, true); // kalan her şeyi diske indir
+  close(log->fd);
+  close(log->idx_fd);
+  log->fd = log->idx_fd = -1;
+}
+
+// --since argümanı: epoch saniyesi ya da "30s", "10m", "2h", "1d" (şu andan önce)
+int chat_parse_since(const char *s, int64_t *ns)
+{
+  char *end;
+  errno = 0;
+  long long v = strtoll(s, &end, 10);
+  if (errno != 0 || end == s || v < 0)
+    return -1;
+  long long unit = 0;
+  if (*end == 's')
+    unit = 1;
+  else if (*end == 'm')
+    unit = 60;
+  else if (*end == 'h')
+    unit = 3600;
+  else if (*end == 'd')
+    unit = 86400;
+  else if (*end != '\0')
+    return -1;
+  if (unit != 0 && end[1] != '\0')
+    return -1;
+
+  if (unit == 0)
+    *ns = v * 1000000000LL; // mutlak zaman
+  else
+    *ns = chat_now_ns() - v * unit * 1000000000LL;
+  return 0;
+}
+
+// Son n mesajı (n >= 0) ya da since_ns'ten sonrakileri (n < 0) ekrana basar
+int chat_log_replay(const char *room, long n, int64_t since_ns)
+{
+  char log_path[512], idx_path[512];
+  if (chat_log_paths(room, log_path, idx_path, sizeof(log_path)) != 0)
+    return -1;
+  int fd = open(log_path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+  {
+    printf("-%s: chatroom: no log for room '%s'\n", sysname, room);
+    return -1;
+  }
+  int idx_fd = open(idx_path, O_RDONLY | O_CLOEXEC);
+
+  // Başlığı ve index'i tutarlı okumak için kısa süre paylaşımlı kilit
+  flock(fd, LOCK_SH);
+  struct chat_log_header h;
+  struct stat ist;
+  bool ok = pread(fd, &h, sizeof(h), 0) == (ssize_t)sizeof(h) && h.magic == CHAT_LOG_MAGIC;
+  size_t nidx = 0;
+  if (ok && idx_fd >= 0 && fstat(idx_fd, &ist) == 0)
+    nidx = ist.st_size / sizeof(struct chat_log_idx);
+  if (nidx > (h.next_seq + CHAT_LOG_INDEX_EVERY - 1) / CHAT_LOG_INDEX_EVERY)
+    nidx = (h.next_seq + CHAT_LOG_INDEX_EVERY - 1) / CHAT_LOG_INDEX_EVERY;
+  const char *data = MAP_FAILED;
+  const struct chat_log_idx *idx = MAP_FAILED;
+  if (ok && h.end_off > CHAT_LOG_HEADER_SIZE)
+    data = mmap(NULL, h.end_off, PROT_READ, MAP_SHARED, fd, 0);
+  if (nidx > 0)
+    idx = mmap(NULL, nidx * sizeof(*idx), PROT_READ, MAP_SHARED, idx_fd, 0);
+  flock(fd, LOCK_UN); // mmap dosyayı açık tutar, close() kilidi bırakmaz
+  close(fd);
+  if (idx_fd >= 0)
+    close(idx_fd);
+  if (!ok || data == MAP_FAILED)
+  {
+    if (idx != MAP_FAILED)
+      munmap((void *)idx, nidx * sizeof(*idx));
+    return ok ? 0 : -1; // boş log
+  }
+  madvise((void *)data, h.end_off, MADV_SEQUENTIAL);
+
+  // Başlangıç noktası: istenen ilk seq'i (ya da zamanı) kapsayan index girişi
+  uint64_t first_seq = 0; // bundan önceki seq'ler basılmaz
+  uint64_t off = CHAT_LOG_HEADER_SIZE;
+  if (n >= 0)
+  {
+    first_seq = h.next_seq > (uint64_t)n ? h.next_seq - n : 0;
+    size_t i = first_seq / CHAT_LOG_INDEX_EVERY;
+    if (idx != MAP_FAILED && i < nidx && idx[i].seq == i * CHAT_LOG_INDEX_EVERY)
+      off = idx[i].off;
+  }
+  else if (idx != MAP_FAILED)
+  {
+    // ts >= since olan ilk girişi bul; kayıt ondan önceki girişten sonra başlar
+    size_t lo = 0, hi = nidx;
+    while (lo < hi)
+    {
+      size_t mid = lo + (hi - lo) / 2;
+      if (idx[mid].ts_ns < since_ns)
+        lo = mid + 1;
+      else
+        hi = mid;
+    }
+    if (lo > 0)
+      off = idx[lo - 1].off;
+  }
+
+  int shown = 0;
+  while (off + sizeof(struct chat_log_rec) <= h.end_off)
+  {
+    const struct chat_log_rec *rec = (const struct chat_log_rec *)(data + off);
+    if (rec->magic != CHAT_LOG_REC_MAGIC || off + chat_log_rec_size(rec->len) > h.end_off)
+      break; // bozuk kayıt
+    if (rec->seq >= first_seq && (n >= 0 || rec->ts_ns >= since_ns))
+    {
+      time_t sec = rec->ts_ns / 1000000000LL;
+      struct tm tm;
+      char when[16];
+      localtime_r(&sec, &tm);
+      strftime(when, sizeof(when), "%H:%M:%S", &tm);
+      printf("[%s] %.*s", when, (int)rec->len, (const char *)(rec + 1));
+      shown++;
+    }
+    off += chat_log_rec_size(rec->len);
+  }
+  printf("-- %d message(s) from log --\n", shown);
+  fflush(stdout);
+
+  munmap((void *)data, h.end_off);
+  if (idx != MAP_FAILED)
+    munmap((void *)idx, nidx * sizeof(*idx));
+  return 0;
+}
+
+// Reader tarafı: giriş/çıkış bildirimini ekrana basar
+static void chat_notice_event(void *ctx, const struct inotify_event *ev)
+{
+  const struct chat_room *room = ctx;
+  if (!chat_is_member_name(room, ev->name))
+    return;
+  if (ev->mask & (IN_CREATE | IN_MOVED_TO))
+    printf("* %s joined the room\n", ev->name);
+  else
+    printf("* %s left the room\n", ev->name);
+  fflush(stdout);
+}
+
+// Reader tarafı: tamamlanan mesajı ekrana basar
+static void chat_print_message(void *ctx, const char *msg, size_t len)
+{
+  (void)ctx;
+  fwrite(msg, 1, len, stdout);
+}
+
+// FIFO reader child'ı: kendi FIFO'muzdaki mesajları ve oda klasöründeki
+// giriş/çıkış olaylarını poll ile bekleyip ekrana basar. Parent SIGTERM ile durdurur.
+void chat_reader_main(struct chat_room *room, int fifo_fd)
+{
+  // Parent'ın inotify fd'sinden kopyalanan olayları tüketmemek için ayrı instance
+  if (room->ino_fd >= 0)
+    close(room->ino_fd);
+  room->ino_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+  if (room->ino_fd >= 0)
+    inotify_add_watch(room->ino_fd, room->dir, CHAT_INOTIFY_MASK);
+
+  struct chat_decoder dec; // çerçeveleri mesajlara birleştirir
+  if (chat_decoder_init(&dec) != 0)
+    exit(1);
+  while (1)
+  {
+    struct pollfd p[2] = {{fifo_fd, POLLIN, 0}, {room->ino_fd, POLLIN, 0}};
+    if (poll(p, room->ino_fd >= 0 ? 2 : 1, -1) < 0)
+      continue; // EINTR
+    if (p[0].revents & POLLIN)
+    {
+      // Tek büyük read ile ne birikmişse al, tamamlanan mesajları bas
+      if (chat_decoder_read(&dec, fifo_fd, chat_print_message, NULL) > 0)
+        fflush(stdout); // hemen göster
+    }
+    if (room->ino_fd >= 0 && (p[1].revents & POLLIN))
+      chat_read_events(room->ino_fd, chat_notice_event, room);
+  }
+}
+
+// chatroom'un ortak giriş döngüsü: satırları okur, "username: mesaj\n"
+// biçiminde seçilen transport'un send fonksiyonuna verir (log açıksa kaydeder).
+// Girdide hazır bekleyen satırlar (yapıştırma, pipe) art arda kuyruğa alınır;
+// flush (NULL olabilir) yeni girdi beklemeden hemen önce çağrılır.
+static void chat_input_loop(const char *user,
+                            void (*send)(void *ctx, const char *msg, size_t len),
+                            void (*flush)(void *ctx), void *ctx, struct chat_log *log)
+{
+  // Kullanıcıdan satır satır mesaj al (satır uzunluğu sınırsız)
+  struct line_reader lr;
+  if (line_reader_open(&lr, STDIN_FILENO) != 0)
+    return;
+  char *msg = NULL;   // "username: mesaj\n" buffer'ı
+  size_t msg_cap = 0; // buffer kapasitesi
+  size_t ulen = strlen(user);
+
+  while (1)
+  {
+    if (!line_reader_has_line(&lr))
+    {
+      // Bekleyen satır yok: kuyruktakileri gönder, sonra kullanıcıyı bekle
+      if (flush != NULL)
+        flush(ctx);
+      printf("chat> "); // chat prompt
+      fflush(stdout);
+      if (log != NULL)
+        chat_log_wait_input(log, STDIN_FILENO);
+    }
+
+    const char *line;
+    ssize_t r = line_reader_next(&lr, &line); // kullanıcıdan oku ('\n' hariç)
+    if (r < 0)
+    { // Ctrl+D / EOF
+      break;
+    }
+
+    // Çıkış komutu
+    if (r == 5 && memcmp(line, "/exit", 5) == 0)
+    {
+      break;
+    }
+
+    // Gönderilecek mesaj formatı: "username: mesaj\n"
+    size_t len = ulen + 2 + (size_t)r + 1;
+    if (len > msg_cap)
+    {
+      char *nmsg = realloc(msg, len);
+      if (nmsg == NULL)
+        break;
+      msg = nmsg;
+      msg_cap = len;
+    }
+    memcpy(msg, user, ulen);
+    memcpy(msg + ulen, ": ", 2);
+    memcpy(msg + ulen + 2, line, r);
+    msg[len - 1] = '\n';
+    send(ctx, msg, len);
+    if (log != NULL)
+      chat_log_append(log, msg, len);
+  }
+
+  if (flush != NULL)
+    flush(ctx);
+  free(msg);
+  line_reader_close(&lr);
+}
+
+// FIFO transport: anında gönderim (chatroom-bench) ve kuyruklu gönderim
+static void chat_send_fifo(void *ctx, const char *msg, size_t len)
+{
+  chat_send((struct chat_room *)ctx, msg, len);
+}
+
+static void chat_queue_fifo(void *ctx, const char *msg, size_t len)
+{
+  chat_queue((struct chat_room *)ctx, msg, len);
+}
+
+static void chat_flush_fifo(void *ctx)
+{
+  chat_flush((struct chat_room *)ctx);
+}
+
+// shm transport: slot'tan uzun mesajlar ardışık slot'lara bölünür
+static void chat_send_shm(void *ctx, const char *msg, size_t len)
+{
+  do
+  {
+    size_t chunk = len < CHAT_SHM_MSG_MAX ? len : CHAT_SHM_MSG_MAX;
+    chat_shm_send((struct chat_shm *)ctx, msg, chunk);
+    msg += chunk;
+    len -= chunk;
+  } while (len > 0);
+}
+
+// chatroom --shm: oda /dev/shm'deki ortak ring; reader child futex'te bekler
+int run_chatroom_shm(const char *room, const char *user, struct chat_log *log)
+{
+  char path[512];
+  struct chat_shm_reader *me;
+  struct chat_shm *shm = chat_shm_open(room, user, path, sizeof(path), &me);
+  if (shm == NULL)
+    return UNKNOWN;
+
+  pid_t reader_pid = fork(); // okuyucu process (mapping paylaşılır)
+  if (reader_pid < 0)
+  {
+    printf("-%s: chatroom: fork failed: %s\n", sysname, strerror(errno));
+    chat_shm_leave(shm, me, path);
+    return UNKNOWN;
+  }
+
+  if (reader_pid == 0)
+  {
+    // ===== CHILD (READER) =====
+    pid_t owner = getppid(); // kendi gönderdiğimiz mesajları basma
+    char buf[CHAT_SHM_MSG_MAX];
+    while (1)
+    {
+      uint32_t len;
+      pid_t from;
+      uint64_t dropped = atomic_load(&me->dropped);
+      int r = chat_shm_recv(shm, me, buf, &len, &from);
+      if (r > 0 && from != owner)
+      {
+        fwrite(buf, 1, len, stdout); // ekrana bas
+        fflush(stdout);              // hemen göster
+      }
+      else if (r < 0)
+        printf("-- missed %llu message(s) --\n",
+               (unsigned long long)(atomic_load(&me->dropped) - dropped));
+      else if (r == 0)
+        chat_shm_wait(shm, me, NULL); // yeni mesaja kadar uyu
+    }
+  }
+
+  // ===== PARENT (WRITER + INPUT LOOP) =====
+  printf("Entered chatroom '%s' as '%s' (shm). Type /exit to leave.\n", room, user);
+  chat_input_loop(user, chat_send_shm, NULL, shm, log);
+
+  // Reader'ı durdur
+  kill(reader_pid, SIGTERM);    // reader child'i öldür
+  waitpid(reader_pid, NULL, 0); // reader bitmesini bekle
+  chat_shm_leave(shm, me, path);
+
+  printf("Left chatroom '%s'.\n", room);
+  return SUCCESS;
+}
+
+// FIFO odasına katılır: oda klasörünü ve kendi FIFO'muzu hazırlar, üye
+// listesini yükler. Okuma ucunun fd'sini döner (hata: -1, mesaj basılmış).
+int chat_fifo_join(const char *room, const char *user, struct chat_room *chat,
+                   char *my_fifo, size_t fifo_size)
+{
+  // Oda klasörü yolu: /tmp/chatroom-<room>
+  char room_dir[512];
+  snprintf(room_dir, sizeof(room_dir), "/tmp/chatroom-%s", room);
+
+  // Kullanıcının FIFO yolu: /tmp/chatroom-<room>/<username>
+  // my_fifo yolu buffer'a sığdı mı kontrol et
+  int n1 = snprintf(my_fifo, fifo_size, "%s/%s", room_dir, user); // yolu yaz
+  if (n1 < 0 || n1 >= (int)fifo_size)
+  {                                                    // sığmadıysa
+    printf("-%s: chatroom: path too long\n", sysname); // hata bas
+    return -1;                                    // çık
+  }
+
+  // 1) Oda klasörünü oluştur (varsa sorun değil)
+  if (mkdir(room_dir, 0777) == -1)
+  { // klasör oluşturmayı dene
+    if (errno != EEXIST)
+    { // zaten varsa sorun değil
+      printf("-%s: chatroom: mkdir failed: %s\n", sysname, strerror(errno));
+      return -1;
+    }
+  }
+
+  // 2) Kullanıcı FIFO'sunu gizli geçici adla oluştur ve okuma ucunu aç.
+  // Gerçek adına ancak okuyucusu hazır olunca taşınır (bkz. chat_open_member).
+  char tmp_fifo[512];
+  int n2 = snprintf(tmp_fifo, sizeof(tmp_fifo), "%s/.%s", room_dir, user);
+  if (n2 < 0 || n2 >= (int)sizeof(tmp_fifo))
+  {
+    printf("-%s: chatroom: path too long\n", sysname);
+    return -1;
+  }
+  unlink(tmp_fifo); // önceki çökmüş denemeden kalmış olabilir
+  if (mkfifo(tmp_fifo, 0666) == -1)
+  { // fifo oluşturmayı dene
+    printf("-%s: chatroom: mkfifo failed: %s\n", sysname, strerror(errno));
+    return -1;
+  }
+  // FIFO'yu O_RDWR açıyoruz ki open bloklamasın ve read beklesin
+  int fifo_fd = open(tmp_fifo, O_RDWR | O_CLOEXEC); // hem okuma hem yazma aç
+  if (fifo_fd < 0)
+  {
+    printf("-%s: chatroom: open fifo failed: %s\n", sysname, strerror(errno));
+    unlink(tmp_fifo);
+    return -1;
+  }
+
+  // Üye listesini yükle ve izlemeye başla (kendi girişimiz listeye girmez)
+  memset(chat, 0, sizeof(*chat));
+  snprintf(chat->dir, sizeof(chat->dir), "%s", room_dir);
+  chat->user = user;
+  if (chat_room_load(chat) != 0)
+  {
+    printf("-%s: chatroom: %s: %s\n", sysname, room_dir, strerror(errno));
+    chat_room_close(chat);
+    close(fifo_fd);
+    unlink(tmp_fifo);
+    return -1;
+  }
+
+  // Artık okuyucumuz var: odaya görünür şekilde gir (diğerleri IN_MOVED_TO alır)
+  if (rename(tmp_fifo, my_fifo) == -1)
+  {
+    printf("-%s: chatroom: rename failed: %s\n", sysname, strerror(errno));
+    chat_room_close(chat);
+    close(fifo_fd);
+    unlink(tmp_fifo);
+    return -1;
+  }
+  return fifo_fd;
+}
+
+// chatroom'un FIFO transport'u (varsayılan)
+int run_chatroom_fifo(const char *room, const char *user, struct chat_log *log)
+{
+  char my_fifo[512];     // /tmp/chatroom-<room>/<username>
+  struct chat_room chat; // üye listesi + açık fd cache'i
+  int fifo_fd = chat_fifo_join(room, user, &chat, my_fifo, sizeof(my_fifo));
+  if (fifo_fd < 0)
+    return UNKNOWN;
+
+  // 3) Reader child: kendi FIFO'muzdan gelen mesajları ve giriş/çıkışları basacak
+  pid_t reader_pid = fork(); // okuyucu process
+  if (reader_pid < 0)
+  {
+    printf("-%s: chatroom: fork failed: %s\n", sysname, strerror(errno));
+    chat_room_close(&chat);
+    close(fifo_fd);
+    unlink(my_fifo);
+    return UNKNOWN;
+  }
+
+  if (reader_pid == 0)
+  {
+    // ===== CHILD (READER) =====
+    chat_reader_main(&chat, fifo_fd); // dönmez
+  }
+  close(fifo_fd); // okuma ucu reader'da
+
+  // ===== PARENT (WRITER + INPUT LOOP) =====
+  printf("Entered chatroom '%s' as '%s'. Type /exit to leave.\n", room, user);
+
+  // Okuyanı kapanmış FIFO'ya yazmak shell'i öldürmesin (EPIPE dönsün)
+  void (*old_sigpipe)(int) = signal(SIGPIPE, SIG_IGN);
+
+  chat_input_loop(user, chat_queue_fifo, chat_flush_fifo, &chat, log);
+  chat_room_close(&chat);       // cache'li fd'leri kapat
+  signal(SIGPIPE, old_sigpipe); // eski SIGPIPE davranışı
+
+  // Reader'ı durdur
+  kill(reader_pid, SIGTERM);    // reader child'i öldür
+  waitpid(reader_pid, NULL, 0); // reader bitmesini bekle
+
+  // Çıkınca kendi FIFO'yu silmek istersen (temizlik)
+  unlink(my_fifo); // kendi fifo dosyasını sil
+
+  printf("Left chatroom '%s'.\n", room);
+  return SUCCESS;
+}
+
+// chatroom builtin: FIFO (varsayılan) ya da ortak bellek üzerinden basit chat
+int run_chatroom_builtin(struct command_t *command)
+{
+  // Kullanım kontrolü: chatroom [--shm] [--log] [--replay N | --since T] <roomname> <username>
+  int a = 1;
+  bool use_shm = false; // --shm: FIFO yerine ortak bellek ring'i
+  bool use_log = false; // --log: gönderdiğimiz mesajları oda log'una yaz
+  long replay = -1;     // --replay N: girerken son N mesajı göster
+  int64_t since = -1;   // --since T: girerken T'den sonraki mesajları göster
+  for (; command->args[a] != NULL && strncmp(command->args[a], "--", 2) == 0; a++)
+  {
+    const char *opt = command->args[a];
+    if (strcmp(opt, "--shm") == 0)
+      use_shm = true;
+    else if (strcmp(opt, "--log") == 0)
+      use_log = true;
+    else if (strcmp(opt, "--replay") == 0 && command->args[a + 1] != NULL &&
+             (replay = atoi(command->args[a + 1])) >= 0)
+      a++;
+    else if (strcmp(opt, "--since") == 0 && command->args[a + 1] != NULL &&
+             chat_parse_since(command->args[a + 1], &since) == 0)
+      a++;
+    else
+    {
+      printf("-%s: chatroom: bad option: %s\n", sysname, opt);
+      return UNKNOWN;
+    }
+  }
+  if (command->args[a] == NULL || command->args[a + 1] == NULL)
+  {
+    printf("-%s: chatroom: usage: chatroom [--shm] [--log] [--replay N | --since T] <roomname> <username>\n",
+           sysname);
+    return UNKNOWN;
+  }
+
+  const char *room = command->args[a];     // oda adı
+  const char *user = command->args[a + 1]; // kullanıcı adı
+
+  // Geç katılanlar için geçmiş (odaya girmeden önce basılır)
+  if (replay >= 0 || since >= 0)
+    chat_log_replay(room, replay, since);
+
+  struct chat_log log_store;
+  struct chat_log *log = NULL; // NULL: log kapalı
+  if (use_log)
+  {
+    if (chat_log_open(room, &log_store) != 0)
+      return UNKNOWN;
+    log = &log_store;
+  }
+  if (use_shm)
+  {
+    int ret = run_chatroom_shm(room, user, log);
+    if (log != NULL)
+      chat_log_close(log);
+    return ret;
+  }
+  int ret = run_chatroom_fifo(room, user, log);
+  if (log != NULL)
+    chat_log_close(log);
+  return ret;
+}
+
+/*
+ * ===== chatroom-bench =====
+ * Geçici bir odada N simüle kullanıcı çalıştırır. Her kullanıcı gerçek
+ * chatroom'daki gibi iki process'tir: gönderen (chat_send / chat_shm_send ile
+ * sabit hızda mesaj yollar) ve okuyucu (kendi FIFO'sunu / shm cursor'ını
+ * okur). Mesajın içinde gönderim zamanı (CLOCK_MONOTONIC) vardır; okuyucu
+ * teslim gecikmesini ölçüp paylaşımlı anonim mmap'teki sonuç alanına yazar.
+ * Sonunda throughput, p50/p99/p999 gecikme, kayıp/bozuk mesaj ve mesaj
+ * başına CPU (getrusage RUSAGE_CHILDREN farkı) basılır.
+ */
+#define CB_MAX_USERS 64          // en fazla simüle kullanıcı
+#define CB_MAX_SAMPLES 4000000   // tüm kullanıcılar için en fazla gecikme örneği
+#define CB_DRAIN_MS 1000         // gönderim bitince geç gelenler için bekleme
+
+struct cb_options
+{
+  bool shm;     // --shm transport'u
+  int users;    // -u: kullanıcı sayısı
+  double rate;  // -r: kullanıcı başına mesaj/sn
+  double secs;  // -d: gönderim süresi
+  int size;     // -s: mesaj boyutu (byte, '\n' dahil)
+};
+
+// Process'ler arası paylaşılan sayaçlar ve gecikme örnekleri
+struct cb_shared
+{
+  _Atomic int joined;                       // odaya girmiş kullanıcı sayısı
+  _Atomic int finished;                     // gönderimi bitmiş kullanıcı sayısı
+  _Atomic int64_t start_ns;                 // ortak başlangıç zamanı (0: henüz yok)
+  _Atomic uint64_t sent[CB_MAX_USERS];      // kullanıcının gönderdiği mesaj
+  _Atomic uint64_t received[CB_MAX_USERS];  // kullanıcının aldığı (sağlam) mesaj
+  _Atomic uint64_t truncated[CB_MAX_USERS]; // boyu/biçimi bozuk gelen mesaj
+  uint64_t nsamples[CB_MAX_USERS];          // kaydedilen gecikme örneği
+  uint64_t cap;                             // kullanıcı başına örnek kapasitesi
+  double samples[];                         // [users][cap] gecikmeler (µs)
+};
+
+static int64_t cb_mono_ns(void)
+{
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (int64_t)ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+static void cb_sleep_until(int64_t t_ns)
+{
+  struct timespec ts = {t_ns / 1000000000LL, t_ns % 1000000000LL};
+  while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR)
+    ;
+}
+
+// Beklenen tüm mesajlar geldi mi ya da bekleme süresi doldu mu?
+static bool cb_reader_done(struct cb_shared *sh, const struct cb_options *opt, int me)
+{
+  if (atomic_load(&sh->finished) < opt->users)
+    return false;
+  uint64_t expected = 0;
+  for (int i = 0; i < opt->users; i++)
+    if (i != me)
+      expected += atomic_load(&sh->sent[i]);
+  if (atomic_load(&sh->received[me]) + atomic_load(&sh->truncated[me]) >= expected)
+    return true;
+  return false;
+}
+
+// Gelen bir mesajı doğrular ve gecikmesini kaydeder
+static void cb_record(struct cb_shared *sh, const struct cb_options *opt, int me,
+                      const char *msg, size_t len)
+{
+  int from;
+  unsigned long long seq;
+  long long ts;
+  if ((int)len != opt->size || msg[len - 1] != '\n' ||
+      sscanf(msg, "u%d: %llu %lld ", &from, &seq, &ts) != 3)
+  {
+    atomic_fetch_add(&sh->truncated[me], 1);
+    return;
+  }
+  double us = (cb_mono_ns() - ts) / 1000.0;
+  uint64_t k = sh->nsamples[me];
+  if (k < sh->cap)
+  {
+    sh->samples[me * sh->cap + k] = us;
+    sh->nsamples[me] = k + 1;
+  }
+  atomic_fetch_add(&sh->received[me], 1);
+}
+
+struct cb_reader_ctx
+{
+  struct cb_shared *sh;
+  const struct cb_options *opt;
+  int me;
+};
+
+static void cb_emit(void *ctx, const char *msg, size_t len)
+{
+  struct cb_reader_ctx *c = ctx;
+  cb_record(c->sh, c->opt, c->me, msg, len);
+}
+
+// FIFO okuyucusu: çerçeveleri chat_decoder ile çözüp cb_record'a verir
+static void cb_fifo_reader(struct cb_shared *sh, const struct cb_options *opt, int me, int fd)
+{
+  struct chat_decoder dec;
+  struct cb_reader_ctx ctx = {sh, opt, me};
+  if (chat_decoder_init(&dec) != 0)
+    return;
+  int64_t deadline = 0;
+  while (1)
+  {
+    struct pollfd p = {fd, POLLIN, 0};
+    if (poll(&p, 1, 50) > 0)
+      chat_decoder_read(&dec, fd, cb_emit, &ctx);
+    if (cb_reader_done(sh, opt, me))
+      break;
+    if (atomic_load(&sh->finished) == opt->users)
+    {
+      if (deadline == 0)
+        deadline = cb_mono_ns() + CB_DRAIN_MS * 1000000LL;
+      else if (cb_mono_ns() > deadline)
+        break; // kalanlar kayıp sayılır
+    }
+  }
+  chat_decoder_free(&dec);
+}
+
+// shm okuyucusu: cursor'dan okur, mesaj yoksa futex'te kısa süre uyur
+static void cb_shm_reader(struct cb_shared *sh, const struct cb_options *opt, int me,
+                          struct chat_shm *shm, struct chat_shm_reader *r, pid_t owner)
+{
+  char buf[CHAT_SHM_MSG_MAX];
+  int64_t deadline = 0;
+  struct timespec tick = {0, 50 * 1000000L};
+  while (1)
+  {
+    uint32_t len;
+    pid_t from;
+    int got = chat_shm_recv(shm, r, buf, &len, &from);
+    if (got > 0 && from != owner)
+      cb_record(sh, opt, me, buf, len);
+    if (got != 0)
+      continue;
+    if (cb_reader_done(sh, opt, me))
+      break;
+    if (atomic_load(&sh->finished) == opt->users)
+    {
+      if (deadline == 0)
+        deadline = cb_mono_ns() + CB_DRAIN_MS * 1000000LL;
+      else if (cb_mono_ns() > deadline)
+        break;
+    }
+    chat_shm_wait(shm, r, &tick);
+  }
+}
+
+// Gönderen: herkes katılınca ortak başlangıçtan itibaren sabit hızda yollar
+static void cb_sender(struct cb_shared *sh, const struct cb_options *opt, int me,
+                      void (*send)(void *ctx, const char *msg, size_t len), void *ctx)
+{
+  while (atomic_load(&sh->start_ns) == 0)
+    usleep(1000);
+  int64_t start = atomic_load(&sh->start_ns);
+  int64_t period = (int64_t)(1e9 / opt->rate);
+  int64_t end = start + (int64_t)(opt->secs * 1e9);
+  char msg[CHAT_SHM_MSG_MAX];
+  // Dolgu bir kez yazılır, her mesajda sadece başlık değişir
+  memset(msg, 'x', opt->size - 1);
+  msg[opt->size - 1] = '\n';
+
+  // Kullanıcıları aynı anda değil, periyoda yayılmış şekilde başlat
+  int64_t next = start + period * me / opt->users;
+  for (uint64_t seq = 0; next < end; seq++, next += period)
+  {
+    cb_sleep_until(next);
+    int h = snprintf(msg, opt->size, "u%d: %llu %lld ", me, (unsigned long long)seq,
+                     (long long)cb_mono_ns());
+    msg[h] = 'x'; // snprintf'in NUL'unu dolguya geri çevir
+    send(ctx, msg, opt->size);
+    atomic_fetch_add(&sh->sent[me], 1);
+  }
+  atomic_fetch_add(&sh->finished, 1);
+}
+
+// Bir simüle kullanıcı (fork'lanmış process içinde): odaya girer, okuyucu
+// child'ı başlatır, gönderir ve okuyucunun bitmesini bekler
+static int cb_user_main(struct cb_shared *sh, const struct cb_options *opt,
+                        const char *room, int me)
+{
+  char user[32];
+  snprintf(user, sizeof(user), "u%d", me);
+  signal(SIGPIPE, SIG_IGN);
+
+  if (opt->shm)
+  {
+    char path[512];
+    struct chat_shm_reader *r;
+    struct chat_shm *shm = chat_shm_open(room, user, path, sizeof(path), &r);
+    if (shm == NULL)
+      return 1;
+    pid_t owner = getpid();
+    pid_t reader = fork();
+    if (reader == 0)
+    {
+      cb_shm_reader(sh, opt, me, shm, r, owner);
+      _exit(0);
+    }
+    atomic_fetch_add(&sh->joined, 1);
+    cb_sender(sh, opt, me, chat_send_shm, shm);
+    waitpid(reader, NULL, 0);
+    chat_shm_leave(shm, r, path);
+    return 0;
+  }
+
+  char my_fifo[512];
+  struct chat_room chat;
+  int fd = chat_fifo_join(room, user, &chat, my_fifo, sizeof(my_fifo));
+  if (fd < 0)
+    return 1;
+  pid_t reader = fork();
+  if (reader == 0)
+  {
+    cb_fifo_reader(sh, opt, me, fd);
+    _exit(0);
+  }
+  close(fd);
+  atomic_fetch_add(&sh->joined, 1);
+  cb_sender(sh, opt, me, chat_send_fifo, &chat);
+  waitpid(reader, NULL, 0);
+  chat_room_close(&chat);
+  unlink(my_fifo);
+  return 0;
+}
+
+// Ctrl-C ile yarıda kalan bench odasının artıklarını siler (FIFO'lar ya da
+// shm dosyası): öldürülen kullanıcılar kendi FIFO'larını silemedi
+static void cb_remove_room(const char *room, bool shm)
+{
+  char path[512];
+  if (shm)
+  {
+    snprintf(path, sizeof(path), "/dev/shm/chatroom-%s", room);
+    unlink(path);
+    return;
+  }
+  char dir[256];
+  snprintf(dir, sizeof(dir), "/tmp/chatroom-%s", room);
+  DIR *d = opendir(dir);
+  if (d == NULL)
+    return;
+  struct dirent *ent;
+  while ((ent = readdir(d)) != NULL)
+  {
+    if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
+      continue;
+    snprintf(path, sizeof(path), "%s/%s", dir, ent->d_name);
+    unlink(path);
+  }
+  closedir(d);
+  rmdir(dir);
+}
+
+// chatroom-bench [--shm] [-u users] [-r msg/s] [-d seconds] [-s bytes]
+int run_chatroom_bench(struct command_t *command)
+{
+  struct cb_options opt = {false, 4, 100, 2, 64};
+  const char *json_path = NULL; // --export-json: sonuçlar JSON olarak da yazılır
+  for (int a = 1; command->args[a] != NULL; a++)
+  {
+    const char *o = command->args[a];
+    const char *v = command->args[a + 1];
+    if (strcmp(o, "--shm") == 0)
+      opt.shm = true;
+    else if (strcmp(o, "--export-json") == 0 && v != NULL)
+      json_path = command->args[++a];
+    else if (strcmp(o, "-u") == 0 && v != NULL)
+      opt.users = atoi(command->args[++a]);
+    else if (strcmp(o, "-r") == 0 && v != NULL)
+      opt.rate = atof(command->args[++a]);
+    else if (strcmp(o, "-d") == 0 && v != NULL)
+      opt.secs = atof(command->args[++a]);
+    else if (strcmp(o, "-s") == 0 && v != NULL)
+      opt.size = atoi(command->args[++a]);
+    else
+    {
+      printf("-%s: chatroom-bench: usage: chatroom-bench [--shm] [-u users] [-r msg/s] [-d seconds] [-s bytes] [--export-json F]\n",
+             sysname);
+      return UNKNOWN;
+    }
+  }
+  if (opt.users < 2 || opt.users > CB_MAX_USERS || opt.rate <= 0 || opt.secs <= 0 ||
+      opt.size < 48 || opt.size > CHAT_SHM_MSG_MAX)
+  {
+    printf("-%s: chatroom-bench: need 2-%d users, rate > 0, duration > 0, size 48-%d\n",
+           sysname, CB_MAX_USERS, CHAT_SHM_MSG_MAX);
+    return UNKNOWN;
+  }
+
+  // Sonuç alanı: her kullanıcı (users-1) göndericiden gelen mesajları kaydeder
+  double per_sender = opt.rate * opt.secs + 1;
+  uint64_t cap = (uint64_t)(per_sender * (opt.users - 1));
+  if (cap * opt.users > CB_MAX_SAMPLES)
+    cap = CB_MAX_SAMPLES / opt.users;
+  size_t shared_size = sizeof(struct cb_shared) + cap * opt.users * sizeof(double);
+  struct cb_shared *sh = mmap(NULL, shared_size, PROT_READ | PROT_WRITE,
+                              MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+  if (sh == MAP_FAILED)
+  {
+    printf("-%s: chatroom-bench: mmap: %s\n", sysname, strerror(errno));
+    return UNKNOWN;
+  }
+  sh->cap = cap;
+
+  char room[64];
+  snprintf(room, sizeof(room), "bench-%d", (int)getpid());
+  fflush(stdout); // child'lar bufferı kopyalamasın
+
+  struct rusage ru0, ru1;
+  getrusage(RUSAGE_CHILDREN, &ru0);
+  pid_t pids[CB_MAX_USERS];
+  int started = 0;
+  for (; started < opt.users; started++)
+  {
+    pids[started] = fork();
+    if (pids[started] < 0)
+      break;
+    if (pids[started] == 0)
+      _exit(cb_user_main(sh, &opt, room, started));
+  }
+
+  // Ctrl-C kullanıcıları durdurur; biz bekleyip odayı temizleyelim
+  void (*old_int)(int) = signal(SIGINT, SIG_IGN);
+
+  // Herkes odaya girince ortak başlangıç zamanını ver
+  int64_t t_wait = cb_mono_ns() + 5000000000LL;
+  while (started == opt.users && atomic_load(&sh->joined) < opt.users && cb_mono_ns() < t_wait)
+    usleep(1000);
+  bool ok = started == opt.users && atomic_load(&sh->joined) == opt.users;
+  if (ok)
+    atomic_store(&sh->start_ns, cb_mono_ns() + 10000000LL); // 10 ms sonra
+  else
+  {
+    printf("-%s: chatroom-bench: could not start all users\n", sysname);
+    for (int i = 0; i < started; i++)
+      kill(pids[i], SIGKILL);
+  }
+  bool interrupted = false;
+  for (int i = 0; i < started; i++)
+  {
+    int status = 0;
+    waitpid(pids[i], &status, 0);
+    if (WIFSIGNALED(status) && WTERMSIG(status) == SIGINT)
+      interrupted = true;
+  }
+  signal(SIGINT, old_int);
+  getrusage(RUSAGE_CHILDREN, &ru1);
+
+  if (interrupted)
+  {
+    cb_remove_room(room, opt.shm);
+    printf("-%s: chatroom-bench: interrupted\n", sysname);
+    munmap(sh, shared_size);
+    return UNKNOWN;
+  }
+  if (!opt.shm)
+  {
+    char dir[512];
+    snprintf(dir, sizeof(dir), "/tmp/chatroom-%s", room);
+    rmdir(dir); // tüm FIFO'lar silindiyse boş
+  }
+  if (!ok)
+  {
+    munmap(sh, shared_size);
+    return UNKNOWN;
+  }
+
+  // Toplamlar
+  uint64_t sent = 0, received = 0, truncated = 0, expected = 0, nsamples = 0;
+  for (int i = 0; i < opt.users; i++)
+  {
+    sent += sh->sent[i];
+    received += sh->received[i];
+    truncated += sh->truncated[i];
+    nsamples += sh->nsamples[i];
+  }
+  expected = sent * (opt.users - 1);
+  uint64_t dropped = expected > received + truncated ? expected - received - truncated : 0;
+
+  double *lat = malloc(sizeof(double) * (nsamples ? nsamples : 1));
+  if (lat == NULL)
+  {
+    munmap(sh, shared_size);
+    return UNKNOWN;
+  }
+  uint64_t k = 0;
+  for (int i = 0; i < opt.users; i++)
+    for (uint64_t j = 0; j < sh->nsamples[i]; j++)
+      lat[k++] = sh->samples[i * sh->cap + j];
+  qsort(lat, nsamples, sizeof(double), cmp_double);
+
+  double user_ms = timeval_ms(ru1.ru_utime) - timeval_ms(ru0.ru_utime);
+  double sys_ms = timeval_ms(ru1.ru_stime) - timeval_ms(ru0.ru_stime);
+  double cpu_us = received ? (user_ms + sys_ms) * 1000.0 / received : 0;
+
+  printf("chatroom-bench: %s transport, %d users, %.0f msg/s each, %d-byte messages, %.1f s\n",
+         opt.shm ? "shm" : "fifo", opt.users, opt.rate, opt.size, opt.secs);
+  printf("  Sent:       %10llu messages (%.0f msg/s)\n", (unsigned long long)sent,
+         sent / opt.secs);
+  printf("  Delivered:  %10llu / %llu (%.0f msg/s)\n", (unsigned long long)received,
+         (unsigned long long)expected, received / opt.secs);
+  printf("  Dropped:    %10llu   Truncated: %llu\n", (unsigned long long)dropped,
+         (unsigned long long)truncated);
+  if (nsamples > 0)
+    printf("  Latency:    p50 %.1f us  p99 %.1f us  p999 %.1f us  max %.1f us\n",
+           percentile(lat, (int)nsamples, 50), percentile(lat, (int)nsamples, 99),
+           percentile(lat, (int)nsamples, 99.9), lat[nsamples - 1]);
+  printf("  CPU:        %.2f us/message (user %.1f ms, sys %.1f ms)\n", cpu_us, user_ms, sys_ms);
+
+  int ret = (dropped == 0 && truncated == 0) ? SUCCESS : UNKNOWN;
+  if (json_path != NULL)
+  {
+    FILE *f = fopen(json_path, "w");
+    if (f == NULL)
+    {
+      printf("-%s: chatroom-bench: %s: %s\n", sysname, json_path, strerror(errno));
+      ret = UNKNOWN;
+    }
+    else
+    {
+      fprintf(f, "{\n  \"transport\": \"%s\",\n  \"users\": %d,\n", opt.shm ? "shm" : "fifo",
+              opt.users);
+      fprintf(f, "  \"rate\": %.3f,\n  \"size\": %d,\n  \"secs\": %.3f,\n", opt.rate,
+              opt.size, opt.secs);
+      fprintf(f, "  \"sent\": %llu,\n  \"delivered\": %llu,\n  \"expected\": %llu,\n",
+              (unsigned long long)sent, (unsigned long long)received,
+              (unsigned long long)expected);
+      fprintf(f, "  \"dropped\": %llu,\n  \"truncated\": %llu,\n", (unsigned long long)dropped,
+              (unsigned long long)truncated);
+      if (nsamples > 0)
+      {
+        fprintf(f, "  \"p50_us\": %.3f,\n  \"p99_us\": %.3f,\n",
+                percentile(lat, (int)nsamples, 50), percentile(lat, (int)nsamples, 99));
+        fprintf(f, "  \"p999_us\": %.3f,\n  \"max_us\": %.3f,\n",
+                percentile(lat, (int)nsamples, 99.9), lat[nsamples - 1]);
+      }
+      fprintf(f, "  \"cpu_us_per_msg\": %.3f\n}\n", cpu_us);
+      fclose(f);
+    }
+  }
+
+  free(lat);
+  munmap(sh, shared_size);
+  return ret;
+}
+
+// Builtin komutları çalıştırır (child içinde veya normalde çağrılabilir)
+// Başarılıysa SUCCESS, değilse UNKNOWN döner
+int run_builtin_child(struct command_t *command)
+{
+  // Güvenlik: command veya name yoksa builtin yok
+  if (command == NULL || command->name == NULL)
+  {
+    return UNKNOWN; // tanımsız
+  }
+
+  // help builtin: komut listesini basar
+  if (strcmp(command->name, "help") == 0)
+  {
+    printf("Shell-ish builtins:\n");                            // başlık
+    printf("  cd <dir>\n");                                     // cd
+    printf("  jobs [-l] | wait [%%N] | fg [%%N] | bg [%%N]\n");      // job control
+    printf("  hash [-r] [cmd...]\n");                           // hash
+    printf("  spawnmode [fork|spawn]\n");                       // spawnmode
+    printf("  trace [on [file] | off]\n");                      // trace
+    printf("  history [N]   (up/down arrows, Ctrl-R search)\n");  // history
+    printf("  exit\n");                                         // exit
+    printf("  cut -d X -f list [-j N]  (or --delimiter/--fields/--threads)\n"); // cut
+    printf("  cat [file...] | tee [-a] [file...]\n");           // cat, tee
+    printf("  chatroom [--shm] [--log] [--replay N | --since T] <room> <user>\n"); // chatroom
+    printf("  chatroom-bench [--shm] [-u N] [-r rate] [-d secs] [-s bytes] [--export-json F]\n"); // chatroom yük testi
+    printf("  repeat [--bench ...] N <cmd> [args...]\n");        // repeat
+    printf("  parallel [-j N] [-k] <cmd> [args...]  ({} = input line)\n"); // parallel
+    printf("  help\n");                                         // help
+    printf("  <word>?   (list completions; Tab completes in place)\n"); // tamamlama
+    return SUCCESS;                                             // başarılı
+  }
+
+  // cut builtin: asıl cut fonksiyonunu çağır
+  if (strcmp(command->name, "cut") == 0)
+  {
+    return run_cut_builtin(command); // cut'ı çalıştır
+  }
+
+  // cat/tee builtin: splice/copy_file_range/tee(2) ile kopyasız taşıma
+  if (strcmp(command->name, "cat") == 0)
+  {
+    return run_cat_builtin(command);
+  }
+  if (strcmp(command->name, "tee") == 0)
+  {
+    return run_tee_builtin(command);
+  }
+
+  // history builtin: kalıcı geçmişi listeler
+  if (strcmp(command->name, "history") == 0)
+  {
+    return run_history_builtin(command);
+  }
+
+  // repeat builtin: komutu N kez çalıştır
+  if (strcmp(command->name, "repeat") == 0)
+  {
+    return run_repeat_builtin(command); // repeat'i çalıştır
+  }
+
+  // parallel builtin: stdin satırları için komutu N paralel çalıştır
+  if (strcmp(command->name, "parallel") == 0)
+  {
+    return run_parallel_builtin(command);
+  }
+
+  // chatroom builtin daha sonra eklenecek
+  return UNKNOWN; // bu isimde builtin yok
+}
+
+// repeat builtin: "repeat N cmd args..." komutunu N kez çalıştırır
+
+/*
+ * Builtin'i fork edilmiş bir child'da, kendi process group'unda bir job
+ * olarak çalıştırır (etkileşimli modda tek başına cat/tee). Shell SIGINT ve
+ * SIGTSTP'yi yok saydığı için shell içinde çalışan "cat" veya "tee log"
+ * Ctrl-C ile kesilemez, Ctrl-Z ile durdurulamazdı. Child'da sinyaller
+ * varsayılana döner ve foreground'da terminal onundur; fg/bg/jobs dış
+ * komutlardaki gibi çalışır. last_status'u job_wait ayarlar.
+ */
+int run_job_builtin(struct command_t *command, int (*fn)(struct command_t *))
+{
+  sigset_t old_mask;
+  jobs_block(&old_mask);
+  struct job *job = job_new(command, 1);
+  if (job == NULL)
+  {
+    jobs_unblock(&old_mask);
+    printf("-%s: too many jobs\n", sysname);
+    last_status = 1;
+    return SUCCESS;
+  }
+
+  fflush(stdout); // child'a yarım stdio buffer'ı kopyalanmasın
+  pid_t pid = fork();
+  if (pid < 0)
+  {
+    job_free(job);
+    jobs_unblock(&old_mask);
+    printf("-%s: %s: %s\n", sysname, command->name, strerror(errno));
+    last_status = 1;
+    return SUCCESS;
+  }
+  if (pid == 0)
+  {
+    setpgid(0, 0); // kendi grubu
+    if (!command->background)
+      tcsetpgrp(STDIN_FILENO, getpid());
+    reset_child_signals(); // shell'in ignore/bloklarını geri al
+    apply_redirects_in_child(command->redirects);
+    int r = fn(command);
+    fflush(stdout);
+    exit(r == SUCCESS ? 0 : 1);
+  }
+  setpgid(pid, pid); // child'la yarış: hangisi önce çalışırsa
+  job_add_proc(job, 0, pid);
+
+  if (command->background)
+  {
+    printf("[%d] %d\n", job->id, (int)pid);
+    jobs_unblock(&old_mask);
+    last_status = 0;
+    return SUCCESS;
+  }
+  job_wait(job, &old_mask, true);
+  jobs_unblock(&old_mask);
+  return SUCCESS;
+}
+
+int process_command(struct command_t *command)
+{
+  int r;
+  if (strcmp(command->name, "") == 0)
+    return SUCCESS;
+
+  // "kelime ?": tamamlama adaylarını listele (Tab'ın satır içi karşılığı).
+  // Sadece etkileşimli modda; script ve -c'de '?' sıradan bir argümandır
+  if (command->auto_complete && job_control)
+    return builtin_status(run_complete_builtin(command));
+
+  if (strcmp(command->name, "exit") == 0)
+  {
+    // exit N: shell N koduyla çıksın (verilmezse son komutun durumu)
+    if (command->args[1] != NULL)
+      last_status = atoi(command->args[1]);
+    return EXIT;
+  }
+
+  if (strcmp(command->name, "cd") == 0)
+  {
+    if (command->arg_count > 0)
+    {
+      r = chdir(command->args[1]);
+      if (r == -1)
+        printf("-%s: %s: %s\n", sysname, command->name, strerror(errno));
+      else
+        plan_cache_invalidate(); // göreli yollar artık başka yeri gösterir
+      last_status = (r == -1) ? 1 : 0;
+      return SUCCESS;
+    }
+  }
+  // Eğer komut zinciri varsa (| kullanılmışsa), pipeline olarak çalıştır
+  // (builtin ile başlasa bile: ör. "cut -f 1 | cut -f 2")
+  if (command->next != NULL)
+  {
+    return execute_pipeline(command); // pipe zincirini çalıştırıp çık
+  }
+
+  // Job builtin'leri: shell'in job tablosunu kullanır
+  if (strcmp(command->name, "jobs") == 0)
+    return builtin_status(run_redirected_builtin(command, run_jobs_builtin));
+  if (strcmp(command->name, "wait") == 0)
+    return run_wait_builtin(command); // last_status'u kendisi ayarlar
+  if (strcmp(command->name, "fg") == 0)
+    return run_fg_bg_builtin(command, true);
+  if (strcmp(command->name, "bg") == 0)
+    return builtin_status(run_fg_bg_builtin(command, false));
+
+  // hash builtin: shell'in kendi tablosunu değiştirdiği için child'da çalışamaz
+  if (strcmp(command->name, "hash") == 0)
+  {
+    return builtin_status(run_hash_builtin(command)); // hash'i çalıştır
+  }
+
+  // history builtin: geçmişi listele (ör: "history 20", "history >f")
+  if (strcmp(command->name, "history") == 0)
+  {
+    return builtin_status(run_redirected_builtin(command, run_history_builtin));
+  }
+
+  // trace builtin: faz izlemeyi aç/kapat (shell'in kendi durumu)
+  if (strcmp(command->name, "trace") == 0)
+  {
+    return builtin_status(run_trace_builtin(command));
+  }
+
+  // spawnmode builtin: fork ile posix_spawn arasında geçiş (karşılaştırma için)
+  if (strcmp(command->name, "spawnmode") == 0)
+  {
+    return builtin_status(run_spawnmode_builtin(command)); // spawnmode'u çalıştır
+  }
+
+  // help builtin: komut listesini bas (pipe olmadan da çalışsın)
+  if (strcmp(command->name, "help") == 0)
+  {
+    return builtin_status(run_redirected_builtin(command, run_builtin_child)); // help'i çalıştır
+  }
 
-  // Kopya oluşturulamadıysa NULL dön.
-  if (path_copy == NULL)
-    return NULL;
+  // cut builtin: stdin'den (veya <file'dan) okuyup field'ları basar.
+  // Uzun sürebilen builtin'ler (cut, cat, tee, repeat, parallel, chatroom-bench)
+  // etkileşimli modda kendi job'ında çalışır: Ctrl-C / Ctrl-Z onlara gitsin
+  if (strcmp(command->name, "cut") == 0)
+  {
+    if (job_control)
+      return run_job_builtin(command, run_cut_builtin);
+    return builtin_status(run_redirected_builtin(command, run_cut_builtin)); // cut fonksiyonunu çağır
+  }
 
-  // PATH'i ':' karakterine göre parçala.
-  // İlk klasörü al.
-  char *dir = strtok(path_copy, ":");
+  // cat/tee builtin: shell içinde, redirect'ler uygulanmış fd'ler arasında
+  if (strcmp(command->name, "cat") == 0)
+  {
+    if (job_control)
+      return run_job_builtin(command, run_cat_builtin);
+    return builtin_status(run_redirected_builtin(command, run_cat_builtin));
+  }
+  if (strcmp(command->name, "tee") == 0)
+  {
+    if (job_control)
+      return run_job_builtin(command, run_tee_builtin);
+    return builtin_status(run_redirected_builtin(command, run_tee_builtin));
+  }
 
-  // Tüm PATH klasörlerinde sırayla dolaş.
-  while (dir != NULL)
+  // repeat builtin: komutu N kez çalıştır
+  if (strcmp(command->name, "repeat") == 0)
   {
-    // Oluşturacağımız tam path için gerekli uzunluğu hesapla.
-    // +2 sebebi:
-    // 1 karakter '/' için
-    // 1 karakter '\0' string sonu için
-    size_t full_len = strlen(dir) + strlen(cmd) + 2;
+    if (job_control)
+      return run_job_builtin(command, run_repeat_builtin);
+    return builtin_status(run_redirected_builtin(command, run_repeat_builtin)); // repeat'i çalıştır
+  }
 
-    // Tam path string'i için bellek ayır.
-    char *full_path = (char *)malloc(full_len);
+  // parallel builtin: stdin'den (veya <file'dan) gelen satırlar için
+  if (strcmp(command->name, "parallel") == 0)
+  {
+    if (job_control)
+      return run_job_builtin(command, run_parallel_builtin);
+    return builtin_status(run_redirected_builtin(command, run_parallel_builtin));
+  }
 
-    // Bellek ayrılamadıysa önce path_copy'yi temizle, sonra çık.
-    if (full_path == NULL)
-    {
-      free(path_copy);
-      return NULL;
-    }
+  // chatroom-bench builtin: chatroom yük testi
+  if (strcmp(command->name, "chatroom-bench") == 0)
+  {
+    if (job_control)
+      return run_job_builtin(command, run_chatroom_bench);
+    return builtin_status(run_redirected_builtin(command, run_chatroom_bench));
+  }
 
-    // "klasör/komut" şeklinde tam path oluştur.
-    // Örnek:
-    // dir = /usr/bin
-    // cmd = ls
-    // sonuç = /usr/bin/ls
-    snprintf(full_path, full_len, "%s/%s", dir, cmd);
+  // chatroom builtin: oda chatine girer
+  if (strcmp(command->name, "chatroom") == 0)
+  {
+    return builtin_status(run_chatroom_builtin(command)); // chatroom'u çalıştır
+  }
 
-    // Oluşturulan dosya gerçekten çalıştırılabilir mi kontrol et.
-    if (access(full_path, X_OK) == 0)
-    {
-      // PATH kopyasına artık ihtiyaç yok, temizle.
-      free(path_copy);
+  // Komutun yolunu fork'tan ÖNCE parent'ta çöz: böylece hash tablosu
+  // shell'in kendi belleğinde dolar (child'da dolsa exec ile kaybolurdu).
+  // Örnek:
+  // "ls"   -> "/usr/bin/ls"
+  // "date" -> "/usr/bin/date"
+  // "./a.out" -> "./a.out" (eğer çalıştırılabilirse)
+  // Plan cache'inden gelen komutun yolu zaten çözülmüştür (bkz. plan_compile).
+  char *resolved_path = command->path != NULL ? strdup(command->path)
+                                              : resolve_executable_path(command->name);
+
+  // Eğer komut PATH içinde veya verilen path'te bulunamadıysa,
+  // kullanıcıya "command not found" mesajı ver, child oluşturmaya gerek yok.
+  if (resolved_path == NULL)
+  {
+    printf("-%s: %s: command not found\n", sysname, command->name);
+    last_status = 127;
+    return SUCCESS;
+  }
 
-      // Bulduğumuz tam yolu döndür.
-      return full_path;
-    }
+  /// This shows how to do exec with environ (but is not available on MacOs)
+  // extern char** environ; // environment variables
+  // execvpe(command->name, command->args, environ); // exec+args+path+environ
 
-    // Bu klasörde bulunamadıysa bu path'i temizle.
-    free(full_path);
+  // Job kaydı: SIGCHLD bloklu iken başlat ve kaydet (handler pid'i kaçırmasın)
+  sigset_t old_mask;
+  jobs_block(&old_mask);
+  struct job *job = job_new(command, 1);
+  if (job == NULL)
+  {
+    jobs_unblock(&old_mask);
+    free(resolved_path);
+    printf("-%s: too many jobs\n", sysname);
+    last_status = 1;
+    return SUCCESS;
+  }
 
-    // PATH içindeki bir sonraki klasöre geç.
-    dir = strtok(NULL, ":");
+  // Komutu spawn motoruyla başlat (redirects[0..2] child'da uygulanır).
+  // Etkileşimli modda kendi process group'unda, foreground ise terminalin sahibi.
+  // Örnek:
+  // spawn_command("/usr/bin/ls", ["ls", "-l", NULL], ...);
+  pid_t pid;
+  int err = spawn_command(resolved_path, command->args, -1, -1, -1,
+                          command->redirects, job_control ? 0 : -1,
+                          job_control && !command->background, &pid);
+  free(resolved_path); // parent'ın kopyasına artık gerek yok
+  if (err != 0)
+  {
+    job_free(job);
+    jobs_unblock(&old_mask);
+    printf("-%s: %s: %s\n", sysname, command->name, strerror(err));
+    last_status = 127;
+    return SUCCESS;
   }
+  job_add_proc(job, 0, pid);
 
-  // Hiçbir klasörde bulunamadıysa PATH kopyasını temizle.
-  free(path_copy);
+  // Eğer komut background olarak çalıştırılacaksa parent beklemez.
+  // Bittiğinde SIGCHLD handler'ı toplar (zombie kalmaz).
+  if (command->background)
+  {
+    if (job_control)
+      printf("[%d] %d\n", job->id, (int)pid);
+    jobs_unblock(&old_mask);
+    last_status = 0;
+    return SUCCESS;
+  }
 
-  // Komut bulunamadı.
-  return NULL;
+  // Foreground komutlarda parent, child process'in bitmesini (veya
+  // Ctrl-Z ile durmasını) bekler; çıkış kodu last_status'a yazılır.
+  job_wait(job, &old_mask, true);
+  jobs_unblock(&old_mask);
+  return SUCCESS;
 }
 
-// Builtin kontrol fonksiyonu (cut/help/chatroom gibi komutlar builtin mi?)
-bool is_builtin_child(const char *name);
-
-// Builtin komut çalıştırma fonksiyonu (child içinde çağrılacak)
-int run_builtin_child(struct command_t *command);
+/*
+ * ===== Etkileşimsiz (batch) mod =====
+ * shellish -c "cmd", shellish script.sh veya stdin bir terminal değilse
+ * prompt() hiç kullanılmaz: termios/echo yok, karakter karakter getchar() yok.
+ * Girdi büyük bloklar halinde read() ile okunur ve satırlar doğrudan
+ * parse_command()/process_command()'a verilir.
+ */
+#define BATCH_BLOCK_SIZE 65536 // tek read() ile okunacak blok boyutu
 
-// PIPELINE çalıştırır: cmd1 | cmd2 | cmd3 ... (command->next zinciri)
-// Her komut için child process oluşturur ve pipe ile birbirine bağlar.
-int execute_pipeline(struct command_t *cmd)
+struct batch_reader
 {
-  int in_fd = STDIN_FILENO; // İlk komutun input'u normal stdin (fd=0)
-  int pipefd[2];            // pipefd[0]=read end, pipefd[1]=write end
-  pid_t pid;                // fork sonucu child pid
-  int status = 0;           // wait için status
-
-  struct command_t *current = cmd; // Zincirde gezen pointer
+  int fd;        // okunacak fd (-1: sadece bellekteki buffer, -c için)
+  char *buf;     // blok buffer'ı
+  size_t cap;    // buffer kapasitesi
+  size_t start;  // işlenmemiş verinin başı
+  size_t end;    // buffer'daki verinin sonu
+  bool eof;      // fd sonuna gelindi mi
+  bool seekable; // fd normal dosya mı (lseek ile geri sarılabilir mi)
+};
 
-  while (current != NULL)
-  { // Zincirde komut olduğu sürece dön
-    // Eğer son komut değilse pipe açmamız gerekiyor (çıktı bir sonraki komuta gidecek)
-    if (current->next != NULL)
+// Bir sonraki satırı döndürür ('\n' yerine '\0' konur).
+// Satır uzunluğunu döndürür, girdi bittiyse -1.
+ssize_t batch_next_line(struct batch_reader *br, char **line)
+{
+  while (1)
+  {
+    // Buffer'da tam bir satır var mı?
+    char *nl = memchr(br->buf + br->start, '\n', br->end - br->start);
+    if (nl != NULL)
     {
-      if (pipe(pipefd) < 0)
-      {                 // pipe oluştur (başarısızsa hata)
-        perror("pipe"); // sistem hata mesajı bas
-        return UNKNOWN; // hata kodu dön
-      }
+      *nl = '\0';                             // satırı sonlandır
+      *line = br->buf + br->start;            // satır başı
+      size_t len = nl - (br->buf + br->start); // uzunluk
+      br->start += len + 1;                   // '\n'i de tüket
+      return (ssize_t)len;
     }
-    else
+
+    if (br->eof)
     {
-      // Son komutta pipe yok: işaret amaçlı -1
-      pipefd[0] = -1;
-      pipefd[1] = -1;
+      // Son satır '\n' ile bitmemiş olabilir
+      if (br->start == br->end)
+        return -1; // girdi bitti
+      if (br->end == br->cap)
+      { // '\0' için yer aç
+        char *nbuf = realloc(br->buf, br->cap + 1);
+        if (nbuf == NULL)
+          return -1;
+        br->buf = nbuf;
+        br->cap++;
+      }
+      br->buf[br->end] = '\0';
+      *line = br->buf + br->start;
+      size_t len = br->end - br->start;
+      br->start = br->end;
+      return (ssize_t)len;
     }
 
-    pid = fork(); // Yeni child process oluştur
-    if (pid < 0)
-    {                 // fork başarısızsa
-      perror("fork"); // hata yaz
-      return UNKNOWN; // hata dön
+    // Yarım satırı buffer başına kaydır, gerekirse buffer'ı büyüt
+    if (br->start > 0)
+    {
+      memmove(br->buf, br->buf + br->start, br->end - br->start);
+      br->end -= br->start;
+      br->start = 0;
     }
-
-    if (pid == 0)
+    if (br->end == br->cap)
     {
-      // =========================
-      // CHILD PROCESS
-      // =========================
-
-      // Eğer önceki komuttan gelen bir input fd varsa, stdin'e bağla
-      if (in_fd != STDIN_FILENO)
-      {                            // stdin değilse (yani pipe read end)
-        dup2(in_fd, STDIN_FILENO); // stdin(0) artık in_fd olsun
-        close(in_fd);              // eski fd'yi kapat
-      }
-
-      // Eğer son komut değilsek, stdout'u pipe'ın write end'ine bağla
-      if (current->next != NULL)
-      {                                 // bir sonraki komut varsa
-        close(pipefd[0]);               // child read end'i kullanmayacak, kapat
-        dup2(pipefd[1], STDOUT_FILENO); // stdout(1) -> pipe write
-        close(pipefd[1]);               // write end artık dup edildi, kapat
-      }
+      char *nbuf = realloc(br->buf, br->cap * 2); // çok uzun satır
+      if (nbuf == NULL)
+        return -1;
+      br->buf = nbuf;
+      br->cap *= 2;
+    }
 
-      // Burada istersek redirection (<,>,>>) ile pipe'ı birlikte destekleyebiliriz.
-      // Şimdilik sadece pipe mantığını çalıştırıyoruz.
+    ssize_t n = read(br->fd, br->buf + br->end, br->cap - br->end); // büyük blok oku
+    if (n < 0 && errno == EINTR)
+      continue; // sinyal geldi, tekrar dene
+    if (n <= 0)
+      br->eof = true; // EOF veya hata
+    else
+      br->end += n;
+  }
+}
 
-      // Eğer komut builtin ise (cut/help/chatroom), execv yerine builtin çalıştır
-      if (is_builtin_child(current->name))
-      {                                      // builtin mi kontrol et
-        int br = run_builtin_child(current); // builtin'i çalıştır
-        exit(br == SUCCESS ? 0 : 1);         // başarılıysa 0, değilse 1 ile çık
-      }
+// Okuyucunun fd konumunu tüketilen satırın sonuna geri sarar.
+// Böylece stdin'den okuyan komutlar (ör: wc) script'in kalanını görür.
+// Sadece normal dosyalarda mümkün; pipe'ta okunan blok geri verilemez.
+void batch_sync_offset(struct batch_reader *br)
+{
+  if (!br->seekable || br->start == br->end)
+    return;
+  lseek(br->fd, -(off_t)(br->end - br->start), SEEK_CUR); // okunmamış kısmı geri ver
+  br->start = br->end = 0;                                // buffer'ı boşalt
+  br->eof = false;
+}
 
-      // Komutun gerçek çalıştırılabilir yolunu PATH içinde bul
-      char *resolved_path = resolve_executable_path(current->name);
-      if (resolved_path == NULL)
-      { // bulunamadıysa
-        printf("-%s: %s: command not found\n", sysname, current->name);
-        exit(127); // child'ı hata koduyla bitir
-      }
+// process_command'ı çalıştırır; trace açıksa tüm komutu bir span olarak
+// yazar (read/parse sonrası, prompt öncesi her şey bunun içindedir)
+int run_traced_command(struct command_t *command)
+{
+  int64_t t0 = trace_begin();
+  int code = process_command(command);
+  if (t0 != 0)
+  {
+    char *line = job_cmdline(command);
+    trace_span("command", t0, 0, "line", line, NULL);
+    free(line);
+  }
+  return code;
+}
 
-      // Komutu çalıştır (başarılıysa bu satırın altına hiç gelmez)
-      execv(resolved_path, current->args);
+/*
+ * ===== Komut sıralama ve plan cache'i =====
+ * Bir satır ';', '&&', '||' ve '&' ile ayrılmış adımlardan oluşabilir:
+ *   a ; b    a bitince b
+ *   a && b   a başarılıysa (durum 0) b
+ *   a || b   a başarısızsa b
+ *   a & b    a arka planda, b hemen
+ * Bağlaçlar soldan sağa değerlendirilir (bash gibi): atlanan adım last_status'u
+ * değiştirmez, yani "false && a || b" b'yi çalıştırır. Tırnak içindekiler
+ * bağlaç sayılmaz.
+ *
+ * Satır önce bir plana derlenir: adımlar, her adımın parse edilmiş pipeline'ı
+ * (redirect hedefleri dahil) ve dış komutların önceden çözülmüş yolları
+ * (command_t.path). Redirect dosyaları her çalıştırmada yeniden açılır
+ * (">f" her seferinde truncate etmeli). Planlar ham satırla anahtarlanan bir
+ * LRU cache'te tutulur: döngülerde ve script'lerde tekrar eden bir satır
+ * lexer'a ve PATH aramasına hiç girmez. Her plan kendi küçük arenasındadır.
+ * PATH değişince, başarılı bir cd'den sonra ve "hash -r" ile plan_gen artar;
+ * eski nesilden bir plan ilk kullanımında yeniden derlenir.
+ */
+#define PLAN_CACHE_SIZE 64    // cache'teki en fazla plan (LRU)
+#define PLAN_HASH_SIZE 128    // bucket sayısı (2'nin kuvveti olmalı)
+#define PLAN_ARENA_BLOCK 1024 // plan arenasının blok boyutu
+#define PLAN_MAX_LINE 4096    // daha uzun satırlar cache'lenmez
 
-      // Eğer buraya geldiysek execv başarısız olmuştur
-      printf("-%s: %s: %s\n", sysname, current->name, strerror(errno));
-      free(resolved_path); // ayrılan path'i temizle
-      exit(127);           // child'ı bitir
-    }
+enum plan_ops
+{
+  PLAN_SEQ = 0, // ilk adım, ';' veya '&' sonrası: her zaman çalışır
+  PLAN_AND = 1, // '&&' sonrası: önceki durum 0 ise
+  PLAN_OR = 2,  // '||' sonrası: önceki durum 0 değilse
+};
 
-    // =========================
-    // PARENT PROCESS
-    // =========================
+struct plan_step
+{
+  int op;                // önceki adımla bağlacı
+  struct command_t *cmd; // adımın pipeline'ı
+};
 
-    // Parent artık eski in_fd'yi tutmasın (zincir ilerledi)
-    if (in_fd != STDIN_FILENO)
-    {
-      close(in_fd); // önceki pipe read end kapanır
-    }
+struct plan
+{
+  char *key;                // ham satır
+  size_t key_len;           // key uzunluğu
+  uint64_t hash;            // key'in FNV-1a özeti
+  unsigned gen;             // derlendiği plan_gen
+  int nsteps;               // adım sayısı
+  struct plan_step *steps;  // adımlar (satırdaki sırayla)
+  struct arena arena;       // key, adımlar ve parse sonuçları
+  struct plan *hnext;       // aynı bucket'taki sonraki plan
+  struct plan *prev, *next; // LRU listesi (baş: en son kullanılan)
+};
 
-    // Eğer son komut değilsek:
-    // - parent write end'i kapatır
-    // - next komut için in_fd = pipe read end olur
-    if (current->next != NULL)
-    {
-      close(pipefd[1]);  // parent write end'i kapatır
-      in_fd = pipefd[0]; // next komut stdin'i buradan okuyacak
-    }
+static unsigned plan_gen = 0;                   // cwd/PATH/hash değişince artar
+static struct plan *plan_hash[PLAN_HASH_SIZE];  // bucket dizisi
+static struct plan *plan_lru_head = NULL;       // en son kullanılan
+static struct plan *plan_lru_tail = NULL;       // ilk atılacak
+static int plan_count = 0;                      // cache'teki plan sayısı
+static char *plan_path_env = NULL;              // planların derlendiği PATH
 
-    current = current->next; // zincirde bir sonraki komuta geç
-  }
+// Cache'teki tüm planları eskitir (cd, PATH değişimi, hash -r)
+void plan_cache_invalidate(void)
+{
+  plan_gen++;
+}
 
-  // Parent: tüm child process'lerin bitmesini bekle
-  while (wait(&status) > 0)
+// FNV-1a (64 bit) ile satırın özeti
+static uint64_t plan_hash_key(const char *s, size_t len)
+{
+  uint64_t h = 14695981039346656037ull; // FNV offset basis
+  for (size_t i = 0; i < len; i++)
   {
-    // burada sadece bekliyoruz
+    h ^= (unsigned char)s[i];
+    h *= 1099511628211ull; // FNV prime
   }
-
-  return SUCCESS; // pipeline başarıyla tamamlandı
+  return h;
 }
 
-// Builtin mi? (cut/chatroom/custom burada sayılacak)
-bool is_builtin_child(const char *name)
+static void plan_lru_unlink(struct plan *pl)
 {
-  if (!name)
-    return false;
-  return (strcmp(name, "cut") == 0) ||
-         (strcmp(name, "help") == 0) ||
-         (strcmp(name, "repeat") == 0) ||
-         (strcmp(name, "chatroom") == 0); // chatroom'u sonra yazacağız
+  if (pl->prev != NULL)
+    pl->prev->next = pl->next;
+  else
+    plan_lru_head = pl->next;
+  if (pl->next != NULL)
+    pl->next->prev = pl->prev;
+  else
+    plan_lru_tail = pl->prev;
+  pl->prev = pl->next = NULL;
 }
 
-// Builtin komutu çalıştırır (child içinde çağrılacak şekilde tasarlanır)
-// Başarılıysa SUCCESS, değilse UNKNOWN döner.
-int run_builtin_child(struct command_t *command);
+static void plan_lru_push(struct plan *pl)
+{
+  pl->prev = NULL;
+  pl->next = plan_lru_head;
+  if (plan_lru_head != NULL)
+    plan_lru_head->prev = pl;
+  plan_lru_head = pl;
+  if (plan_lru_tail == NULL)
+    plan_lru_tail = pl;
+}
 
-// "1,3,10" gibi alan listesini int dizisine çevirir
-// count: kaç tane alan çıktığını döndürür
-// Not: dönen dizi malloc/realloc ile ayrılır, sonunda free edilmelidir
-int *parse_fields_list(const char *s, int *count)
+// Planı cache'ten çıkarır ve serbest bırakır
+static void plan_remove(struct plan *pl)
 {
-  *count = 0; // başlangıçta 0 alan
+  struct plan **pp = &plan_hash[pl->hash & (PLAN_HASH_SIZE - 1)];
+  while (*pp != pl)
+    pp = &(*pp)->hnext;
+  *pp = pl->hnext;
+  plan_lru_unlink(pl);
+  plan_count--;
+  arena_free(&pl->arena);
+  free(pl);
+}
 
-  if (s == NULL)
-    return NULL; // liste yoksa NULL
+static int plan_name_cmp(const void *key, const void *elem)
+{
+  return strcmp(key, *(const char *const *)elem);
+}
 
-  char *copy = strdup(s); // strtok bozacağı için kopya al
-  if (copy == NULL)
-    return NULL; // kopya alınamazsa NULL
+// Shell'in kendi komutu mu (builtin_names sıralı)
+static bool is_shell_builtin(const char *name)
+{
+  return bsearch(name, builtin_names, sizeof(builtin_names) / sizeof(builtin_names[0]),
+                 sizeof(builtin_names[0]), plan_name_cmp) != NULL;
+}
 
-  int *arr = NULL;               // dinamik alan dizisi
-  char *tok = strtok(copy, ","); // virgüle göre böl
+// Bir adımı parse edip plana ekler ve dış komutların yolunu çözer.
+// Adım boşsa eklemez, 1 döner.
+static int plan_add_step(struct plan *pl, struct arena *a, char *seg, int op, bool background)
+{
+  struct command_t *cmd = arena_calloc(a, sizeof(struct command_t));
+  parse_command_in(a, seg, cmd);
+  if (cmd->name[0] == '\0' && cmd->next == NULL)
+    return 1;
 
-  while (tok != NULL)
-  {                    // token oldukça devam et
-    int v = atoi(tok); // token'ı sayıya çevir
-    if (v > 0)
-    {                                                 // sadece 1+ değerleri kabul et
-      arr = realloc(arr, sizeof(int) * (*count + 1)); // diziyi büyüt
-      arr[*count] = v;                                // yeni alanı ekle
-      (*count)++;                                     // sayacı artır
+  for (struct command_t *c = cmd; c != NULL; c = c->next)
+  {
+    if (background)
+      c->background = true; // "a | b & c": a ve b arka planda
+    if (c->name[0] == '\0' || c->auto_complete || is_shell_builtin(c->name))
+      continue;
+    // Bulunamayan komut çalışırken yine aranır (hata mesajı orada basılır)
+    char *path = resolve_executable_path(c->name);
+    if (path != NULL)
+    {
+      c->path = arena_strndup(a, path, strlen(path));
+      free(path);
     }
-    tok = strtok(NULL, ","); // sıradaki token
   }
-
-  free(copy); // kopyayı temizle
-  return arr; // alan dizisini döndür
+  pl->steps[pl->nsteps].op = op;
+  pl->steps[pl->nsteps].cmd = cmd;
+  pl->nsteps++;
+  return 0;
 }
 
-// cut builtin: stdin'den satır okur, delimiter'a göre böler, seçilen alanları basar
-int run_cut_builtin(struct command_t *command)
+// Satırı, her şeyi a'dan alarak pl'ye derler.
+// Sözdizimi hatasında mesajı basar ve -1 döner.
+static int plan_compile(struct plan *pl, struct arena *a, const char *line, size_t len)
 {
-  char delim = '\t';             // varsayılan delimiter TAB
-  const char *fields_str = NULL; // -f/--fields ile gelecek liste
-
-  // Argümanları tara: -d/--delimiter ve -f/--fields
-  for (int i = 1; command->args[i] != NULL; i++)
-  { // args[0]=cut
-    // delimiter seçeneği
-    if ((strcmp(command->args[i], "-d") == 0 || strcmp(command->args[i], "--delimiter") == 0) &&
-        command->args[i + 1] != NULL)
+  pl->key = arena_strndup(a, line, len);
+  pl->key_len = len;
+  char *text = arena_strndup(a, line, len); // adımlar bu kopyada yerinde ayrılır
+
+  int max_steps = 1; // her bağlaç en fazla bir adım ekler
+  for (size_t i = 0; i < len; i++)
+    if (text[i] == ';' || text[i] == '&' || text[i] == '|')
+      max_steps++;
+  pl->steps = arena_alloc(a, sizeof(struct plan_step) * max_steps);
+  pl->nsteps = 0;
+
+  char *seg = text;  // adımın başı
+  int op = PLAN_SEQ; // adımın önündeki bağlaç
+  char quote = 0;    // açık tırnak (' veya ")
+  for (char *p = text;; p++)
+  {
+    char c = *p;
+    if (quote != 0 && c != '\0')
     {
-      delim = command->args[i + 1][0]; // tek karakter al
-      i++;                             // bir sonraki arg tüketildi
+      if (c == quote)
+        quote = 0;
+      continue;
     }
-    // fields seçeneği
-    else if ((strcmp(command->args[i], "-f") == 0 || strcmp(command->args[i], "--fields") == 0) &&
-             command->args[i + 1] != NULL)
+    if (c == '\'' || c == '"')
     {
-      fields_str = command->args[i + 1]; // "1,3,10" gibi liste
-      i++;                               // bir sonraki arg tüketildi
+      quote = c;
+      continue;
     }
-  }
-
-  // -f verilmediyse hata
-  if (fields_str == NULL)
-  {
-    printf("-%s: cut: missing -f/--fields option\n", sysname); // hata mesajı
-    return UNKNOWN;                                            // başarısız
-  }
-
-  // Field listesini parse et
-  int fcount = 0;                                       // kaç field istendi
-  int *fields = parse_fields_list(fields_str, &fcount); // listeyi dizi yap
-  if (fields == NULL || fcount == 0)
-  {
-    printf("-%s: cut: invalid fields list\n", sysname); // hata mesajı
-    free(fields);                                       // temizlik
-    return UNKNOWN;                                     // başarısız
-  }
-
-  char *line = NULL; // getline buffer
-  size_t cap = 0;    // buffer kapasitesi
 
-  // stdin'den satır satır oku
-  while (getline(&line, &cap, stdin) != -1)
-  { // EOF olana kadar
-    // Satır sonundaki \n varsa kaldır
-    size_t len = strlen(line); // uzunluk
-    if (len > 0 && line[len - 1] == '\n')
-    {                       // \n var mı?
-      line[len - 1] = '\0'; // kaldır
+    int next_op = PLAN_SEQ;
+    size_t op_len = 1;
+    if (c == '&' && p[1] == '&')
+    {
+      next_op = PLAN_AND;
+      op_len = 2;
     }
+    else if (c == '|' && p[1] == '|')
+    {
+      next_op = PLAN_OR;
+      op_len = 2;
+    }
+    else if (c != ';' && c != '\0' && (c != '&' || (p > text && p[-1] == '>')))
+      continue; // normal karakter (tek '|' pipeline'dır, ">&" bağlaç değil)
 
-    // strtok bozacağı için satırı kopyala
-    char *copy = strdup(line); // satır kopyası
-    if (copy == NULL)
-      break; // kopya yoksa çık
-
-    // delimiter string'i hazırla (strtok için)
-    char dstr[2] = {delim, '\0'}; // ör: ":" veya "\t"
-
-    // Önce token sayısını bul (kaç alan var?)
-    int tok_count = 0;        // alan sayısı
-    char *tmp = strdup(copy); // saymak için kopya
-    if (tmp == NULL)
+    *p = '\0';
+    bool background = c == '&' && op_len == 1;
+    if (plan_add_step(pl, a, seg, op, background) != 0)
     {
-      free(copy);
-      break;
-    } // kopya yoksa çık
-    char *t = strtok(tmp, dstr); // ilk token
-    while (t != NULL)
-    {
-      tok_count++;
-      t = strtok(NULL, dstr);
-    } // say
-    free(tmp); // sayma kopyasını temizle
-
-    // Token pointer dizisi oluştur
-    char **tokens = NULL; // token dizisi
-    if (tok_count > 0)
-      tokens = malloc(sizeof(char *) * tok_count); // yer ayır
-    int idx = 0;                                   // doldurma indexi
-
-    // Asıl split: tokenları diziye koy
-    t = strtok(copy, dstr); // split başlat
-    while (t != NULL)
-    {                         // token oldukça
-      tokens[idx++] = t;      // pointer'ı sakla
-      t = strtok(NULL, dstr); // sıradaki token
-    }
-
-    // İstenen field'ları sırayla bas (1-based)
-    for (int k = 0; k < fcount; k++)
-    {                       // her istenen field
-      int want = fields[k]; // 1-based alan no
-      const char *out = ""; // default boş
-
-      if (want >= 1 && want <= tok_count)
-      {                         // aralık kontrolü
-        out = tokens[want - 1]; // 1-based -> 0-based
+      // Boş adım: sadece satır sonunda ve ';'/'&' sonrasında (veya boş satırda) geçerli
+      if (c != '\0')
+      {
+        printf("-%s: syntax error near '%.*s'\n", sysname, (int)op_len,
+               pl->key + (p - text));
+        return -1;
+      }
+      if (op != PLAN_SEQ)
+      {
+        printf("-%s: syntax error: unexpected end of line\n", sysname);
+        return -1;
       }
-
-      if (k > 0)
-        putchar(delim);   // araya delimiter koy
-      fputs(out, stdout); // alanı yaz
     }
-
-    putchar('\n'); // satır sonu
-
-    free(tokens); // token dizisini temizle
-    free(copy);   // satır kopyasını temizle
-  }
-
-  free(fields);   // fields dizisini temizle
-  free(line);     // getline buffer temizle
-  return SUCCESS; // başarılı
-}
-
-// repeat builtin: komutu N kez çalıştırır
-int run_repeat_builtin(struct command_t *command)
-{
-  // Kullanım: repeat N cmd args...
-  if (command->args[1] == NULL || command->args[2] == NULL)
-  {
-    printf("-%s: repeat: usage: repeat N <command> [args...]\n", sysname); // kullanım mesajı
-    return UNKNOWN;                                                        // hata
-  }
-
-  int n = atoi(command->args[1]); // N sayısını al
-  if (n <= 0)
-  {
-    printf("-%s: repeat: N must be > 0\n", sysname); // N kontrolü
-    return UNKNOWN;
+    if (c == '\0')
+      break;
+    seg = p + op_len;
+    op = next_op;
+    p += op_len - 1;
   }
+  // Yol çözümü PATH değişimini fark edip plan_gen'i artırmış olabilir;
+  // yollar yeni PATH'e göre çözüldüğü için plan şimdiki nesildendir
+  pl->gen = plan_gen;
+  return 0;
+}
 
-  // Çalıştırılacak komut adı: args[2]
-  const char *cmd = command->args[2];
-
-  // repeat için yeni argv oluştur: [cmd, args3..., NULL]
-  // command->args şu an: [repeat, N, cmd, a1, a2, ..., NULL]
-  char **new_argv = &command->args[2]; // cmd'den itibaren başlat
+// Satırın planını döndürür: cache'te geçerli bir plan varsa o (*hit = true),
+// yoksa derlenip cache'e eklenir. Sözdizimi hatasında NULL. Çok uzun satırlar
+// cache'lenmez: planları line_arena'dan alınır ve *tmp'ye yazılır.
+static struct plan *plan_get(const char *line, struct plan *tmp, bool *hit)
+{
+  size_t len = strlen(line);
+  memset(tmp, 0, sizeof(*tmp));
+  if (len > PLAN_MAX_LINE)
+    return plan_compile(tmp, &line_arena, line, len) == 0 ? tmp : NULL;
 
-  // Komutun path'ini çöz
-  char *resolved_path = resolve_executable_path(cmd); // PATH içinde bul
-  if (resolved_path == NULL)
+  // PATH değiştiyse tüm planlar eskir
+  const char *path_env = getenv("PATH");
+  if (path_env == NULL)
+    path_env = "";
+  if (plan_path_env == NULL || strcmp(plan_path_env, path_env) != 0)
   {
-    printf("-%s: %s: command not found\n", sysname, cmd); // bulunamadı
-    return UNKNOWN;
+    free(plan_path_env);
+    plan_path_env = strdup(path_env);
+    plan_cache_invalidate();
   }
 
-  // N kez çalıştır
-  for (int i = 0; i < n; i++)
+  uint64_t h = plan_hash_key(line, len);
+  for (struct plan *pl = plan_hash[h & (PLAN_HASH_SIZE - 1)]; pl != NULL; pl = pl->hnext)
   {
-    pid_t pid = fork(); // child oluştur
-    if (pid == 0)
+    if (pl->hash != h || pl->key_len != len || memcmp(pl->key, line, len) != 0)
+      continue;
+    if (pl->gen == plan_gen)
     {
-      execv(resolved_path, new_argv);                         // komutu çalıştır
-      printf("-%s: %s: %s\n", sysname, cmd, strerror(errno)); // execv hata
-      exit(127);
+      plan_lru_unlink(pl); // en son kullanılan başa
+      plan_lru_push(pl);
+      *hit = true;
+      return pl;
     }
-    waitpid(pid, NULL, 0); // her turda bitmesini bekle
+    plan_remove(pl); // eski nesil: yeniden derlenecek
+    break;
   }
 
-  free(resolved_path); // path'i temizle
-  return SUCCESS;      // başarılı
+  struct plan *pl = calloc(1, sizeof(struct plan));
+  if (pl == NULL) // cache'siz devam et
+    return plan_compile(tmp, &line_arena, line, len) == 0 ? tmp : NULL;
+  pl->arena.block_size = PLAN_ARENA_BLOCK;
+  if (plan_compile(pl, &pl->arena, line, len) != 0)
+  {
+    arena_free(&pl->arena);
+    free(pl);
+    return NULL;
+  }
+  pl->hash = h;
+
+  if (plan_count == PLAN_CACHE_SIZE)
+    plan_remove(plan_lru_tail); // en uzun süredir kullanılmayanı at
+  struct plan **bucket = &plan_hash[h & (PLAN_HASH_SIZE - 1)];
+  pl->hnext = *bucket;
+  *bucket = pl;
+  plan_lru_push(pl);
+  plan_count++;
+  return pl;
 }
 
-// chatroom builtin: FIFO tabanlı basit chat
-int run_chatroom_builtin(struct command_t *command)
+// Planın adımlarını bağlaçlarına göre çalıştırır. EXIT dönerse shell çıkmalı.
+static int plan_run(struct plan *pl)
 {
-  // Kullanım kontrolü: chatroom <roomname> <username>
-  if (command->args[1] == NULL || command->args[2] == NULL)
+  int code = SUCCESS;
+  for (int i = 0; i < pl->nsteps && code != EXIT; i++)
   {
-    printf("-%s: chatroom: usage: chatroom <roomname> <username>\n", sysname);
-    return UNKNOWN;
+    struct plan_step *st = &pl->steps[i];
+    if ((st->op == PLAN_AND && last_status != 0) || (st->op == PLAN_OR && last_status == 0))
+      continue; // bağlaç bu adımı atlatıyor
+
+    // Önceki adım cd (veya hash -r) yaptıysa kalan yollar çalışırken çözülsün;
+    // plan eskidiği için bir sonraki kullanımda zaten yeniden derlenir
+    if (pl->gen != plan_gen)
+      for (int j = i; j < pl->nsteps; j++)
+        for (struct command_t *c = pl->steps[j].cmd; c != NULL; c = c->next)
+          c->path = NULL;
+    code = run_traced_command(st->cmd);
   }
+  return code;
+}
 
-  const char *room = command->args[1]; // oda adı
-  const char *user = command->args[2]; // kullanıcı adı
+// Tek bir satırı çalıştırır (planı cache'ten alır veya derler).
+// EXIT dönerse shell çıkmalı.
+int run_line(char *line)
+{
+  // Boşlukları atla; '#' ile başlayan satırlar yorumdur (#!/... dahil)
+  char *p = line;
+  while (*p == ' ' || *p == '\t')
+    p++;
+  if (*p == '#' || *p == '\0')
+    return SUCCESS;
 
-  // Oda klasörü yolu: /tmp/chatroom-<room>
-  char room_dir[512];
-  snprintf(room_dir, sizeof(room_dir), "/tmp/chatroom-%s", room);
+  struct plan tmp;
+  bool hit = false;
+  int64_t t_parse = trace_begin();
+  struct plan *pl = plan_get(p, &tmp, &hit);
+  trace_span("parse_command", t_parse, 0, "line", p, "plan", hit ? "hit" : "miss", NULL);
 
-  // Kullanıcının FIFO yolu: /tmp/chatroom-<room>/<username>
-  char my_fifo[512];
-  // my_fifo yolu buffer'a sığdı mı kontrol et
-  int n1 = snprintf(my_fifo, sizeof(my_fifo), "%s/%s", room_dir, user); // yolu yaz
-  if (n1 < 0 || n1 >= (int)sizeof(my_fifo))
-  {                                                    // sığmadıysa
-    printf("-%s: chatroom: path too long\n", sysname); // hata bas
-    return UNKNOWN;                                    // çık
-  }
+  int code = SUCCESS;
+  if (pl != NULL)
+    code = plan_run(pl);
+  else
+    last_status = 2; // sözdizimi hatası (bash gibi)
+  arena_reset(&line_arena); // cache'lenmeyen planı ve parse artıklarını bırak
+  return code;
+}
 
-  // 1) Oda klasörünü oluştur (varsa sorun değil)
-  if (mkdir(room_dir, 0777) == -1)
-  { // klasör oluşturmayı dene
-    if (errno != EEXIST)
-    { // zaten varsa sorun değil
-      printf("-%s: chatroom: mkdir failed: %s\n", sysname, strerror(errno));
-      return UNKNOWN;
-    }
-  }
+// Batch okuyucudaki tüm satırları çalıştırır, son durumu döndürür
+int run_batch(struct batch_reader *br)
+{
+  char *line;
+  int64_t t_read = trace_begin();
+  while (batch_next_line(br, &line) >= 0)
+  {
+    trace_span("read", t_read, 0, NULL);
+    // stdin script'in kendisiyse komutlar kalan kısmı okuyabilsin
+    if (br->fd == STDIN_FILENO)
+      batch_sync_offset(br);
 
-  // 2) Kullanıcı FIFO'sunu oluştur (varsa sorun değil)
-  if (mkfifo(my_fifo, 0666) == -1)
-  { // fifo oluşturmayı dene
-    if (errno != EEXIST)
-    { // zaten varsa sorun değil
-      printf("-%s: chatroom: mkfifo failed: %s\n", sysname, strerror(errno));
-      return UNKNOWN;
-    }
+    jobs_notify(false); // biten arka plan job'larının slotlarını boşalt
+    if (run_line(line) == EXIT)
+      break;
+    t_read = trace_begin();
   }
+  fflush(stdout);
+  free(br->buf);
+  return last_status;
+}
 
-  // 3) Reader child: kendi FIFO'muzdan gelen mesajları okuyup ekrana basacak
-  pid_t reader_pid = fork(); // okuyucu process
-  if (reader_pid < 0)
-  {
-    printf("-%s: chatroom: fork failed: %s\n", sysname, strerror(errno));
-    return UNKNOWN;
-  }
+// fd'den okuyan batch modunu başlatır (script dosyası veya pipe'lı stdin)
+int run_batch_fd(int fd)
+{
+  struct batch_reader br = {0};
+  br.fd = fd;
+  br.cap = BATCH_BLOCK_SIZE;
+  br.buf = malloc(br.cap);
+  if (br.buf == NULL)
+    return 1;
+
+  struct stat st;
+  br.seekable = fstat(fd, &st) == 0 && S_ISREG(st.st_mode); // normal dosya mı
+  return run_batch(&br);
+}
 
-  if (reader_pid == 0)
-  {
-    // ===== CHILD (READER) =====
+// -c "cmd" modunu çalıştırır (string birden çok satır içerebilir)
+int run_batch_string(const char *str)
+{
+  struct batch_reader br = {0};
+  br.fd = -1;
+  br.eof = true; // okunacak başka veri yok
+  br.buf = strdup(str);
+  if (br.buf == NULL)
+    return 1;
+  br.cap = br.end = strlen(str);
+  return run_batch(&br);
+}
 
-    // FIFO'yu O_RDWR açıyoruz ki open bloklamasın ve read beklesin
-    int fd = open(my_fifo, O_RDWR); // hem okuma hem yazma aç
-    if (fd < 0)
+/*
+ * ===== Sunucu modu =====
+ * shellish --serve /yol.sock [-j N]: UNIX socket'ten gelen komut satırlarını
+ * çalıştırır (her istek için "sh -c" fork'lamak yerine). N worker process
+ * önceden fork edilir ve hepsi aynı socket'te accept() bekler: aynı anda en
+ * fazla N istek çalışır, fazlası listen kuyruğunda bekler. Worker'lar uzun
+ * yaşadığı için komut hash tablosu ve plan cache'i istekler arasında sıcak
+ * kalır. Her istek sunucunun cwd'sinde başlar, stdin /dev/null'dur.
+ *
+ * Çerçeve: 1 byte tip + 4 byte uzunluk (big-endian) + veri
+ *   istemci -> sunucu: 'C' komut satırı(ları) (bağlantı başına birden çok istek)
+ *   sunucu -> istemci: 'O' stdout parçası, 'E' stderr parçası,
+ *                      'X' çıkış durumu (4 byte, big-endian), isteğin sonu
+ */
+#define SERVE_FRAME_HDR 5                // tip + uzunluk
+#define SERVE_MAX_REQUEST (1024 * 1024)  // en uzun istek
+#define SERVE_RELAY_BUF 65536            // çıktı çerçevesi başına en fazla
+
+static volatile sig_atomic_t serve_stop = 0; // SIGTERM/SIGINT geldi
+
+static void serve_on_signal(int sig)
+{
+  (void)sig;
+  serve_stop = 1;
+}
+
+// Bir çerçeve gönderir (kısmi yazmalar dahil). İstemci gittiyse -1.
+static int serve_send(int fd, char type, const void *data, size_t len)
+{
+  unsigned char hdr[SERVE_FRAME_HDR];
+  uint32_t be = htonl((uint32_t)len);
+  hdr[0] = (unsigned char)type;
+  memcpy(hdr + 1, &be, sizeof(be));
+  struct iovec iov[2] = {{hdr, sizeof(hdr)}, {(void *)data, len}};
+  struct msghdr msg;
+  memset(&msg, 0, sizeof(msg));
+  msg.msg_iov = iov;
+  msg.msg_iovlen = 2;
+  while (msg.msg_iovlen > 0)
+  {
+    ssize_t w = sendmsg(fd, &msg, MSG_NOSIGNAL); // kopan istemci SIGPIPE olmasın
+    if (w < 0)
     {
-      printf("-%s: chatroom: open fifo failed: %s\n", sysname, strerror(errno));
-      exit(1);
+      if (errno == EINTR)
+        continue;
+      return -1;
     }
-
-    char buf[1024]; // okuma bufferı
-    while (1)
+    while (msg.msg_iovlen > 0 && (size_t)w >= msg.msg_iov->iov_len)
     {
-      ssize_t n = read(fd, buf, sizeof(buf) - 1); // fifo'dan oku
-      if (n > 0)
-      {
-        buf[n] = '\0';      // string sonu
-        fputs(buf, stdout); // ekrana bas
-        fflush(stdout);     // hemen göster
-      }
-      // n == 0 ise (EOF gibi) burada takılabilir; O_RDWR olduğundan genelde bekler
-      // n < 0 ise hata olabilir, devam et
+      w -= msg.msg_iov->iov_len;
+      msg.msg_iov++;
+      msg.msg_iovlen--;
+    }
+    if (msg.msg_iovlen > 0)
+    {
+      msg.msg_iov->iov_base = (char *)msg.msg_iov->iov_base + w;
+      msg.msg_iov->iov_len -= w;
     }
   }
+  return 0;
+}
 
-  // ===== PARENT (WRITER + INPUT LOOP) =====
-  printf("Entered chatroom '%s' as '%s'. Type /exit to leave.\n", room, user);
-
-  // Kullanıcıdan satır satır mesaj al
-  char *line = NULL; // getline buffer
-  size_t cap = 0;    // buffer kapasitesi
-
-  while (1)
+// Tam n byte okur. 1: tamam, 0: baştan EOF, -1: hata veya yarım veri
+static int serve_read_full(int fd, void *buf, size_t n)
+{
+  size_t got = 0;
+  while (got < n)
   {
-    printf("chat> "); // chat prompt
-    fflush(stdout);
+    ssize_t r = read(fd, (char *)buf + got, n - got);
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return (r == 0 && got == 0) ? 0 : -1;
+    got += r;
+  }
+  return 1;
+}
 
-    ssize_t r = getline(&line, &cap, stdin); // kullanıcıdan oku
-    if (r == -1)
-    { // Ctrl+D / EOF
-      break;
-    }
+// Bir çerçeve okur; veri *buf'a (gerekirse büyütülür, sonuna '\0' eklenir)
+static int serve_recv(int fd, char *type, char **buf, size_t *len, size_t *cap)
+{
+  unsigned char hdr[SERVE_FRAME_HDR];
+  int r = serve_read_full(fd, hdr, sizeof(hdr));
+  if (r <= 0)
+    return r;
+  uint32_t be;
+  memcpy(&be, hdr + 1, sizeof(be));
+  *type = (char)hdr[0];
+  *len = ntohl(be);
+  if (*len > SERVE_MAX_REQUEST)
+    return -1;
+  if (*len + 1 > *cap)
+  {
+    char *nb = realloc(*buf, *len + 1);
+    if (nb == NULL)
+      return -1;
+    *buf = nb;
+    *cap = *len + 1;
+  }
+  if (*len > 0 && serve_read_full(fd, *buf, *len) != 1)
+    return -1;
+  (*buf)[*len] = '\0';
+  return 1;
+}
 
-    // Satır sonundaki '\n' varsa temizle
-    if (r > 0 && line[r - 1] == '\n')
-    {
-      line[r - 1] = '\0';
-    }
+// İsteğin stdout/stderr pipe'larını okuyup istemciye çerçeve olarak aktarır
+struct serve_relay
+{
+  int out, err; // pipe okuma uçları
+  int client;   // istemci socket'i
+};
 
-    // Çıkış komutu
-    if (strcmp(line, "/exit") == 0)
+static void *serve_relay_main(void *arg)
+{
+  struct serve_relay *r = arg;
+  static char buf[SERVE_RELAY_BUF]; // worker'da aynı anda tek relay var
+  struct pollfd pf[2] = {{r->out, POLLIN, 0}, {r->err, POLLIN, 0}};
+  int open_fds = 2;
+  bool client_ok = true;
+  while (open_fds > 0)
+  {
+    if (poll(pf, 2, -1) < 0)
     {
+      if (errno == EINTR)
+        continue;
       break;
     }
-
-    // Gönderilecek mesaj formatı: "username: mesaj\n"
-    char msg[1200];
-    snprintf(msg, sizeof(msg), "%s: %s\n", user, line);
-
-    // Oda klasörünü aç, içindeki diğer FIFO'lara mesaj gönder
-    DIR *d = opendir(room_dir); // klasörü aç
-    if (d == NULL)
+    for (int i = 0; i < 2; i++)
     {
-      printf("-%s: chatroom: opendir failed: %s\n", sysname, strerror(errno));
-      continue;
-    }
-
-    struct dirent *ent;
-    while ((ent = readdir(d)) != NULL)
-    { // tüm dosyaları gez
-      // "." ve ".." geç
-      if (strcmp(ent->d_name, ".") == 0 || strcmp(ent->d_name, "..") == 0)
-      {
+      if (pf[i].fd < 0 || pf[i].revents == 0)
         continue;
-      }
-
-      // Kendi FIFO'na mesaj göndermeyelim
-      if (strcmp(ent->d_name, user) == 0)
-      {
+      ssize_t n = read(pf[i].fd, buf, sizeof(buf));
+      if (n < 0 && errno == EINTR)
         continue;
-      }
-
-      // Hedef FIFO yolu
-      char target_fifo[512];
-      // target_fifo yolu buffer'a sığdı mı kontrol et
-      int n2 = snprintf(target_fifo, sizeof(target_fifo), "%s/%s", room_dir, ent->d_name); // yolu yaz
-      if (n2 < 0 || n2 >= (int)sizeof(target_fifo))
-      {           // sığmadıysa
-        continue; // bunu geç
-      }
-
-      // Her hedefe ayrı child ile yaz (ödev istiyordu)
-      pid_t wp = fork(); // writer child
-      if (wp == 0)
+      if (n <= 0) // yazan uçların hepsi kapandı
       {
-        // Hedef FIFO'yu yazma modunda aç (non-blocking: karşı taraf yoksa takılmasın)
-        int wfd = open(target_fifo, O_WRONLY | O_NONBLOCK);
-        if (wfd >= 0)
-        {
-          write(wfd, msg, strlen(msg)); // mesajı yaz
-          close(wfd);                   // kapat
-        }
-        exit(0); // writer child çık
+        pf[i].fd = -1;
+        open_fds--;
+        continue;
       }
-      // parent burada beklemiyor (çok child olursa zombie olabilir; basitçe ignore edebiliriz)
+      // İstemci gittiyse okumaya devam et (komut pipe'ta takılmasın)
+      if (client_ok && serve_send(r->client, i == 0 ? 'O' : 'E', buf, n) != 0)
+        client_ok = false;
     }
-
-    closedir(d); // klasörü kapat
   }
+  return NULL;
+}
 
-  free(line); // buffer temizle
-
-  // Reader'ı durdur
-  kill(reader_pid, SIGTERM);    // reader child'i öldür
-  waitpid(reader_pid, NULL, 0); // reader bitmesini bekle
+// Tek isteği çalıştırır: fd 1/2 relay pipe'larına bağlanır, satır(lar) batch
+// modundaki gibi çalıştırılır, sonra fd'ler geri alınır. Dönüş: çıkış durumu.
+static int serve_run(int client, char *line, int saved_out, int saved_err)
+{
+  int out[2], err[2];
+  if (pipe2(out, O_CLOEXEC) != 0)
+    return 126;
+  if (pipe2(err, O_CLOEXEC) != 0)
+  {
+    close(out[0]);
+    close(out[1]);
+    return 126;
+  }
 
-  // Çıkınca kendi FIFO'yu silmek istersen (temizlik)
-  unlink(my_fifo); // kendi fifo dosyasını sil
+  // Relay hiçbir sinyali almasın (SIGCHLD handler'ı ana thread'de kalsın)
+  struct serve_relay relay = {out[0], err[0], client};
+  pthread_t tid;
+  sigset_t all, old;
+  sigfillset(&all);
+  pthread_sigmask(SIG_BLOCK, &all, &old);
+  int rc = pthread_create(&tid, NULL, serve_relay_main, &relay);
+  pthread_sigmask(SIG_SETMASK, &old, NULL);
+  if (rc != 0)
+  {
+    close(out[0]);
+    close(out[1]);
+    close(err[0]);
+    close(err[1]);
+    return 126;
+  }
 
-  printf("Left chatroom '%s'.\n", room);
-  return SUCCESS;
+  fflush(stdout);
+  fflush(stderr);
+  dup2(out[1], STDOUT_FILENO); // child'lar da bu fd'leri miras alır
+  dup2(err[1], STDERR_FILENO);
+  close(out[1]);
+  close(err[1]);
+
+  last_status = 0;
+  run_batch_string(line);
+
+  // Yazan uçları bırak: relay son çıktıyı gönderip EOF'ta biter. Arka plan
+  // job'ı pipe'ı hâlâ tutuyorsa istek o job bitince tamamlanır.
+  fflush(stdout);
+  fflush(stderr);
+  dup2(saved_out, STDOUT_FILENO);
+  dup2(saved_err, STDERR_FILENO);
+  pthread_join(tid, NULL);
+  close(out[0]);
+  close(err[0]);
+  jobs_notify(false); // biten arka plan job'larını tablodan sil
+  return last_status;
 }
 
-// Builtin komutları çalıştırır (child içinde veya normalde çağrılabilir)
-// Başarılıysa SUCCESS, değilse UNKNOWN döner
-int run_builtin_child(struct command_t *command)
+// Worker process: bağlantı kabul eder, bağlantıdaki istekleri sırayla işler
+static void serve_worker(int lfd, pid_t master)
 {
-  // Güvenlik: command veya name yoksa builtin yok
-  if (command == NULL || command->name == NULL)
+  signal(SIGTERM, SIG_DFL); // sunucunun handler'ları değil
+  signal(SIGINT, SIG_DFL);
+  prctl(PR_SET_PDEATHSIG, SIGTERM); // sunucu ölürse (SIGKILL dahil) worker da
+  if (getppid() != master)
+    _exit(0); // fork'tan hemen sonra ölmüş
+  signal(SIGPIPE, SIG_IGN); // kopan istemci: write EPIPE döner
+  jobs_init(false);
+
+  int devnull = open("/dev/null", O_RDONLY);
+  if (devnull >= 0 && devnull != STDIN_FILENO)
   {
-    return UNKNOWN; // tanımsız
+    dup2(devnull, STDIN_FILENO);
+    close(devnull);
   }
+  int home = open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC); // her istek burada başlar
+  int saved_out = fcntl(STDOUT_FILENO, F_DUPFD_CLOEXEC, 3);
+  int saved_err = fcntl(STDERR_FILENO, F_DUPFD_CLOEXEC, 3);
 
-  // help builtin: komut listesini basar
-  if (strcmp(command->name, "help") == 0)
+  char *req = NULL;
+  size_t cap = 0;
+  while (1)
   {
-    printf("Shell-ish builtins:\n");                            // başlık
-    printf("  cd <dir>\n");                                     // cd
-    printf("  exit\n");                                         // exit
-    printf("  cut -d X -f list   (or --delimiter/--fields)\n"); // cut
-    printf("  chatroom <room> <user>\n");                       // chatroom (sonra)
-    printf("  help\n");                                         // help
-    return SUCCESS;                                             // başarılı
+    int c = accept4(lfd, NULL, NULL, SOCK_CLOEXEC);
+    if (c < 0)
+    {
+      if (errno == EINTR || errno == ECONNABORTED)
+        continue;
+      _exit(1); // sunucu durur (bkz. run_serve)
+    }
+    char type;
+    size_t len;
+    while (serve_recv(c, &type, &req, &len, &cap) == 1 && type == 'C')
+    {
+      unsigned gen = plan_gen;
+      uint32_t status = htonl((uint32_t)serve_run(c, req, saved_out, saved_err));
+      if (home >= 0 && plan_gen != gen) // "cd" sonraki isteğe taşmasın
+      {
+        fchdir(home);
+        plan_cache_invalidate();
+      }
+      if (serve_send(c, 'X', &status, sizeof(status)) != 0)
+        break;
+    }
+    close(c);
   }
+}
 
-  // cut builtin: asıl cut fonksiyonunu çağır
-  if (strcmp(command->name, "cut") == 0)
+// Socket'i oluşturur. Ölü bir sunucudan kalan socket dosyası silinir.
+static int serve_listen(const char *path)
+{
+  struct sockaddr_un sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  if (strlen(path) >= sizeof(sa.sun_path))
   {
-    return run_cut_builtin(command); // cut'ı çalıştır
+    errno = ENAMETOOLONG;
+    return -1;
   }
+  strcpy(sa.sun_path, path);
 
-  // repeat builtin: komutu N kez çalıştır
-  if (strcmp(command->name, "repeat") == 0)
+  struct stat st;
+  if (lstat(path, &st) == 0 && S_ISSOCK(st.st_mode))
   {
-    return run_repeat_builtin(command); // repeat'i çalıştır
+    int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (probe >= 0 && connect(probe, (struct sockaddr *)&sa, sizeof(sa)) != 0 &&
+        errno == ECONNREFUSED)
+      unlink(path); // kimse dinlemiyor
+    if (probe >= 0)
+      close(probe);
   }
 
-  // chatroom builtin daha sonra eklenecek
-  return UNKNOWN; // bu isimde builtin yok
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0)
+    return -1;
+  mode_t old = umask(077); // komut çalıştıran socket sadece sahibine açık
+  int r = bind(fd, (struct sockaddr *)&sa, sizeof(sa));
+  umask(old);
+  if (r != 0 || listen(fd, SOMAXCONN) != 0)
+  {
+    int e = errno;
+    close(fd);
+    errno = e;
+    return -1;
+  }
+  return fd;
 }
 
-// repeat builtin: "repeat N cmd args..." komutunu N kez çalıştırır
-
-int process_command(struct command_t *command)
+// --serve: worker'ları fork eder, ölenin yerine yenisini açar.
+// SIGTERM/SIGINT: worker'ları durdurur, socket dosyasını siler.
+int run_serve(const char *path, int nworkers)
 {
-  int r;
-  if (strcmp(command->name, "") == 0)
-    return SUCCESS;
-
-  if (strcmp(command->name, "exit") == 0)
-    return EXIT;
+  int lfd = serve_listen(path);
+  if (lfd < 0)
+  {
+    printf("-%s: --serve: %s: %s\n", sysname, path, strerror(errno));
+    return 1;
+  }
 
-  if (strcmp(command->name, "cd") == 0)
+  struct sigaction sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sa_handler = serve_on_signal; // SA_RESTART yok: waitpid EINTR ile döner
+  sigemptyset(&sa.sa_mask);
+  sigaction(SIGTERM, &sa, NULL);
+  sigaction(SIGINT, &sa, NULL);
+
+  pid_t *pids = calloc(nworkers, sizeof(pid_t));
+  if (pids == NULL)
+    return 1;
+  int code = 0;
+  pid_t master = getpid();
+  fflush(stdout); // worker'lara yarım buffer geçmesin
+  while (!serve_stop)
   {
-    if (command->arg_count > 0)
+    for (int i = 0; i < nworkers && !serve_stop; i++)
     {
-      r = chdir(command->args[1]);
-      if (r == -1)
-        printf("-%s: %s: %s\n", sysname, command->name, strerror(errno));
-      return SUCCESS;
+      if (pids[i] > 0)
+        continue;
+      pid_t pid = fork();
+      if (pid == 0)
+        serve_worker(lfd, master); // dönmez
+      pids[i] = pid;
+      if (pid < 0)
+      {
+        printf("-%s: --serve: fork: %s\n", sysname, strerror(errno));
+        fflush(stdout);
+        sleep(1); // tekrar denemeden önce bekle
+      }
+    }
+
+    int status;
+    pid_t pid = waitpid(-1, &status, 0);
+    if (pid < 0)
+      continue; // EINTR (sinyal) veya henüz worker yok
+    for (int i = 0; i < nworkers; i++)
+      if (pids[i] == pid)
+        pids[i] = 0; // döngü başında yenisi açılır
+    if (WIFEXITED(status) && WEXITSTATUS(status) == 1) // accept() çalışmıyor
+    {
+      printf("-%s: --serve: worker failed to accept connections\n", sysname);
+      code = 1;
+      serve_stop = 1;
     }
   }
-  // help builtin: komut listesini bas (pipe olmadan da çalışsın)
-  if (strcmp(command->name, "help") == 0)
+
+  for (int i = 0; i < nworkers; i++)
+    if (pids[i] > 0)
+      kill(pids[i], SIGTERM);
+  while (waitpid(-1, NULL, 0) > 0 || errno == EINTR)
+    ;
+  unlink(path);
+  close(lfd);
+  free(pids);
+  return code;
+}
+
+// --client: tek istek gönderir; çıktıyı stdout/stderr'e yazar ve komutun
+// çıkış koduyla döner (test ve ölçüm için)
+int run_client(const char *path, char **args, int nargs)
+{
+  size_t len = 0;
+  for (int i = 0; i < nargs; i++)
+    len += strlen(args[i]) + 1;
+  char *line = malloc(len + 1);
+  if (line == NULL)
+    return 2;
+  line[0] = '\0';
+  for (int i = 0; i < nargs; i++) // argümanları boşlukla birleştir (ssh gibi)
   {
-    return run_builtin_child(command); // help'i çalıştır
+    if (i > 0)
+      strcat(line, " ");
+    strcat(line, args[i]);
   }
 
-  // cut builtin: stdin'den okuyup field'ları basar
-  if (strcmp(command->name, "cut") == 0)
+  struct sockaddr_un sa;
+  memset(&sa, 0, sizeof(sa));
+  sa.sun_family = AF_UNIX;
+  strncpy(sa.sun_path, path, sizeof(sa.sun_path) - 1);
+  int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+  if (fd < 0 || connect(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0 ||
+      serve_send(fd, 'C', line, strlen(line)) != 0)
   {
-    return run_cut_builtin(command); // cut fonksiyonunu çağır
+    printf("-%s: --client: %s: %s\n", sysname, path, strerror(errno));
+    free(line);
+    return 2;
   }
+  free(line);
 
-  // repeat builtin: komutu N kez çalıştır
-  if (strcmp(command->name, "repeat") == 0)
+  char *buf = NULL, type = 0;
+  size_t n, cap = 0;
+  int code = 2; // 'X' gelmeden bağlantı koparsa
+  while (serve_recv(fd, &type, &buf, &n, &cap) == 1)
   {
-    return run_repeat_builtin(command); // repeat'i çalıştır
+    if (type == 'O' || type == 'E')
+      zc_write_all(type == 'O' ? STDOUT_FILENO : STDERR_FILENO, buf, n);
+    else if (type == 'X' && n == sizeof(uint32_t))
+    {
+      uint32_t be;
+      memcpy(&be, buf, sizeof(be));
+      code = (int)ntohl(be);
+      break;
+    }
   }
+  if (code == 2 && type != 'X')
+    printf("-%s: --client: %s: connection closed\n", sysname, path);
+  free(buf);
+  close(fd);
+  return code;
+}
 
-  // chatroom builtin: oda chatine girer
-  if (strcmp(command->name, "chatroom") == 0)
+#ifndef SHELLISH_NO_MAIN // kütüphane derlemesinde (libshellish.a) main yok
+int main(int argc, char *argv[])
+{
+  // SHELLISH_SPAWN=fork ile klasik fork+exec yoluna geçilebilir
+  const char *mode_env = getenv("SHELLISH_SPAWN");
+  if (mode_env != NULL && strcmp(mode_env, "fork") == 0)
+    spawn_mode = SPAWN_MODE_FORK;
+
+  // SHELLISH_TRACE=dosya: açılıştan itibaren faz izleme (batch modda da)
+  const char *trace_env = getenv("SHELLISH_TRACE");
+  if (trace_env != NULL && trace_env[0] != '\0')
   {
-    return run_chatroom_builtin(command); // chatroom'u çalıştır
+    if (trace_open(trace_env) != 0)
+      printf("-%s: SHELLISH_TRACE: %s: %s\n", sysname, trace_env, strerror(errno));
   }
+  atexit(trace_close); // Chrome dizisini kapat (child'larda bir şey yapmaz)
 
-  // Eğer komut zinciri varsa (| kullanılmışsa), pipeline olarak çalıştır
-  if (command->next != NULL)
+  // shellish --serve /yol.sock [-j N]: komut sunucusu (bkz. run_serve)
+  if (argc >= 2 && strcmp(argv[1], "--serve") == 0)
   {
-    return execute_pipeline(command); // pipe zincirini çalıştırıp çık
+    long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+    int workers = ncpu > 2 ? (int)ncpu : 2; // varsayılan: CPU sayısı (en az 2)
+    if (argc >= 5 && strcmp(argv[3], "-j") == 0)
+      workers = atoi(argv[4]);
+    if (argc < 3 || workers < 1)
+    {
+      printf("-%s: --serve: usage: --serve <socket> [-j N]\n", sysname);
+      return 2;
+    }
+    return run_serve(argv[2], workers);
   }
 
-  pid_t pid = fork();
-  if (pid == 0) // child
+  // shellish --client /yol.sock cmd...: sunucuya tek istek gönder
+  if (argc >= 2 && strcmp(argv[1], "--client") == 0)
   {
-    /// This shows how to do exec with environ (but is not available on MacOs)
-    // extern char** environ; // environment variables
-    // execvpe(command->name, command->args, environ); // exec+args+path+environ
-
-    /// This shows how to do exec with auto-path resolve
-    // add a NULL argument to the end of args, and the name to the beginning
-    // as required by exec
-
-    // TODO: do your own exec with path resolving using execv()
-    // do so by replacing the execvp call below
-    // Kullanıcının yazdığı komutun gerçek çalıştırılabilir dosya yolunu bul.
-    // Örnek:
-    // "ls"   -> "/usr/bin/ls"
-    // "date" -> "/usr/bin/date"
-    // "./a.out" -> "./a.out" (eğer çalıştırılabilirse)
-    char *resolved_path = resolve_executable_path(command->name);
-
-    // Eğer komut PATH içinde veya verilen path'te bulunamadıysa,
-    // kullanıcıya "command not found" mesajı ver ve child process'i hata koduyla bitir.
-    if (resolved_path == NULL)
+    if (argc < 4)
     {
-      printf("-%s: %s: command not found\n", sysname, command->name);
-      exit(127);
+      printf("-%s: --client: usage: --client <socket> <command...>\n", sysname);
+      return 2;
     }
+    return run_client(argv[2], argv + 3, argc - 3);
+  }
 
-    /* ===== Part 2: I/O Redirection (Kısa açıklamalı) =====
-     * redirects[0] = "<input"   -> stdin dosyadan okunsun
-     * redirects[1] = ">output"  -> stdout dosyaya yazılsın (truncate)
-     * redirects[2] = ">>output" -> stdout dosyaya yazılsın (append)
-     * ===================================================== */
-
-    // <input : stdin'i dosyadan okumak için yönlendirme
-    if (command->redirects[0])
-    {                                                    // Eğer "<" ile input dosyası verilmişse
-      int in_fd = open(command->redirects[0], O_RDONLY); // Dosyayı sadece okuma modunda aç
-      if (in_fd < 0)
-      { // Açma başarısızsa
-        printf("-%s: input dosyasi acilamadi %s: %s\n",
-               sysname, command->redirects[0], strerror(errno)); // Hata mesajı yaz
-        exit(1);                                                 // Child process'i hata ile bitir
-      }
-      dup2(in_fd, STDIN_FILENO); // stdin(0) artık bu dosyadan gelsin
-      close(in_fd);              // Artık gerek kalmayan fd'yi kapat
-    }
-
-    // >output : stdout'u dosyaya yazmak (truncate: varsa içini sıfırlar)
-    if (command->redirects[1])
-    {                                                 // Eğer ">" ile output dosyası verilmişse
-      int out_fd = open(command->redirects[1],        // Output dosyasını aç
-                        O_WRONLY | O_CREAT | O_TRUNC, // yazma + yoksa oluştur + varsa sıfırla
-                        0644);                        // dosya izinleri (rw-r--r--)
-      if (out_fd < 0)
-      { // Açma başarısızsa
-        printf("-%s: output dosyasi acilamadi %s: %s\n",
-               sysname, command->redirects[1], strerror(errno)); // Hata mesajı yaz
-        exit(1);                                                 // Child process'i hata ile bitir
-      }
-      dup2(out_fd, STDOUT_FILENO); // stdout(1) artık bu dosyaya yazsın
-      close(out_fd);               // Artık gerek kalmayan fd'yi kapat
-    }
-
-    // >>output : stdout'u dosyaya yazmak (append: sona ekler)
-    if (command->redirects[2])
-    {                                                  // Eğer ">>" ile append dosyası verilmişse
-      int app_fd = open(command->redirects[2],         // Append dosyasını aç
-                        O_WRONLY | O_CREAT | O_APPEND, // yazma + yoksa oluştur + sona ekle
-                        0644);                         // dosya izinleri
-      if (app_fd < 0)
-      { // Açma başarısızsa
-        printf("-%s: append dosyasi acilamadi %s: %s\n",
-               sysname, command->redirects[2], strerror(errno)); // Hata mesajı yaz
-        exit(1);                                                 // Child process'i hata ile bitir
-      }
-      dup2(app_fd, STDOUT_FILENO); // stdout(1) artık bu dosyaya (sona ekleyerek) yazsın
-      close(app_fd);               // Artık gerek kalmayan fd'yi kapat
+  // shellish -c "cmd": tek komut satırını çalıştır ve çık
+  if (argc >= 2 && strcmp(argv[1], "-c") == 0)
+  {
+    if (argc < 3)
+    {
+      printf("-%s: -c: option requires an argument\n", sysname);
+      return 2;
     }
-
-    // Komutun gerçek path'i bulunduysa execv ile çalıştır.
-    // resolved_path tam dosya yoludur.
-    // command->args ise argüman listesidir.
-    // Örnek:
-    // execv("/usr/bin/ls", ["ls", "-l", NULL]);
-    execv(resolved_path, command->args);
-
-    /*
-     * Eğer execv başarılı olursa bu satırların altına asla gelinmez.
-     * Çünkü child process artık eski kodu bırakır ve yeni programı çalıştırmaya başlar.
-     *
-     * Eğer buraya gelindiyse execv başarısız olmuş demektir.
-     * Bu durumda hata mesajını yazdırıyoruz.
-     */
-    printf("-%s: %s: %s\n", sysname, command->name, strerror(errno));
-
-    // resolve_executable_path içinde dinamik bellek ayırdığımız için
-    // execv başarısız olursa burada belleği serbest bırakıyoruz.
-    free(resolved_path);
-
-    // Child process'i hata kodu ile sonlandır.
-    exit(127);
+    jobs_init(false);
+    return run_batch_string(argv[2]);
   }
-  else
+
+  // shellish script.sh: dosyadaki komutları sırayla çalıştır
+  if (argc >= 2)
   {
-    // Eğer komut background olarak çalıştırılacaksa parent beklemez.
-    if (command->background)
+    int fd = open(argv[1], O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
     {
-      return SUCCESS;
+      printf("-%s: %s: %s\n", sysname, argv[1], strerror(errno));
+      return 127;
     }
+    jobs_init(false);
+    int code = run_batch_fd(fd);
+    close(fd);
+    return code;
+  }
 
-    // Foreground komutlarda parent, child process'in bitmesini bekler.
-    waitpid(pid, NULL, 0);
-    return SUCCESS;
+  // stdin terminal değilse (pipe/dosya) prompt'suz batch moduna geç
+  if (!isatty(STDIN_FILENO))
+  {
+    jobs_init(false); // arka plan job'ları yine de toplansın
+    return run_batch_fd(STDIN_FILENO);
   }
-}
+  jobs_init(true); // etkileşimli: job control
+  hist_init();     // kalıcı geçmiş (dosya ilk kullanımda okunur)
 
-int main()
-{
   while (1)
   {
-    struct command_t *command =
-        (struct command_t *)malloc(sizeof(struct command_t));
-    memset(command, 0, sizeof(struct command_t)); // set all bytes to 0
+    jobs_notify(true); // biten arka plan job'larını bildir
 
     int code;
-    code = prompt(command);
+    code = prompt(); // satır prompt_buf'ta
     if (code == EXIT)
       break;
 
-    code = process_command(command);
+    code = run_line(prompt_buf); // plan cache'i üzerinden parse + çalıştır
     if (code == EXIT)
       break;
-
-    free_command(command);
   }
 
   printf("\n");
-  return 0;
+  return last_status;
 }
+#endif // SHELLISH_NO_MAIN
@@ -0,0 +1,67 @@
+/*
+ * shellish.h - Shell-ish'in parser ve executor arayüzü
+ *
+ * shellish-skeleton.c hem shell programı hem de kütüphane olarak derlenir:
+ * -DSHELLISH_NO_MAIN ile main() dışarıda kalır ve dosya libshellish.a olur
+ * (bkz. Makefile). Benchmark'lar (bench/) parser'ı ve executor'ı bu header
+ * üzerinden, shell'in kendisiyle aynı kodu çalıştırarak kullanır.
+ */
+#ifndef SHELLISH_H
+#define SHELLISH_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+enum return_codes
+{
+  SUCCESS = 0,
+  EXIT = 1,
+  UNKNOWN = 2,
+};
+
+struct command_t
+{
+  char *name;
+  bool background;
+  bool auto_complete;
+  int arg_count;
+  char **args;
+  char *redirects[3];     // in/out redirection
+  char *path;             // plan cache'inde önceden çözülmüş yol (NULL: çalışırken çöz)
+  struct command_t *next; // for piping
+};
+
+struct arena; // bump-pointer arena (içi shellish-skeleton.c'de)
+
+extern const char *sysname;
+extern int last_status;        // son komutun çıkış durumu
+extern struct arena line_arena; // parse sonuçlarının geldiği arena
+
+/* ===== Parser ===== */
+
+// Satırı command'a parse eder; token'lar line_arena'dan gelir
+int parse_command(char *buf, struct command_t *command);
+void print_command(struct command_t *command);
+void *arena_calloc(struct arena *a, size_t size);
+void arena_reset(struct arena *a); // satırın tüm parse sonuçlarını bırakır
+
+/* ===== Executor ===== */
+
+// Builtin'leri, tek komutları ve pipeline'ları çalıştırır (SUCCESS/EXIT/UNKNOWN)
+int process_command(struct command_t *command);
+int execute_pipeline(struct command_t *cmd);
+int run_line(char *line);               // ";", "&&", "||" adımlarını plan cache'i ile çalıştırır
+int run_batch_string(const char *str);  // -c modu: satır satır çalıştırır
+void jobs_init(bool interactive);       // SIGCHLD handler'ı (ve job control)
+
+// PATH'te arar (komut hash tablosu ile); dönen string free edilmeli
+char *resolve_executable_path(const char *cmd);
+void cmd_hash_clear(void);
+
+// Dış komutu başlatır, beklemez (parametreler için bkz. tanımı)
+int spawn_command(const char *path, char *const argv[], int in_fd, int out_fd,
+                  int close_fd, char *const redirects[3], pid_t pgid, bool take_tty,
+                  pid_t *pid_out);
+
+#endif